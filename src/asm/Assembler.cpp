@@ -3,380 +3,651 @@
 //
 
 #include "Assembler.h"
+#include "Optimizer.h"
+#include <algorithm>
 #include <exception>
 #include <cstring>
 #include <iostream>
 #include <cassert>
-
-Instruction::Instruction() {
-    _status = InstructionStatus::FAILED;
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+//Longest runs of decimal digits converted without the standard library, the result is the same
+static const int MAX_EXACT_VALUE_DIGITS = 15;
+static const int MAX_EXACT_ADDRESS_DIGITS = 9;
+
+Instruction Instruction::label(int identifier) {
+    Instruction instruction = {};
+    instruction.kind = LABEL_INSTRUCTION;
+    instruction.identifier = identifier;
+    return instruction;
 }
 
-InstructionStatus Instruction::getStatus() { return _status; }
-
-bool Instruction::tryGetOperationCode(char *buf, int bufSize, int instructionAddress) { return false; }
-
-int Instruction::getOperationSize() { return 0; }
-
-std::string Instruction::getIdentifier() { return ""; }
-
-JumpInstruction::JumpInstruction(OperationPrefixCode prefixCode, std::string &argumentIdentifier,
-                                 std::unordered_map<std::string, int> &identifiersTable):
-        _identifiersTable(identifiersTable), _argumentIdentifier(argumentIdentifier){
-    _prefixCode = prefixCode;
-    _status = InstructionStatus::OK;
+Instruction Instruction::noArgs(OperationPrefixCode prefixCode) {
+    Instruction instruction = {};
+    instruction.kind = NO_ARGS_INSTRUCTION;
+    instruction.prefixCode = prefixCode;
+    instruction.identifier = -1;
+    return instruction;
 }
 
-bool JumpInstruction::tryGetOperationCode(char *buf, int bufSize, int instructionAddress)  {
-    if (bufSize < 1 + sizeof (int))
-        return false;
-    if (_identifiersTable.find(_argumentIdentifier) == _identifiersTable.end())
-        return false;
-    int labelAddress = _identifiersTable[_argumentIdentifier];
-    int offset = labelAddress - instructionAddress;
-    buf[0] = _prefixCode;
-    memcpy(buf + 1, &offset, sizeof (int));
-    return true;
+Instruction Instruction::unary(OperationPrefixCode prefixCode, const void *argument, int argumentSize) {
+    assert(argumentSize > 0 && argumentSize <= 8);
+    Instruction instruction = {};
+    instruction.kind = UNARY_INSTRUCTION;
+    instruction.prefixCode = prefixCode;
+    instruction.argumentSize = argumentSize;
+    std::memcpy(instruction.argument, argument, argumentSize);
+    instruction.identifier = -1;
+    return instruction;
 }
 
-int JumpInstruction::getOperationSize() {
-    return 1 + sizeof (int);
+Instruction Instruction::jump(OperationPrefixCode prefixCode, int identifier) {
+    Instruction instruction = {};
+    instruction.kind = JUMP_INSTRUCTION;
+    instruction.prefixCode = prefixCode;
+    instruction.identifier = identifier;
+    return instruction;
 }
 
-std::string JumpInstruction::getIdentifier() {
-    return _argumentIdentifier;
+IdentifierTable::IdentifierTable(): _slots(1024, 0) {
 }
 
-LabelInstruction::LabelInstruction(const std::string &identifier): _identifier(identifier) {
-    _status = InstructionStatus::OK;
+unsigned int IdentifierTable::hash(const char *name, int length) {
+    unsigned int value = 2166136261u;
+    for (int i = 0; i < length; i++)
+        value = (value ^ static_cast<unsigned char>(name[i])) * 16777619u;
+    return value;
 }
 
-std::string LabelInstruction::getIdentifier() {
-    return _identifier;
+void IdentifierTable::grow() {
+    std::vector<int> slots(_slots.size() * 2, 0);
+    unsigned int mask = slots.size() - 1;
+    for (int identifier = 0; identifier < static_cast<int>(_names.size()); identifier++) {
+        unsigned int slot = hash(_names[identifier].data(), _names[identifier].size()) & mask;
+        while (slots[slot] != 0)
+            slot = (slot + 1) & mask;
+        slots[slot] = identifier + 1;
+    }
+    _slots.swap(slots);
 }
 
-NoArgsInstruction::NoArgsInstruction(OperationPrefixCode prefixCode) {
-    _prefixCode = prefixCode;
-    _status = InstructionStatus::OK;
-}
+int IdentifierTable::intern(const char *name, int length) {
+    unsigned int mask = _slots.size() - 1;
+    unsigned int slot = hash(name, length) & mask;
+    while (_slots[slot] != 0) {
+        const std::string &candidate = _names[_slots[slot] - 1];
+        if (static_cast<int>(candidate.size()) == length && std::memcmp(candidate.data(), name, length) == 0)
+            return _slots[slot] - 1;
+        slot = (slot + 1) & mask;
+    }
 
-bool NoArgsInstruction::tryGetOperationCode(char *buf, int bufSize, int instructionAddress) {
-    if (bufSize < 1)
-        return false;
-    buf[0] = static_cast<char>(_prefixCode);
-    return true;
+    int identifier = _names.size();
+    _names.emplace_back(name, length);
+    _addresses.push_back(-1);
+    _bindings.push_back(LOCAL_SYMBOL);
+    _slots[slot] = identifier + 1;
+    //Kept at most half full
+    if (_names.size() * 2 > _slots.size())
+        grow();
+    return identifier;
 }
 
-int NoArgsInstruction::getOperationSize() {
-    return 1;
+int IdentifierTable::getCount() const {
+    return _names.size();
 }
 
-UnaryInstruction::UnaryInstruction(OperationPrefixCode prefixCode, char *operationArgument, int argumentSize) {
-    assert(argumentSize > 0 && argumentSize <= 8);
-    _prefixCode = prefixCode;
-    std::memcpy(_operationArgument, operationArgument, argumentSize);
-    _argumentSize = argumentSize;
-    _status = InstructionStatus::OK;
+const std::string &IdentifierTable::getName(int identifier) const {
+    return _names[identifier];
 }
 
-bool UnaryInstruction::tryGetOperationCode(char *buf, int bufSize, int instructionAddress) {
-    if (bufSize < 1 + _argumentSize)
-        return false;
-    buf[0] = static_cast<char>(_prefixCode);
-    std::memcpy(buf + 1, _operationArgument, _argumentSize);
-    return true;
+int IdentifierTable::getAddress(int identifier) const {
+    return _addresses[identifier];
 }
 
-int UnaryInstruction::getOperationSize() {
-    return 1 + _argumentSize;
+void IdentifierTable::setAddress(int identifier, int address) {
+    _addresses[identifier] = address;
 }
 
-int InstructionParser::getRegCodeByName(const std::string &name) {
-    if (name == "ax")
-        return RegisterCode::AX;
-    else if (name == "bx")
-        return RegisterCode::BX;
-    else if (name == "cx")
-        return RegisterCode::CX;
-    else if (name == "dx")
-        return RegisterCode::DX;
-    else
-        return -1;
+SymbolBinding IdentifierTable::getBinding(int identifier) const {
+    return _bindings[identifier];
 }
 
-int InstructionParser::getNoArgsOperationCodeByName(const std::string &name) {
-    if (name == "add")
-        return OperationPrefixCode::ADD;
-    else if (name == "sub")
-        return OperationPrefixCode::SUB;
-    else if (name == "mul")
-        return OperationPrefixCode::MUL;
-    else if (name == "div")
-        return OperationPrefixCode::DIV;
-    else if (name == "sin")
-        return OperationPrefixCode::SIN;
-    else if (name == "cos")
-        return OperationPrefixCode::COS;
-    else if (name == "sqrt")
-        return OperationPrefixCode::SQRT;
-    else if (name == "in")
-        return OperationPrefixCode::IN;
-    else if (name == "out")
-        return OperationPrefixCode::OUT;
-    else if (name == "ret")
-        return OperationPrefixCode::RET_ABS;
-    else if (name == "popd")
-        return OperationPrefixCode::POP;
-    else if (name == "halt")
-        return OperationPrefixCode::HALT;
-    else
-        return -1;
+void IdentifierTable::setBinding(int identifier, SymbolBinding binding) {
+    _bindings[identifier] = binding;
 }
 
-int InstructionParser::getJumpOperationPrefixCodeByName(const std::string &name) {
-    if (name == "jmp")
-        return OperationPrefixCode::JMP_OFFSET_EXACT_VAL;
-    else if (name == "je")
-        return OperationPrefixCode::JE_OFFSET_EXACT_VAL;
-    else if (name == "jne")
-        return OperationPrefixCode::JNE_OFFSET_EXACT_VAL;
-    else if (name == "ja")
-        return OperationPrefixCode::JA_OFFSET_EXACT_VAL;
-    else if (name == "jae")
-        return OperationPrefixCode::JAE_OFFSET_EXACT_VAL;
-    else if (name == "jb")
-        return OperationPrefixCode::JB_OFFSET_EXACT_VAL;
-    else if (name == "jbe")
-        return OperationPrefixCode::JBE_OFFSET_EXACT_VAL;
-    else if (name == "call")
-        return OperationPrefixCode::CALL_OFFSET_EXACT_VAL;
-    else
-        return -1;
+void IdentifierTable::clear() {
+    _names.clear();
+    _addresses.clear();
+    _bindings.clear();
+    std::fill(_slots.begin(), _slots.end(), 0);
 }
 
-Instruction * InstructionParser::getNoArgsInstructionByName(const std::string &name) {
-    assert(getNoArgsOperationCodeByName(name) != -1);
-
-    OperationPrefixCode prefixCode = static_cast<OperationPrefixCode>(getNoArgsOperationCodeByName(name));
-    NoArgsInstruction *instruction = new NoArgsInstruction(prefixCode);
-
-    return instruction;
+//Value of a word of at most maxDigits decimal digits, optionally after a minus, false for anything else
+static bool tryGetExactNumber(const char *begin, int length, bool allowMinus, int maxDigits,
+                              bool &negative, long long &magnitude) {
+    negative = allowMinus && length > 0 && begin[0] == '-';
+    int digits = length - (negative ? 1 : 0);
+    if (digits <= 0 || digits > maxDigits)
+        return false;
+    magnitude = 0;
+    for (int i = length - digits; i < length; i++) {
+        if (begin[i] < '0' || begin[i] > '9')
+            return false;
+        magnitude = magnitude * 10 + (begin[i] - '0');
+    }
+    return true;
 }
 
-Instruction * InstructionParser::getJumpInstruction(std::istream &in, std::ostream &logsStream, std::string keyword,
-                                                    std::unordered_map<std::string, int> &identifiersTable) {
-    assert(getJumpOperationPrefixCodeByName(keyword) != -1);
+InstructionParser::InstructionParser(const char *begin, const char *end, IdentifierTable &identifiers,
+                                     std::ostream &logsStream):
+    _lexer(begin, end), _identifiers(identifiers), _logsStream(logsStream) {
+}
 
-    std::string identifier;
-    in >> identifier;
+int InstructionParser::getRegCodeByName(const char *name, int length) {
+    if (length != 2 || name[1] != 'x')
+        return -1;
+    switch (name[0]) {
+        case 'a':
+            return RegisterCode::AX;
+        case 'b':
+            return RegisterCode::BX;
+        case 'c':
+            return RegisterCode::CX;
+        case 'd':
+            return RegisterCode::DX;
+        default:
+            return -1;
+    }
+}
 
-    if (identifier.empty()) {
-        logsStream << "Label cannot be empty!" << std::endl;
-        Instruction *instruction = new Instruction;
-        return instruction;
+bool InstructionParser::getJumpInstruction(OperationPrefixCode prefixCode, Instruction &instruction) {
+    Token identifier;
+    if (!_lexer.next(identifier)) {
+        _logsStream << "Label cannot be empty!" << std::endl;
+        return false;
     }
 
-    JumpInstruction *instruction = new JumpInstruction(
-            static_cast<OperationPrefixCode>(getJumpOperationPrefixCodeByName(keyword)),
-            identifier, identifiersTable);
-    return instruction;
+    instruction = Instruction::jump(prefixCode, _identifiers.intern(identifier.begin, identifier.length));
+    return true;
 }
 
-Instruction * InstructionParser::getAddrInstruction(const std::string &keyword, std::string argument,
-                                                    std::ostream &logsStream) {
+bool InstructionParser::getAddrInstruction(const std::string &keyword, const Token &argument,
+                                           Instruction &instruction) {
     assert(keyword == "push" || keyword == "pop");
-    assert(argument.size() > 1);
-    assert(argument[0] == '[' && argument.back() == ']');
+    assert(argument.length > 1);
+    assert(argument.begin[0] == '[' && argument.begin[argument.length - 1] == ']');
 
-    argument = argument.substr(1, argument.size() - 2);
+    const char *inner = argument.begin + 1;
+    int innerLength = argument.length - 2;
+    //No register name is a number, so registers are looked up first
+    int registerCode = getRegCodeByName(inner, innerLength);
     int address = -1;
-    try {
-        address = std::stoi(argument);
-        if (address < 0) {
-            logsStream << "Invalid argument of " << keyword << " command!" << std::endl;
-            Instruction *instruction = new Instruction;
-            return instruction;
-        }
-    } catch (std::invalid_argument &e) {
+    bool negative;
+    long long magnitude;
+    if (registerCode < 0 && tryGetExactNumber(inner, innerLength, false, MAX_EXACT_ADDRESS_DIGITS, negative,
+                                              magnitude)) {
+        address = magnitude;
+    } else if (registerCode < 0) {
+        try {
+            address = std::stoi(std::string(inner, innerLength));
+            if (address < 0) {
+                _logsStream << "Invalid argument of " << keyword << " command!" << std::endl;
+                return false;
+            }
+        } catch (std::invalid_argument &e) {
 
-    } catch (std::out_of_range &e) {
-        //will never occur in our test examples
-        logsStream << "Invalid argument of " << keyword << " command!" << std::endl;
-        Instruction *instruction = new Instruction;
-        return instruction;
+        } catch (std::out_of_range &e) {
+            //will never occur in our test examples
+            _logsStream << "Invalid argument of " << keyword << " command!" << std::endl;
+            return false;
+        }
     }
 
     if (address > -1) {
         OperationPrefixCode prefixCode = OperationPrefixCode::POP_EXACT_ADDR;
         if (keyword == "push")
             prefixCode = OperationPrefixCode::PUSH_EXACT_ADDR;
-        Instruction *instruction =
-                new UnaryInstruction(prefixCode, reinterpret_cast<char *>(&address), sizeof (int));
-        return instruction;
+        instruction = Instruction::unary(prefixCode, &address, sizeof (int));
+        return true;
     }
 
-    int registerCode = getRegCodeByName(argument);
+    if (innerLength >= 2 && inner[0] == 'f' && inner[1] == 'p')
+        return getFrameSlotInstruction(keyword, std::string(inner + 2, innerLength - 2), instruction);
+
     if (registerCode < 0) {
-        logsStream << "Invalid register in " << keyword << " command!" << std::endl;
-        return new Instruction;
+        _logsStream << "Invalid register in " << keyword << " command!" << std::endl;
+        return false;
     }
 
     OperationPrefixCode prefixCode = OperationPrefixCode::POP_REG_ADDR;
     if (keyword == "push")
         prefixCode = OperationPrefixCode::PUSH_REG_ADDR;
+    instruction = Instruction::unary(prefixCode, &registerCode, 1);
+    return true;
+}
 
-    Instruction *instruction =
-            new UnaryInstruction(prefixCode, reinterpret_cast<char *>(&registerCode), 1);
-    return instruction;
+bool InstructionParser::getFrameSlotInstruction(const std::string &keyword, const std::string &offset,
+                                                Instruction &instruction) {
+    int slot = 0;
+    if (!offset.empty()) {
+        size_t parsed = 0;
+        try {
+            if (offset[0] == '+' || offset[0] == '-')
+                slot = std::stoi(offset, &parsed);
+        } catch (std::logic_error &e) {
+            parsed = 0;
+        }
+        //Sign is required and nothing may follow the number
+        if (parsed < 2 || parsed != offset.size()) {
+            _logsStream << "Invalid frame slot in " << keyword << " command!" << std::endl;
+            return false;
+        }
+    }
+
+    OperationPrefixCode prefixCode = OperationPrefixCode::POP_FRAME_SLOT;
+    if (keyword == "push")
+        prefixCode = OperationPrefixCode::PUSH_FRAME_SLOT;
+    instruction = Instruction::unary(prefixCode, &slot, sizeof (int));
+    return true;
 }
 
-Instruction * InstructionParser::getValInstruction(const std::string &keyword, const std::string &argument,
-                                                   std::ostream &logsStream) {
-    if (keyword == "push") {
+bool InstructionParser::getValInstruction(const std::string &keyword, const Token &argument,
+                                          Instruction &instruction) {
+    int regCode = getRegCodeByName(argument.begin, argument.length);
+    if (keyword == "push" && regCode < 0) {
         double val = std::numeric_limits<double>::quiet_NaN();
         bool valInit = false;
-        try {
-            val = std::stod(argument);
+        bool negative;
+        long long magnitude;
+        if (tryGetExactNumber(argument.begin, argument.length, true, MAX_EXACT_VALUE_DIGITS, negative, magnitude)) {
+            //-0 gives a negative zero, as strtod does
+            val = negative ? -static_cast<double>(magnitude) : static_cast<double>(magnitude);
             valInit = true;
-        } catch (std::invalid_argument &e) {
-
-        } catch (std::out_of_range &e) {
-            //Will never occur in our test examples
-            logsStream << "Invalid argument in " << keyword << " command!" << std::endl;
-            return new Instruction;
+        } else {
+            try {
+                val = std::stod(std::string(argument.begin, argument.length));
+                valInit = true;
+            } catch (std::invalid_argument &e) {
+
+            } catch (std::out_of_range &e) {
+                //Will never occur in our test examples
+                _logsStream << "Invalid argument in " << keyword << " command!" << std::endl;
+                return false;
+            }
         }
 
         if (valInit) {
-            Instruction *instruction =
-                    new UnaryInstruction(OperationPrefixCode::PUSH_EXACT_VAL,
-                                         reinterpret_cast<char*>(&val), sizeof (double ));
-            return instruction;
+            instruction = Instruction::unary(OperationPrefixCode::PUSH_EXACT_VAL, &val, sizeof (double));
+            return true;
         }
     }
 
-    int regCode = getRegCodeByName(argument);
     if (regCode < 0) {
-        logsStream << "Invalid register in " << keyword << " command!" << std::endl;
-        return new Instruction;
+        _logsStream << "Invalid register in " << keyword << " command!" << std::endl;
+        return false;
     }
 
     OperationPrefixCode prefixCode = OperationPrefixCode::PUSH_REG_VAL;
     if (keyword == "pop")
         prefixCode = OperationPrefixCode::POP_REG_VAL;
-    return new UnaryInstruction(prefixCode, reinterpret_cast<char*>(&regCode), 1);
+    instruction = Instruction::unary(prefixCode, &regCode, 1);
+    return true;
 }
 
-Instruction * InstructionParser::getUnaryInstruction(std::istream &in, std::ostream &logsStream, std::string keyword) {
+bool InstructionParser::getUnaryInstruction(const std::string &keyword, Instruction &instruction) {
     assert(keyword == "push" || keyword == "pop");
 
-    std::string argument;
-    in >> argument;
-
-    if (argument.empty()) {
-        logsStream << "Command argument cannot be empty!" << std::endl;
-        Instruction *instruction = new Instruction;
-        return instruction;
+    Token argument;
+    if (!_lexer.next(argument)) {
+        _logsStream << "Command argument cannot be empty!" << std::endl;
+        return false;
     }
 
-    if (argument[0] == '[' && argument.back() == ']')
-        return getAddrInstruction(keyword, argument, logsStream);
+    if (argument.begin[0] == '[' && argument.begin[argument.length - 1] == ']')
+        return getAddrInstruction(keyword, argument, instruction);
 
-    return getValInstruction(keyword, argument, logsStream);
+    return getValInstruction(keyword, argument, instruction);
 }
 
-bool InstructionParser::isLabel(const std::string &identifier) {
-    if (identifier.empty())
+bool InstructionParser::getIntegerInstruction(Instruction &instruction) {
+    Token token;
+    std::string argument;
+    if (_lexer.next(token))
+        argument.assign(token.begin, token.length);
+
+    size_t digits = !argument.empty() && argument[0] == '-' ? 1 : 0;
+    int base = argument.compare(digits, 2, "0x") == 0 ? 16 : 10;
+    size_t parsed = 0;
+    DoubleLl value;
+    try {
+        value.ll_val = std::stoll(argument, &parsed, base);
+    } catch (std::logic_error &e) {
+        parsed = 0;
+    }
+    if (parsed == 0 || parsed != argument.size()) {
+        _logsStream << "Invalid argument in ipush command!" << std::endl;
         return false;
-    return identifier.back() == ':';
+    }
+
+    instruction = Instruction::unary(OperationPrefixCode::PUSH_EXACT_VAL, &value.db_val, sizeof (double));
+    return true;
 }
 
-Instruction * InstructionParser::getLabelInstruction(std::ostream &logsStream, std::string identifier) {
-    assert(isLabel(identifier));
-    identifier.pop_back();
+bool InstructionParser::getLabelInstruction(const Token &keyword, Instruction &instruction) {
+    assert(keyword.begin[keyword.length - 1] == ':');
 
-    if (identifier.empty()) {
-        logsStream << "Command argument cannot be empty!" << std::endl;
-        return new Instruction;
+    if (keyword.length == 1) {
+        _logsStream << "Command argument cannot be empty!" << std::endl;
+        return false;
     }
 
-    return new LabelInstruction(identifier);
-}
-
-Instruction * InstructionParser::getInstruction(std::istream &in,
-                                                std::unordered_map<std::string, int> &identifiersTable,
-                                                std::ostream &logsStream) {
-    std::string keyword;
-    in >> keyword;
-    if (getNoArgsOperationCodeByName(keyword) != -1) {
-        Instruction *instruction = getNoArgsInstructionByName(keyword);
-        return instruction;
-    } else if (getJumpOperationPrefixCodeByName(keyword) != -1) {
-        Instruction *instruction = getJumpInstruction(in, logsStream, keyword, identifiersTable);
-        return instruction;
-    } else if (keyword == "push" || keyword == "pop") {
-        Instruction *instruction = getUnaryInstruction(in, logsStream, keyword);
-        return instruction;
-    } else if (isLabel(keyword)) {
-        Instruction *instruction = getLabelInstruction(logsStream, keyword);
-        return instruction;
-    } else {
-        Instruction *instruction = new Instruction;
-        return instruction;
+    instruction = Instruction::label(_identifiers.intern(keyword.begin, keyword.length - 1));
+    return true;
+}
+
+bool InstructionParser::getDirective(const Token &keyword) {
+    SymbolBinding binding;
+    if (keyword.length == 7 && std::memcmp(keyword.begin, ".global", 7) == 0)
+        binding = GLOBAL_SYMBOL;
+    else if (keyword.length == 7 && std::memcmp(keyword.begin, ".extern", 7) == 0)
+        binding = EXTERN_SYMBOL;
+    else
+        return false;
+
+    Token name;
+    if (!_lexer.next(name)) {
+        _logsStream << "Label cannot be empty!" << std::endl;
+        return false;
     }
+    int identifier = _identifiers.intern(name.begin, name.length);
+    SymbolBinding current = _identifiers.getBinding(identifier);
+    if (current != LOCAL_SYMBOL && current != binding) {
+        _logsStream << "Label " << _identifiers.getName(identifier) << " cannot be both global and extern!"
+                    << std::endl;
+        return false;
+    }
+    _identifiers.setBinding(identifier, binding);
+    return true;
 }
 
-void Assembler::freeInstructions() {
-    for (Instruction* val : _instructions)
-        delete val;
-    _instructions.clear();
+bool InstructionParser::getInstruction(Instruction &instruction) {
+    Token keyword;
+    if (!_lexer.next(keyword))
+        return false;
+    //Directives take no place in the code, the instruction after them is returned
+    while (keyword.begin[0] == '.' && keyword.begin[keyword.length - 1] != ':') {
+        if (!getDirective(keyword) || !_lexer.next(keyword))
+            return false;
+    }
+
+    const Mnemonic *mnemonic = MnemonicTable::find(keyword);
+    if (mnemonic) {
+        switch (mnemonic->kind) {
+            case NO_ARGS_MNEMONIC:
+                instruction = Instruction::noArgs(static_cast<OperationPrefixCode>(mnemonic->prefixCode));
+                return true;
+            case JUMP_MNEMONIC:
+                return getJumpInstruction(static_cast<OperationPrefixCode>(mnemonic->prefixCode), instruction);
+            case PUSH_MNEMONIC:
+                return getUnaryInstruction("push", instruction);
+            case POP_MNEMONIC:
+                return getUnaryInstruction("pop", instruction);
+            case IPUSH_MNEMONIC:
+                return getIntegerInstruction(instruction);
+        }
+    }
+    if (keyword.begin[keyword.length - 1] == ':')
+        return getLabelInstruction(keyword, instruction);
+    return false;
 }
 
 void Assembler::prepareLabels() {
     int curAddr = 0;
-    for (Instruction* val : _instructions) {
-        if (LabelInstruction *v = dynamic_cast<LabelInstruction *>(val)) {
-            _identifiersTable[v->getIdentifier()] = curAddr;
-        }
-        curAddr += val->getOperationSize();
+    for (const Instruction &val : _instructions) {
+        if (val.kind == LABEL_INSTRUCTION)
+            _identifiers.setAddress(val.identifier, curAddr);
+        curAddr += val.getOperationSize();
     }
 }
 
-Assembler::Assembler(std::istream &in, std::ostream &out, std::ostream &logs): _in(in), _out(out),
-    _assemblerLogsStream(logs) {
+std::vector<int> Assembler::getLabelIndices() {
+    std::vector<int> labelIndices(_identifiers.getCount(), -1);
+    for (int i = 0; i < static_cast<int>(_instructions.size()); i++) {
+        if (_instructions[i].kind == LABEL_INSTRUCTION)
+            labelIndices[_instructions[i].identifier] = i;
+    }
+    return labelIndices;
 }
 
-bool Assembler::assembleAll() {
-    _identifiersTable.clear();
-    freeInstructions();
-    _instructions.reserve(1000);
+int Assembler::skipLabels(int index) {
+    int count = _instructions.size();
+    while (index < count && _instructions[index].kind == LABEL_INSTRUCTION)
+        index++;
+    return index < count ? index : -1;
+}
+
+bool Assembler::isReturn(int index, const std::vector<int> &labelIndices) {
+    //Chains of jumps are followed a few times at most, they may loop
+    for (int hops = 0; hops < 8; hops++) {
+        index = skipLabels(index);
+        if (index < 0)
+            return false;
+        const Instruction &instruction = _instructions[index];
+        if (instruction.kind == NO_ARGS_INSTRUCTION)
+            return instruction.prefixCode == OperationPrefixCode::RET_ABS;
+        if (!instruction.is(JUMP_INSTRUCTION, OperationPrefixCode::JMP_OFFSET_EXACT_VAL))
+            return false;
+        index = labelIndices[instruction.identifier];
+        if (index < 0)
+            return false;
+    }
+    return false;
+}
 
-    while (!_in.eof()) {
-        Instruction *instruction = InstructionParser::getInstruction(_in, _identifiersTable, _assemblerLogsStream);
+bool Assembler::usesFrameSlots() {
+    for (const Instruction &val : _instructions) {
+        if (val.is(UNARY_INSTRUCTION, OperationPrefixCode::PUSH_FRAME_SLOT) ||
+            val.is(UNARY_INSTRUCTION, OperationPrefixCode::POP_FRAME_SLOT))
+            return true;
+    }
+    return false;
+}
+
+void Assembler::eliminateTailCalls() {
+    //Only call sets up a frame, a jump would leave the callee in the frame of its caller
+    bool keepCalls = usesFrameSlots();
+    std::vector<int> labelIndices = getLabelIndices();
+
+    for (int i = 0; i < static_cast<int>(_instructions.size()); i++) {
+        Instruction &jump = _instructions[i];
+        if (jump.kind != JUMP_INSTRUCTION)
+            continue;
 
-        if (instruction->getStatus() == InstructionStatus::FAILED) {
-            delete instruction;
-            break;
+        //Calls to other modules are kept, the callee may use frame slots
+        if (jump.prefixCode == OperationPrefixCode::CALL_OFFSET_EXACT_VAL && !keepCalls &&
+            labelIndices[jump.identifier] >= 0 && isReturn(i + 1, labelIndices)) {
+            //The ret after the call is kept, it may be a jump target
+            jump.prefixCode = OperationPrefixCode::JMP_OFFSET_EXACT_VAL;
+            _tailCallCount++;
+        } else if (jump.prefixCode == OperationPrefixCode::JMP_OFFSET_EXACT_VAL) {
+            int label = labelIndices[jump.identifier];
+            if (label >= 0 && isReturn(label, labelIndices)) {
+                jump = Instruction::noArgs(OperationPrefixCode::RET_ABS);
+                _tailCallCount++;
+            }
         }
+    }
+}
+
+Assembler::Assembler(const char *begin, const char *end, std::ostream &out, std::ostream &logs): _begin(begin),
+    _end(end), _out(out), _assemblerLogsStream(logs), _tailCallEliminationEnabled(true), _tailCallCount(0),
+    _optimizationLevel(1), _rawOutput(false), _symbolTableEnabled(true) {
+}
+
+void Assembler::setRawOutput(bool raw) {
+    _rawOutput = raw;
+}
+
+void Assembler::setEntryLabel(const std::string &label) {
+    _entryLabel = label;
+}
+
+void Assembler::setSymbolTableEnabled(bool enabled) {
+    _symbolTableEnabled = enabled;
+}
 
+void Assembler::setTailCallEliminationEnabled(bool enabled) {
+    _tailCallEliminationEnabled = enabled;
+}
+
+int Assembler::getTailCallCount() {
+    return _tailCallCount;
+}
+
+void Assembler::setOptimizationLevel(int level) {
+    _optimizationLevel = level;
+}
+
+const std::vector<PassStatistics> &Assembler::getOptimizationStatistics() {
+    return _optimizationStatistics;
+}
+
+void Assembler::prepareInstructions() {
+    _identifiers.clear();
+    _instructions.clear();
+    //An instruction takes a few bytes of source at least
+    _instructions.reserve((_end - _begin) / 8 + 16);
+
+    InstructionParser parser(_begin, _end, _identifiers, _assemblerLogsStream);
+    Instruction instruction;
+    while (parser.getInstruction(instruction))
         _instructions.push_back(instruction);
+
+    _tailCallCount = 0;
+    if (_tailCallEliminationEnabled)
+        eliminateTailCalls();
+
+    Optimizer optimizer(_instructions, _identifiers);
+    if (!_entryLabel.empty())
+        optimizer.setEntryLabel(_identifiers.intern(_entryLabel.data(), _entryLabel.size()));
+    optimizer.run(_optimizationLevel);
+    _optimizationStatistics = optimizer.getStatistics();
+}
+
+void Assembler::poolConstants(std::vector<double> &constants) {
+    //Equal bits share an entry, so -0.0 and 0.0 or NaNs with different payloads stay apart
+    std::unordered_map<unsigned long long, int> indices;
+    for (Instruction &instruction : _instructions) {
+        if (!instruction.is(UNARY_INSTRUCTION, OperationPrefixCode::PUSH_EXACT_VAL))
+            continue;
+        DoubleUll value;
+        std::memcpy(&value.ull_val, instruction.argument, sizeof (double));
+        auto inserted = indices.insert({value.ull_val, static_cast<int>(constants.size())});
+        if (inserted.second)
+            constants.push_back(value.db_val);
+        instruction = Instruction::unary(OperationPrefixCode::PUSH_CONST, &inserted.first->second, sizeof (int));
     }
+}
 
-    prepareLabels();
+bool Assembler::generateCode(std::vector<char> &code, ObjectFile *object) {
+    size_t codeSize = 0;
+    for (const Instruction &curInst : _instructions)
+        codeSize += curInst.getOperationSize();
+    code.assign(codeSize, 0);
+    //Import index of every extern label, -1 until a jump refers to it
+    std::vector<int> imports(object ? _identifiers.getCount() : 0, -1);
 
     int curAddr = 0;
-    char buf[20];
-    for (Instruction* curInst : _instructions) {
-        if (LabelInstruction *v = dynamic_cast<LabelInstruction *>(curInst))
-            continue;
-        bool success = curInst->tryGetOperationCode(buf, 20, curAddr);
-        if (!success) {
-            _assemblerLogsStream << "Cannot generate code!" << std::endl;
-            freeInstructions();
+    for (const Instruction &curInst : _instructions) {
+        char *buf = code.data() + curAddr;
+        switch (curInst.kind) {
+            case LABEL_INSTRUCTION:
+                continue;
+            case NO_ARGS_INSTRUCTION:
+                buf[0] = static_cast<char>(curInst.prefixCode);
+                break;
+            case UNARY_INSTRUCTION:
+                buf[0] = static_cast<char>(curInst.prefixCode);
+                std::memcpy(buf + 1, curInst.argument, curInst.argumentSize);
+                break;
+            case JUMP_INSTRUCTION: {
+                int labelAddress = _identifiers.getAddress(curInst.identifier);
+                buf[0] = static_cast<char>(curInst.prefixCode);
+                if (labelAddress >= 0) {
+                    int offset = labelAddress - curAddr;
+                    std::memcpy(buf + 1, &offset, sizeof (int));
+                    break;
+                }
+                if (!object) {
+                    _assemblerLogsStream << "Cannot generate code!" << std::endl;
+                    return false;
+                }
+                if (_identifiers.getBinding(curInst.identifier) != EXTERN_SYMBOL) {
+                    _assemblerLogsStream << "Label " << _identifiers.getName(curInst.identifier)
+                                         << " is not defined!" << std::endl;
+                    return false;
+                }
+                int &import = imports[curInst.identifier];
+                if (import < 0) {
+                    import = object->imports.size();
+                    object->imports.push_back(_identifiers.getName(curInst.identifier));
+                }
+                object->relocations.push_back({curAddr, import});
+                break;
+            }
+        }
+        curAddr += curInst.getOperationSize();
+    }
+    return true;
+}
+
+bool Assembler::assembleAll() {
+    prepareInstructions();
+    ExecutableFile program;
+    if (!_rawOutput)
+        poolConstants(program.constants);
+    prepareLabels();
+
+    if (!generateCode(program.code, nullptr))
+        return false;
+    if (!_entryLabel.empty()) {
+        program.entry = _identifiers.getAddress(_identifiers.intern(_entryLabel.data(), _entryLabel.size()));
+        if (program.entry < 0) {
+            _assemblerLogsStream << "Label " << _entryLabel << " is not defined!" << std::endl;
             return false;
         }
-        _out.write(buf, curInst->getOperationSize());
-        curAddr += curInst->getOperationSize();
     }
+    if (_symbolTableEnabled) {
+        for (int identifier = 0; identifier < _identifiers.getCount(); identifier++) {
+            if (_identifiers.getAddress(identifier) >= 0)
+                program.symbols.push_back({_identifiers.getName(identifier), _identifiers.getAddress(identifier)});
+        }
+        std::stable_sort(program.symbols.begin(), program.symbols.end(),
+                         [](const ObjectSymbol &a, const ObjectSymbol &b) { return a.address < b.address; });
+    }
+    program.write(_out, _rawOutput);
+    return true;
+}
+
+bool Assembler::assembleObject(ObjectFile &object) {
+    object.clear();
+    prepareInstructions();
+    prepareLabels();
 
+    if (!generateCode(object.code, &object))
+        return false;
+    for (int identifier = 0; identifier < _identifiers.getCount(); identifier++) {
+        if (_identifiers.getBinding(identifier) != GLOBAL_SYMBOL)
+            continue;
+        if (_identifiers.getAddress(identifier) < 0) {
+            _assemblerLogsStream << "Label " << _identifiers.getName(identifier) << " is global but not defined!"
+                                 << std::endl;
+            return false;
+        }
+        object.exports.push_back({_identifiers.getName(identifier), _identifiers.getAddress(identifier)});
+    }
     return true;
-}
\ No newline at end of file
+}
@@ -5,153 +5,213 @@
 #ifndef STACK_PROCESSOR_ASSEMBLER_H
 #define STACK_PROCESSOR_ASSEMBLER_H
 
-#include <unordered_map>
+#include <string>
+#include <iostream>
 #include <vector>
 #include "../utils.h"
+#include "Lexer.h"
+#include "ExecutableFile.h"
+#include "ObjectFile.h"
+
+enum InstructionKind : unsigned char {
+    LABEL_INSTRUCTION = 0,
+    NO_ARGS_INSTRUCTION,
+    UNARY_INSTRUCTION,
+    JUMP_INSTRUCTION
+};
 
-enum InstructionStatus {
-        OK = 0,
-        FAILED
+//Instruction of the source stored by value. Labels and jumps refer to their identifier by its index
+//in the IdentifierTable, unary instructions keep the bytes of their operand
+struct Instruction {
+    InstructionKind kind;
+    unsigned char prefixCode;
+    unsigned char argumentSize;
+    char argument[8];
+    int identifier;
+
+    static Instruction label(int identifier);
+
+    static Instruction noArgs(OperationPrefixCode prefixCode);
+
+    static Instruction unary(OperationPrefixCode prefixCode, const void *argument, int argumentSize);
+
+    static Instruction jump(OperationPrefixCode prefixCode, int identifier);
+
+    int getOperationSize() const {
+        switch (kind) {
+            case NO_ARGS_INSTRUCTION:
+                return 1;
+            case UNARY_INSTRUCTION:
+                return 1 + argumentSize;
+            case JUMP_INSTRUCTION:
+                return 1 + sizeof (int);
+            default:
+                return 0;
+        }
+    }
+
+    bool is(InstructionKind instructionKind, OperationPrefixCode code) const {
+        return kind == instructionKind && prefixCode == code;
+    }
 };
 
-class Instruction {
-protected:
-    InstructionStatus _status;
+//Instructions one optimization pass rewrote and removed
+struct PassStatistics {
+    std::string name;
+    int rewritten;
+    int removed;
+};
 
-public:
-    Instruction();
+//Labels are local to the source unless .global exports them to other modules or .extern declares
+//them defined in another module
+enum SymbolBinding : unsigned char {
+    LOCAL_SYMBOL = 0,
+    GLOBAL_SYMBOL,
+    EXTERN_SYMBOL
+};
 
-    InstructionStatus getStatus();
+//Names of labels and jump targets, every name gets an index once. Addresses are set when labels are
+//placed, the last definition of a label wins
+class IdentifierTable {
+private:
+    std::vector<std::string> _names;
+    std::vector<int> _addresses;
+    std::vector<SymbolBinding> _bindings;
+    //Open addressing over name hashes, an index + 1 or 0 for a free slot
+    std::vector<int> _slots;
 
-    //Not for labels
-    virtual bool tryGetOperationCode(char *buf, int bufSize, int instructionAddress = 0);
+    static unsigned int hash(const char *name, int length);
 
-    virtual int getOperationSize();
+    void grow();
 
-    //For labels and jumps only
-    virtual std::string getIdentifier();
+public:
+    IdentifierTable();
 
-    virtual ~Instruction() {}
-};
+    int intern(const char *name, int length);
 
-class JumpInstruction : public Instruction {
-private:
-    std::unordered_map<std::string, int> &_identifiersTable;
-    std::string _argumentIdentifier;
-    OperationPrefixCode _prefixCode;
+    int getCount() const;
 
-    friend class InstructionFactory;
+    const std::string &getName(int identifier) const;
 
-public:
-    JumpInstruction(OperationPrefixCode prefixCode, std::string &argumentIdentifier,
-                    std::unordered_map<std::string, int> &identifiersTable);
+    //-1 if no label defines the identifier
+    int getAddress(int identifier) const;
 
-    bool tryGetOperationCode(char *buf, int bufSize, int instructionAddress) override;
+    void setAddress(int identifier, int address);
 
-    int getOperationSize() override;
+    SymbolBinding getBinding(int identifier) const;
 
-    std::string getIdentifier() override;
+    void setBinding(int identifier, SymbolBinding binding);
 
-    virtual ~JumpInstruction() {}
+    void clear();
 };
 
-class LabelInstruction : public Instruction {
+class InstructionParser {
 private:
-    std::string _identifier;
+    Lexer _lexer;
+    IdentifierTable &_identifiers;
+    std::ostream &_logsStream;
 
-    friend class InstructionFactory;
+    bool getJumpInstruction(OperationPrefixCode prefixCode, Instruction &instruction);
 
-public:
+    bool getAddrInstruction(const std::string &keyword, const Token &argument, Instruction &instruction);
 
-    LabelInstruction(const std::string &identifier);
+    //offset is what follows fp in [fp], [fp+N] or [fp-N]
+    bool getFrameSlotInstruction(const std::string &keyword, const std::string &offset, Instruction &instruction);
 
-    std::string getIdentifier();
+    bool getValInstruction(const std::string &keyword, const Token &argument, Instruction &instruction);
 
-    virtual ~LabelInstruction() {}
+    bool getUnaryInstruction(const std::string &keyword, Instruction &instruction);
 
-};
+    //ipush with a decimal or 0x hexadecimal 64-bit integer, pushed as the bits of the stack value
+    bool getIntegerInstruction(Instruction &instruction);
 
-class NoArgsInstruction : public Instruction {
-private:
-    OperationPrefixCode _prefixCode;
-public:
-    NoArgsInstruction(OperationPrefixCode prefixCode);
-
-    bool tryGetOperationCode(char *buf, int bufSize, int instructionAddress) override;
-
-    int getOperationSize() override;
-
-    virtual ~NoArgsInstruction() {}
-};
+    bool getLabelInstruction(const Token &keyword, Instruction &instruction);
 
-class UnaryInstruction : public Instruction {
-private:
-    OperationPrefixCode _prefixCode;
-    char _operationArgument[8];
-    int _argumentSize;
+    //.global name or .extern name, false for any other word starting with a dot
+    bool getDirective(const Token &keyword);
 
 public:
-    UnaryInstruction(OperationPrefixCode prefixCode, char *operationArgument, int argumentSize);
-
-    bool tryGetOperationCode(char *buf, int bufSize, int instructionAddress) override;
-
-    int getOperationSize() override;
+    InstructionParser(const char *begin, const char *end, IdentifierTable &identifiers, std::ostream &logsStream);
 
-    virtual ~UnaryInstruction() {}
+    //False at the end of the source and at the first instruction that cannot be parsed
+    bool getInstruction(Instruction &instruction);
 
+    static int getRegCodeByName(const char *name, int length);
 };
 
-class InstructionParser {
+class Assembler {
 private:
+    const char *_begin;
+    const char *_end;
+    std::ostream &_out;
+    std::ostream &_assemblerLogsStream;
+    IdentifierTable _identifiers;
+    std::vector<Instruction> _instructions;
+    bool _tailCallEliminationEnabled;
+    int _tailCallCount;
+    int _optimizationLevel;
+    std::vector<PassStatistics> _optimizationStatistics;
+    bool _rawOutput;
+    std::string _entryLabel;
+    bool _symbolTableEnabled;
 
-    static int getRegCodeByName(const std::string &name);
-
-    static int getNoArgsOperationCodeByName(const std::string &name);
+    void prepareLabels();
 
-    static int getJumpOperationPrefixCodeByName(const std::string &name);
+    //Instruction index of every label, -1 for identifiers no label defines
+    std::vector<int> getLabelIndices();
 
-    static Instruction *getNoArgsInstructionByName(const std::string &name);
+    //Index of the first instruction that is not a label at or after index, -1 if there is none
+    int skipLabels(int index);
 
-    static Instruction *getJumpInstruction(std::istream &in, std::ostream &logsStream, std::string keyword,
-                                           std::unordered_map<std::string, int> &identifiersTable);
+    bool isReturn(int index, const std::vector<int> &labelIndices);
 
-    static Instruction *getAddrInstruction(const std::string &keyword, std::string argument,
-                                           std::ostream &logsStream);
+    bool usesFrameSlots();
 
-    static Instruction *getValInstruction(const std::string &keyword, const std::string &argument,
-                                          std::ostream &logsStream);
+    //Turns calls followed by ret into jumps and jumps to ret into ret
+    void eliminateTailCalls();
 
-    static Instruction *getUnaryInstruction(std::istream &in, std::ostream &logsStream, std::string keyword);
+    //Parses and optimizes the source
+    void prepareInstructions();
 
-    static bool isLabel(const std::string &identifier);
+    //Turns every push of a constant into PUSH_CONST of its pool entry, before labels are placed
+    void poolConstants(std::vector<double> &constants);
 
-    static Instruction *getLabelInstruction(std::ostream &logsStream, std::string identifier);
+    //Jumps to extern labels get a zero offset and a relocation when object is given, without it
+    //every label has to be defined
+    bool generateCode(std::vector<char> &code, ObjectFile *object);
 
 public:
+    //The source is read in place and has to outlive assembleAll
+    Assembler(const char *begin, const char *end, std::ostream &out, std::ostream &logs);
 
-    //Returns pointer. It is needed to perform delete on this pointer since you don't need it anymore
-    static Instruction *getInstruction(std::istream &in, std::unordered_map<std::string, int> &identifiersTable,
-                                       std::ostream &logsStream);
+    //Enabled by default
+    void setTailCallEliminationEnabled(bool enabled);
 
-};
+    //Instructions rewritten by tail call elimination during the last assembleAll
+    int getTailCallCount();
 
-class Assembler {
-private:
-    std::istream &_in;
-    std::ostream &_out;
-    std::ostream &_assemblerLogsStream;
-    std::unordered_map<std::string, int> _identifiersTable;
-    std::vector<Instruction *> _instructions;
+    //0 keeps the instructions as written, 1 by default, 2 optimizes the most
+    void setOptimizationLevel(int level);
 
-    void freeInstructions();
+    //What every optimization pass did during the last assembleAll
+    const std::vector<PassStatistics> &getOptimizationStatistics();
 
-    void prepareLabels();
+    //Writes the code alone without header, constant pool and symbols, as earlier versions did
+    void setRawOutput(bool raw);
 
-public:
-    Assembler(std::istream &in, std::ostream &out, std::ostream &logs);
+    //Execution starts at this label instead of the first instruction, ignored by raw output
+    void setEntryLabel(const std::string &label);
 
+    //Labels and their addresses are written for profiles and diagnostics, enabled by default
+    void setSymbolTableEnabled(bool enabled);
+
+    //The executable is written at once, nothing is written if it cannot be generated
     bool assembleAll();
 
+    //Relocatable module for asm-link, nothing is written. False if a jump refers to a label that is
+    //neither defined nor extern or a global label is not defined
+    bool assembleObject(ObjectFile &object);
+
 };
 
 
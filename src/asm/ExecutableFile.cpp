@@ -0,0 +1,31 @@
+#include "ExecutableFile.h"
+#include "../utils.h"
+#include <cstring>
+
+void ExecutableFile::write(std::ostream &out, bool raw) const {
+    if (raw) {
+        out.write(code.data(), code.size());
+        return;
+    }
+
+    //The header size keeps the constant pool aligned, the code follows it
+    ExecutableHeader header = {};
+    std::memcpy(header.magic, EXECUTABLE_MAGIC, sizeof (header.magic));
+    header.version = EXECUTABLE_VERSION;
+    header.entry = entry;
+    header.constantsOffset = sizeof (header);
+    header.constantCount = constants.size();
+    header.codeOffset = header.constantsOffset + constants.size() * sizeof (double);
+    header.codeSize = code.size();
+    header.symbolsOffset = header.codeOffset + header.codeSize;
+    header.symbolCount = symbols.size();
+
+    out.write(reinterpret_cast<const char *>(&header), sizeof (header));
+    out.write(reinterpret_cast<const char *>(constants.data()), constants.size() * sizeof (double));
+    out.write(code.data(), code.size());
+    for (const ObjectSymbol &symbol : symbols) {
+        int fields[2] = {symbol.address, static_cast<int>(symbol.name.size())};
+        out.write(reinterpret_cast<const char *>(fields), sizeof (fields));
+        out.write(symbol.name.data(), symbol.name.size());
+    }
+}
@@ -0,0 +1,20 @@
+#ifndef STACK_PROCESSOR_EXECUTABLE_FILE_H
+#define STACK_PROCESSOR_EXECUTABLE_FILE_H
+
+#include <iostream>
+#include <vector>
+#include "ObjectFile.h"
+
+//Program written by asm and asm-link in the layout of ExecutableHeader
+struct ExecutableFile {
+    std::vector<char> code;
+    std::vector<double> constants;
+    int entry = 0;
+    std::vector<ObjectSymbol> symbols;
+
+    //Raw output is the code alone, as earlier versions wrote it. It cannot refer to constants and
+    //starts at offset 0
+    void write(std::ostream &out, bool raw) const;
+};
+
+#endif //STACK_PROCESSOR_EXECUTABLE_FILE_H
@@ -0,0 +1,92 @@
+#include "Lexer.h"
+#include "../utils.h"
+#include <cstring>
+#include <cassert>
+
+static const Mnemonic MNEMONICS[] = {
+    {"add", 3, NO_ARGS_MNEMONIC, OperationPrefixCode::ADD},
+    {"sub", 3, NO_ARGS_MNEMONIC, OperationPrefixCode::SUB},
+    {"mul", 3, NO_ARGS_MNEMONIC, OperationPrefixCode::MUL},
+    {"div", 3, NO_ARGS_MNEMONIC, OperationPrefixCode::DIV},
+    {"sin", 3, NO_ARGS_MNEMONIC, OperationPrefixCode::SIN},
+    {"cos", 3, NO_ARGS_MNEMONIC, OperationPrefixCode::COS},
+    {"sqrt", 4, NO_ARGS_MNEMONIC, OperationPrefixCode::SQRT},
+    {"in", 2, NO_ARGS_MNEMONIC, OperationPrefixCode::IN},
+    {"out", 3, NO_ARGS_MNEMONIC, OperationPrefixCode::OUT},
+    {"ret", 3, NO_ARGS_MNEMONIC, OperationPrefixCode::RET_ABS},
+    {"popd", 4, NO_ARGS_MNEMONIC, OperationPrefixCode::POP},
+    {"halt", 4, NO_ARGS_MNEMONIC, OperationPrefixCode::HALT},
+    {"vadd", 4, NO_ARGS_MNEMONIC, OperationPrefixCode::VADD},
+    {"vmul", 4, NO_ARGS_MNEMONIC, OperationPrefixCode::VMUL},
+    {"vfma", 4, NO_ARGS_MNEMONIC, OperationPrefixCode::VFMA},
+    {"vsum", 4, NO_ARGS_MNEMONIC, OperationPrefixCode::VSUM},
+    {"vmin", 4, NO_ARGS_MNEMONIC, OperationPrefixCode::VMIN},
+    {"vmax", 4, NO_ARGS_MNEMONIC, OperationPrefixCode::VMAX},
+    {"vdot", 4, NO_ARGS_MNEMONIC, OperationPrefixCode::VDOT},
+    {"vfill", 5, NO_ARGS_MNEMONIC, OperationPrefixCode::VFILL},
+    {"vcopy", 5, NO_ARGS_MNEMONIC, OperationPrefixCode::VCOPY},
+    {"iadd", 4, NO_ARGS_MNEMONIC, OperationPrefixCode::IADD},
+    {"isub", 4, NO_ARGS_MNEMONIC, OperationPrefixCode::ISUB},
+    {"imul", 4, NO_ARGS_MNEMONIC, OperationPrefixCode::IMUL},
+    {"idiv", 4, NO_ARGS_MNEMONIC, OperationPrefixCode::IDIV},
+    {"irem", 4, NO_ARGS_MNEMONIC, OperationPrefixCode::IREM},
+    {"iand", 4, NO_ARGS_MNEMONIC, OperationPrefixCode::IAND},
+    {"ior", 3, NO_ARGS_MNEMONIC, OperationPrefixCode::IOR},
+    {"ixor", 4, NO_ARGS_MNEMONIC, OperationPrefixCode::IXOR},
+    {"ishl", 4, NO_ARGS_MNEMONIC, OperationPrefixCode::ISHL},
+    {"ishr", 4, NO_ARGS_MNEMONIC, OperationPrefixCode::ISHR},
+    {"itod", 4, NO_ARGS_MNEMONIC, OperationPrefixCode::ITOD},
+    {"dtoi", 4, NO_ARGS_MNEMONIC, OperationPrefixCode::DTOI},
+    {"jmp", 3, JUMP_MNEMONIC, OperationPrefixCode::JMP_OFFSET_EXACT_VAL},
+    {"je", 2, JUMP_MNEMONIC, OperationPrefixCode::JE_OFFSET_EXACT_VAL},
+    {"jne", 3, JUMP_MNEMONIC, OperationPrefixCode::JNE_OFFSET_EXACT_VAL},
+    {"ja", 2, JUMP_MNEMONIC, OperationPrefixCode::JA_OFFSET_EXACT_VAL},
+    {"jae", 3, JUMP_MNEMONIC, OperationPrefixCode::JAE_OFFSET_EXACT_VAL},
+    {"jb", 2, JUMP_MNEMONIC, OperationPrefixCode::JB_OFFSET_EXACT_VAL},
+    {"jbe", 3, JUMP_MNEMONIC, OperationPrefixCode::JBE_OFFSET_EXACT_VAL},
+    {"call", 4, JUMP_MNEMONIC, OperationPrefixCode::CALL_OFFSET_EXACT_VAL},
+    {"ije", 3, JUMP_MNEMONIC, OperationPrefixCode::IJE_OFFSET_EXACT_VAL},
+    {"ijne", 4, JUMP_MNEMONIC, OperationPrefixCode::IJNE_OFFSET_EXACT_VAL},
+    {"ija", 3, JUMP_MNEMONIC, OperationPrefixCode::IJA_OFFSET_EXACT_VAL},
+    {"ijae", 4, JUMP_MNEMONIC, OperationPrefixCode::IJAE_OFFSET_EXACT_VAL},
+    {"ijb", 3, JUMP_MNEMONIC, OperationPrefixCode::IJB_OFFSET_EXACT_VAL},
+    {"ijbe", 4, JUMP_MNEMONIC, OperationPrefixCode::IJBE_OFFSET_EXACT_VAL},
+    {"push", 4, PUSH_MNEMONIC, 0},
+    {"pop", 3, POP_MNEMONIC, 0},
+    {"ipush", 5, IPUSH_MNEMONIC, 0}
+};
+
+Lexer::Lexer(const char *begin, const char *end): _current(begin), _end(end) {
+}
+
+MnemonicTable::MnemonicTable(): _seed(0) {
+    while (!tryFill(_seed))
+        _seed++;
+}
+
+bool MnemonicTable::tryFill(unsigned int seed) {
+    std::memset(_slots, 0, sizeof (_slots));
+    for (const Mnemonic &mnemonic : MNEMONICS) {
+        assert(mnemonic.length == static_cast<int>(std::strlen(mnemonic.name)) && mnemonic.length <= MAX_LENGTH);
+        unsigned int slot = hash(seed, mnemonic.name, mnemonic.length);
+        if (_slots[slot])
+            return false;
+        _slots[slot] = &mnemonic;
+    }
+    return true;
+}
+
+const MnemonicTable &MnemonicTable::getInstance() {
+    static const MnemonicTable table;
+    return table;
+}
+
+const Mnemonic *MnemonicTable::find(const Token &token) {
+    if (token.length > MAX_LENGTH)
+        return nullptr;
+    const MnemonicTable &table = getInstance();
+    const Mnemonic *mnemonic = table._slots[hash(table._seed, token.begin, token.length)];
+    if (!mnemonic || mnemonic->length != token.length || std::memcmp(mnemonic->name, token.begin, token.length) != 0)
+        return nullptr;
+    return mnemonic;
+}
@@ -0,0 +1,84 @@
+#ifndef STACK_PROCESSOR_LEXER_H
+#define STACK_PROCESSOR_LEXER_H
+
+#include <cstddef>
+
+//Whitespace separated word of the source, it points into the source buffer
+struct Token {
+    const char *begin;
+    int length;
+};
+
+//Splits the source into words the way std::istream >> std::string does in the C locale
+class Lexer {
+private:
+    const char *_current;
+    const char *_end;
+
+public:
+    Lexer(const char *begin, const char *end);
+
+    //False at the end of the source
+    bool next(Token &token) {
+        while (_current < _end && isSpace(*_current))
+            _current++;
+        if (_current == _end)
+            return false;
+        token.begin = _current;
+        while (_current < _end && !isSpace(*_current))
+            _current++;
+        token.length = _current - token.begin;
+        return true;
+    }
+
+    static bool isSpace(char c) {
+        return c == ' ' || (c >= '\t' && c <= '\r');
+    }
+};
+
+enum MnemonicKind {
+    NO_ARGS_MNEMONIC = 0,
+    JUMP_MNEMONIC,
+    PUSH_MNEMONIC,
+    POP_MNEMONIC,
+    IPUSH_MNEMONIC
+};
+
+struct Mnemonic {
+    const char *name;
+    int length;
+    MnemonicKind kind;
+    //Opcode of no argument instructions and jumps
+    unsigned char prefixCode;
+};
+
+//Perfect hash of the mnemonics. The seed is searched once so that no two mnemonics share a slot, a
+//lookup hashes the word and compares it with the one mnemonic in its slot
+class MnemonicTable {
+private:
+    static const int TABLE_BITS = 8;
+    static const int TABLE_SIZE = 1 << TABLE_BITS;
+    static const int MAX_LENGTH = 5;
+
+    const Mnemonic *_slots[TABLE_SIZE];
+    unsigned int _seed;
+
+    MnemonicTable();
+
+    static unsigned int hash(unsigned int seed, const char *begin, int length) {
+        unsigned int value = seed ^ static_cast<unsigned int>(length);
+        for (int i = 0; i < length; i++)
+            value = (value ^ static_cast<unsigned char>(begin[i])) * 16777619u;
+        return value >> (32 - TABLE_BITS);
+    }
+
+    bool tryFill(unsigned int seed);
+
+    static const MnemonicTable &getInstance();
+
+public:
+    //nullptr if the word is not a mnemonic
+    static const Mnemonic *find(const Token &token);
+};
+
+#endif //STACK_PROCESSOR_LEXER_H
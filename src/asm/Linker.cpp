@@ -0,0 +1,61 @@
+#include "Linker.h"
+#include <cstring>
+#include <unordered_map>
+
+//Where a global label ended up in the program
+struct LinkedSymbol {
+    int address;
+    int module;
+};
+
+Linker::Linker(std::ostream &logs): _logsStream(logs) {
+}
+
+bool Linker::link(const std::vector<ObjectFile> &modules, const std::vector<std::string> &names,
+                  ExecutableFile &program) {
+    std::vector<char> &code = program.code;
+    std::vector<int> bases(modules.size());
+    size_t codeSize = 0;
+    for (size_t module = 0; module < modules.size(); module++) {
+        bases[module] = codeSize;
+        codeSize += modules[module].code.size();
+    }
+
+    std::unordered_map<std::string, LinkedSymbol> symbols;
+    for (size_t module = 0; module < modules.size(); module++) {
+        for (const ObjectSymbol &symbol : modules[module].exports) {
+            auto inserted = symbols.insert({symbol.name, {bases[module] + symbol.address, static_cast<int>(module)}});
+            if (!inserted.second) {
+                _logsStream << "Label " << symbol.name << " is defined in " << names[inserted.first->second.module]
+                            << " and " << names[module] << "!" << std::endl;
+                return false;
+            }
+            program.symbols.push_back({symbol.name, bases[module] + symbol.address});
+        }
+    }
+
+    code.resize(codeSize);
+    for (size_t module = 0; module < modules.size(); module++) {
+        const ObjectFile &object = modules[module];
+        char *moduleCode = code.data() + bases[module];
+        if (!object.code.empty())
+            std::memcpy(moduleCode, object.code.data(), object.code.size());
+
+        //Imports of a module are resolved once, relocations only index them
+        std::vector<int> importAddresses(object.imports.size());
+        for (size_t import = 0; import < object.imports.size(); import++) {
+            auto symbol = symbols.find(object.imports[import]);
+            if (symbol == symbols.end()) {
+                _logsStream << "Label " << object.imports[import] << " used in " << names[module]
+                            << " is not defined!" << std::endl;
+                return false;
+            }
+            importAddresses[import] = symbol->second.address;
+        }
+        for (const Relocation &relocation : object.relocations) {
+            int offset = importAddresses[relocation.import] - (bases[module] + relocation.position);
+            std::memcpy(moduleCode + relocation.position + 1, &offset, sizeof (int));
+        }
+    }
+    return true;
+}
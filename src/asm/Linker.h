@@ -0,0 +1,25 @@
+#ifndef STACK_PROCESSOR_LINKER_H
+#define STACK_PROCESSOR_LINKER_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include "ExecutableFile.h"
+#include "ObjectFile.h"
+
+//Places modules one after another and sets the offsets of jumps to extern labels. The program starts
+//at the first instruction of the first module unless another entry is set
+class Linker {
+private:
+    std::ostream &_logsStream;
+
+public:
+    explicit Linker(std::ostream &logs);
+
+    //names of the modules are used in messages. The global labels become the symbols of the program.
+    //False if a global label is defined by two modules or an extern label by none
+    bool link(const std::vector<ObjectFile> &modules, const std::vector<std::string> &names,
+              ExecutableFile &program);
+};
+
+#endif //STACK_PROCESSOR_LINKER_H
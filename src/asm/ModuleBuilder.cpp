@@ -0,0 +1,101 @@
+#include "ModuleBuilder.h"
+#include "Assembler.h"
+#include "SourceFile.h"
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+ModuleBuilder::ModuleBuilder(int threads): _threads(threads), _force(false), _tailCallEliminationEnabled(true),
+    _optimizationLevel(1), _jobs(nullptr), _next(0) {
+}
+
+void ModuleBuilder::setForce(bool force) {
+    _force = force;
+}
+
+void ModuleBuilder::setTailCallEliminationEnabled(bool enabled) {
+    _tailCallEliminationEnabled = enabled;
+}
+
+void ModuleBuilder::setOptimizationLevel(int level) {
+    _optimizationLevel = level;
+}
+
+std::string ModuleBuilder::getStampKey() const {
+    return "-O" + std::to_string(_optimizationLevel) + (_tailCallEliminationEnabled ? "" : " --no-tail-calls");
+}
+
+std::string ModuleBuilder::getObjectPath(const std::string &source) {
+    size_t length = source.size();
+    if (length > 4 && source.compare(length - 4, 4, ".asm") == 0)
+        return source.substr(0, length - 4) + ".o";
+    return source + ".o";
+}
+
+void ModuleBuilder::buildModule(ModuleJob &job) {
+    std::ostringstream logs;
+    SourceFile source;
+    ObjectFile object;
+    if (!source.open(job.source.c_str())) {
+        logs << "Cannot open source file!" << std::endl;
+    } else {
+        //assembleObject writes nothing to out
+        std::ostringstream out;
+        Assembler assembler(source.begin(), source.end(), out, logs);
+        assembler.setTailCallEliminationEnabled(_tailCallEliminationEnabled);
+        assembler.setOptimizationLevel(_optimizationLevel);
+        job.assembled = assembler.assembleObject(object);
+    }
+
+    if (job.assembled) {
+        std::ofstream file(job.object, std::ios_base::binary | std::ios_base::out);
+        object.write(file);
+        file.close();
+        if (!file) {
+            logs << "Cannot write object file!" << std::endl;
+            job.assembled = false;
+        }
+    }
+    if (job.assembled)
+        SourceFile::writeStamp(job.object, getStampKey());
+    else
+        std::remove(job.object.c_str());
+    job.logs = logs.str();
+}
+
+void ModuleBuilder::runWorker() {
+    int count = _jobs->size();
+    for (int index = _next++; index < count; index = _next++) {
+        ModuleJob &job = (*_jobs)[index];
+        if (!job.upToDate)
+            buildModule(job);
+    }
+}
+
+bool ModuleBuilder::build(std::vector<ModuleJob> &jobs) {
+    int pending = 0;
+    for (ModuleJob &job : jobs) {
+        job.upToDate = !_force && SourceFile::isUpToDate(job.object, {job.source}, getStampKey());
+        job.assembled = false;
+        job.logs.clear();
+        pending += job.upToDate ? 0 : 1;
+    }
+
+    //The calling thread is a worker too
+    _jobs = &jobs;
+    _next = 0;
+    std::vector<std::thread> workers;
+    for (int i = 1; i < _threads && i < pending; i++)
+        workers.emplace_back(&ModuleBuilder::runWorker, this);
+    runWorker();
+    for (std::thread &worker : workers)
+        worker.join();
+    _jobs = nullptr;
+
+    for (const ModuleJob &job : jobs) {
+        if (!job.upToDate && !job.assembled)
+            return false;
+    }
+    return true;
+}
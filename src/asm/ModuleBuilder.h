@@ -0,0 +1,54 @@
+#ifndef STACK_PROCESSOR_MODULE_BUILDER_H
+#define STACK_PROCESSOR_MODULE_BUILDER_H
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+//One source assembled into one object file
+struct ModuleJob {
+    std::string source;
+    std::string object;
+    bool upToDate;
+    bool assembled;
+    //Messages of the assembler, printed in the order of the modules once all are done
+    std::string logs;
+};
+
+//Assembles the modules whose object file is missing, older than the source or assembled with other
+//options, several at once
+class ModuleBuilder {
+private:
+    int _threads;
+    bool _force;
+    bool _tailCallEliminationEnabled;
+    int _optimizationLevel;
+
+    std::vector<ModuleJob> *_jobs;
+    std::atomic<int> _next;
+
+    //Options an object file is assembled with, one built with others is assembled again
+    std::string getStampKey() const;
+
+    void buildModule(ModuleJob &job);
+
+    void runWorker();
+
+public:
+    explicit ModuleBuilder(int threads);
+
+    //Every module is assembled, up to date or not
+    void setForce(bool force);
+
+    void setTailCallEliminationEnabled(bool enabled);
+
+    void setOptimizationLevel(int level);
+
+    //Object file name of a source, foo.asm gives foo.o
+    static std::string getObjectPath(const std::string &source);
+
+    //False if a module could not be assembled, its object file is removed so the next build retries it
+    bool build(std::vector<ModuleJob> &jobs);
+};
+
+#endif //STACK_PROCESSOR_MODULE_BUILDER_H
@@ -0,0 +1,102 @@
+#include "ObjectFile.h"
+#include <cstring>
+
+const char ObjectFile::MAGIC[4] = {'S', 'P', 'O', 'B'};
+
+static void writeInt(std::ostream &out, int value) {
+    out.write(reinterpret_cast<const char *>(&value), sizeof (int));
+}
+
+static void writeName(std::ostream &out, const std::string &name) {
+    writeInt(out, name.size());
+    out.write(name.data(), name.size());
+}
+
+//Reads from cur and moves it on, false if the bytes end before
+static bool readInt(const char *&cur, const char *end, int &value) {
+    if (end - cur < static_cast<long>(sizeof (int)))
+        return false;
+    std::memcpy(&value, cur, sizeof (int));
+    cur += sizeof (int);
+    return true;
+}
+
+static bool readName(const char *&cur, const char *end, std::string &name) {
+    int length;
+    if (!readInt(cur, end, length) || length <= 0 || end - cur < length)
+        return false;
+    name.assign(cur, length);
+    cur += length;
+    return true;
+}
+
+void ObjectFile::clear() {
+    code.clear();
+    exports.clear();
+    imports.clear();
+    relocations.clear();
+}
+
+void ObjectFile::write(std::ostream &out) const {
+    out.write(MAGIC, sizeof (MAGIC));
+    writeInt(out, VERSION);
+    writeInt(out, code.size());
+    writeInt(out, exports.size());
+    writeInt(out, imports.size());
+    writeInt(out, relocations.size());
+    out.write(code.data(), code.size());
+    for (const ObjectSymbol &symbol : exports) {
+        writeName(out, symbol.name);
+        writeInt(out, symbol.address);
+    }
+    for (const std::string &name : imports)
+        writeName(out, name);
+    for (const Relocation &relocation : relocations) {
+        writeInt(out, relocation.position);
+        writeInt(out, relocation.import);
+    }
+}
+
+bool ObjectFile::read(const char *begin, const char *end) {
+    clear();
+    const char *cur = begin;
+    if (end - cur < static_cast<long>(sizeof (MAGIC)) || std::memcmp(cur, MAGIC, sizeof (MAGIC)) != 0)
+        return false;
+    cur += sizeof (MAGIC);
+
+    int version, codeSize, exportCount, importCount, relocationCount;
+    if (!readInt(cur, end, version) || version != VERSION || !readInt(cur, end, codeSize) ||
+        !readInt(cur, end, exportCount) || !readInt(cur, end, importCount) ||
+        !readInt(cur, end, relocationCount))
+        return false;
+    if (codeSize < 0 || exportCount < 0 || importCount < 0 || relocationCount < 0 || end - cur < codeSize)
+        return false;
+    code.assign(cur, cur + codeSize);
+    cur += codeSize;
+
+    //Entries are read one by one, a damaged count runs into the end of the bytes instead of allocating
+    for (int i = 0; i < exportCount; i++) {
+        ObjectSymbol symbol;
+        if (!readName(cur, end, symbol.name) || !readInt(cur, end, symbol.address) ||
+            symbol.address < 0 || symbol.address > codeSize)
+            return false;
+        exports.push_back(symbol);
+    }
+    for (int i = 0; i < importCount; i++) {
+        std::string name;
+        if (!readName(cur, end, name))
+            return false;
+        imports.push_back(name);
+    }
+    for (int i = 0; i < relocationCount; i++) {
+        Relocation relocation;
+        if (!readInt(cur, end, relocation.position) || !readInt(cur, end, relocation.import))
+            return false;
+        //The offset of a jump follows its opcode
+        if (relocation.position < 0 || relocation.position > codeSize - 1 - static_cast<int>(sizeof (int)) ||
+            relocation.import < 0 || relocation.import >= importCount)
+            return false;
+        relocations.push_back(relocation);
+    }
+    return cur == end;
+}
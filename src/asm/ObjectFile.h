@@ -0,0 +1,42 @@
+#ifndef STACK_PROCESSOR_OBJECT_FILE_H
+#define STACK_PROCESSOR_OBJECT_FILE_H
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+//Global label of a module, the address is relative to the start of its code
+struct ObjectSymbol {
+    std::string name;
+    int address;
+};
+
+//Jump or call at position whose offset the linker sets to reach the extern label imports[import]
+struct Relocation {
+    int position;
+    int import;
+};
+
+//Module assembled by asm -c and placed into a program by asm-link. Jumps between labels of the
+//module are relative and stay valid wherever it is placed, only jumps to extern labels are relocated.
+//Layout: magic, version, code size, export, import and relocation counts as ints, then the code,
+//exports as name length, name and address, imports as name length and name and relocations as
+//position and import index
+struct ObjectFile {
+    static const char MAGIC[4];
+    static const int VERSION = 1;
+
+    std::vector<char> code;
+    std::vector<ObjectSymbol> exports;
+    std::vector<std::string> imports;
+    std::vector<Relocation> relocations;
+
+    void clear();
+
+    void write(std::ostream &out) const;
+
+    //False if the bytes are not a well-formed object file of this version
+    bool read(const char *begin, const char *end);
+};
+
+#endif //STACK_PROCESSOR_OBJECT_FILE_H
@@ -0,0 +1,416 @@
+#include "Optimizer.h"
+#include "../processor/IntegerOperations.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+//Rounds of level 2 passes, chains of folds and jumps settle in a few
+static const int MAX_ROUNDS = 16;
+//Chains of jumps are followed a few times at most, they may loop
+static const int MAX_JUMP_HOPS = 8;
+
+//Execution never continues with the next instruction
+static bool endsFlow(const Instruction &instruction) {
+    return instruction.is(NO_ARGS_INSTRUCTION, OperationPrefixCode::RET_ABS) ||
+           instruction.is(NO_ARGS_INSTRUCTION, OperationPrefixCode::HALT) ||
+           instruction.is(JUMP_INSTRUCTION, OperationPrefixCode::JMP_OFFSET_EXACT_VAL);
+}
+
+static bool getConstant(const Instruction &instruction, double &value) {
+    if (!instruction.is(UNARY_INSTRUCTION, OperationPrefixCode::PUSH_EXACT_VAL))
+        return false;
+    std::memcpy(&value, instruction.argument, sizeof (double));
+    return true;
+}
+
+//Values an operation the assembler can fold pops, 0 for the others
+static int getFoldedOperandCount(const Instruction &instruction) {
+    if (instruction.kind != NO_ARGS_INSTRUCTION)
+        return 0;
+    switch (instruction.prefixCode) {
+        case OperationPrefixCode::ADD:
+        case OperationPrefixCode::SUB:
+        case OperationPrefixCode::MUL:
+        case OperationPrefixCode::DIV:
+            return 2;
+        case OperationPrefixCode::SIN:
+        case OperationPrefixCode::COS:
+        case OperationPrefixCode::SQRT:
+        case OperationPrefixCode::ITOD:
+        case OperationPrefixCode::DTOI:
+            return 1;
+        default:
+            return IntegerOperations::isIntegerOperation(instruction.prefixCode) ? 2 : 0;
+    }
+}
+
+//Computes what the processor would, false when the operation stops the program instead
+static bool fold(unsigned char prefixCode, const double *operands, double &result) {
+    switch (prefixCode) {
+        case OperationPrefixCode::ADD:
+            result = operands[0] + operands[1];
+            return true;
+        case OperationPrefixCode::SUB:
+            result = operands[0] - operands[1];
+            return true;
+        case OperationPrefixCode::MUL:
+            result = operands[0] * operands[1];
+            return true;
+        case OperationPrefixCode::DIV:
+            result = operands[0] / operands[1];
+            return true;
+        case OperationPrefixCode::SIN:
+            result = std::sin(operands[0]);
+            return true;
+        case OperationPrefixCode::COS:
+            result = std::cos(operands[0]);
+            return true;
+        case OperationPrefixCode::SQRT:
+            result = std::sqrt(operands[0]);
+            return true;
+        case OperationPrefixCode::ITOD:
+            result = static_cast<double>(IntegerOperations::getBits(operands[0]));
+            return true;
+        case OperationPrefixCode::DTOI:
+            result = IntegerOperations::fromBits(IntegerOperations::truncate(operands[0]));
+            return true;
+        default: {
+            long long value;
+            if (!IntegerOperations::apply(prefixCode, IntegerOperations::getBits(operands[0]),
+                                          IntegerOperations::getBits(operands[1]), value))
+                return false;
+            result = IntegerOperations::fromBits(value);
+            return true;
+        }
+    }
+}
+
+//The push is undone by the pop right after it
+static bool cancels(const Instruction &push, const Instruction &pop) {
+    if (pop.is(NO_ARGS_INSTRUCTION, OperationPrefixCode::POP))
+        return push.is(UNARY_INSTRUCTION, OperationPrefixCode::PUSH_EXACT_VAL) ||
+               push.is(UNARY_INSTRUCTION, OperationPrefixCode::PUSH_REG_VAL);
+    return pop.is(UNARY_INSTRUCTION, OperationPrefixCode::POP_REG_VAL) &&
+           push.is(UNARY_INSTRUCTION, OperationPrefixCode::PUSH_REG_VAL) && pop.argument[0] == push.argument[0];
+}
+
+Optimizer::Optimizer(std::vector<Instruction> &instructions, IdentifierTable &identifiers):
+    _instructions(instructions), _identifiers(identifiers), _entryLabel(-1) {
+}
+
+void Optimizer::setEntryLabel(int identifier) {
+    _entryLabel = identifier;
+}
+
+bool Optimizer::isEntryPoint(int identifier) {
+    return identifier == _entryLabel || _identifiers.getBinding(identifier) == GLOBAL_SYMBOL;
+}
+
+std::vector<int> Optimizer::getLabelIndices() {
+    std::vector<int> labelIndices(_identifiers.getCount(), -1);
+    for (int i = 0; i < static_cast<int>(_instructions.size()); i++) {
+        if (_instructions[i].kind == LABEL_INSTRUCTION)
+            labelIndices[_instructions[i].identifier] = i;
+    }
+    return labelIndices;
+}
+
+std::vector<BasicBlock> Optimizer::getBasicBlocks() {
+    std::vector<BasicBlock> blocks;
+    int count = _instructions.size();
+    int begin = 0;
+    bool hasCode = false;
+    for (int i = 0; i < count; i++) {
+        const Instruction &instruction = _instructions[i];
+        if (instruction.kind == LABEL_INSTRUCTION) {
+            if (hasCode) {
+                blocks.push_back({begin, i});
+                begin = i;
+                hasCode = false;
+            }
+            continue;
+        }
+        hasCode = true;
+        if (endsFlow(instruction) || instruction.kind == JUMP_INSTRUCTION) {
+            blocks.push_back({begin, i + 1});
+            begin = i + 1;
+            hasCode = false;
+        }
+    }
+    if (begin < count)
+        blocks.push_back({begin, count});
+    return blocks;
+}
+
+bool Optimizer::hasAllLabels() {
+    std::vector<int> labelIndices = getLabelIndices();
+    for (const Instruction &instruction : _instructions) {
+        if (instruction.kind == JUMP_INSTRUCTION && labelIndices[instruction.identifier] < 0 &&
+            _identifiers.getBinding(instruction.identifier) != EXTERN_SYMBOL)
+            return false;
+    }
+    return true;
+}
+
+PassStatistics &Optimizer::getPassStatistics(const std::string &name) {
+    for (PassStatistics &statistics : _statistics) {
+        if (statistics.name == name)
+            return statistics;
+    }
+    _statistics.push_back({name, 0, 0});
+    return _statistics.back();
+}
+
+void Optimizer::compact(const std::vector<bool> &removed) {
+    int kept = 0;
+    for (int i = 0; i < static_cast<int>(_instructions.size()); i++) {
+        if (!removed[i])
+            _instructions[kept++] = _instructions[i];
+    }
+    _instructions.resize(kept);
+}
+
+bool Optimizer::foldConstants() {
+    PassStatistics &statistics = getPassStatistics("constant folding");
+    int kept = 0;
+    bool changed = false;
+
+    //Folded instructions are written over in place. Labels are kept, so the pushes an operation
+    //folds are always in its own block
+    for (int i = 0; i < static_cast<int>(_instructions.size()); i++) {
+        const Instruction instruction = _instructions[i];
+        int count = getFoldedOperandCount(instruction);
+        bool constant = count > 0 && kept >= count;
+        double operands[2];
+        for (int k = 0; constant && k < count; k++)
+            constant = getConstant(_instructions[kept - count + k], operands[k]);
+
+        double value;
+        if (!constant || !fold(instruction.prefixCode, operands, value)) {
+            _instructions[kept++] = instruction;
+            continue;
+        }
+        kept -= count;
+        _instructions[kept++] = Instruction::unary(OperationPrefixCode::PUSH_EXACT_VAL, &value, sizeof (double));
+        statistics.rewritten++;
+        statistics.removed += count;
+        changed = true;
+    }
+
+    _instructions.resize(kept);
+    return changed;
+}
+
+bool Optimizer::cancelPushPop() {
+    PassStatistics &statistics = getPassStatistics("push and pop cancelling");
+    int kept = 0;
+    bool changed = false;
+
+    for (int i = 0; i < static_cast<int>(_instructions.size()); i++) {
+        if (kept == 0 || !cancels(_instructions[kept - 1], _instructions[i])) {
+            _instructions[kept++] = _instructions[i];
+            continue;
+        }
+        kept--;
+        statistics.removed += 2;
+        changed = true;
+    }
+
+    _instructions.resize(kept);
+    return changed;
+}
+
+bool Optimizer::removeCodeAfterJumps() {
+    PassStatistics &statistics = getPassStatistics("code after jumps");
+    std::vector<bool> removed(_instructions.size(), false);
+    bool dead = false;
+    bool changed = false;
+    for (int i = 0; i < static_cast<int>(_instructions.size()); i++) {
+        if (_instructions[i].kind == LABEL_INSTRUCTION) {
+            dead = false;
+        } else if (dead) {
+            removed[i] = true;
+            statistics.removed++;
+            changed = true;
+        } else {
+            dead = endsFlow(_instructions[i]);
+        }
+    }
+    compact(removed);
+    return changed;
+}
+
+bool Optimizer::removeJumpsToNext() {
+    PassStatistics &statistics = getPassStatistics("jumps to next instruction");
+    std::vector<int> labelIndices = getLabelIndices();
+    std::vector<bool> removed(_instructions.size(), false);
+    int count = _instructions.size();
+    bool changed = false;
+
+    //Conditional jumps do not pop either, but they check the stack when the program is not verified
+    for (int i = 0; i < count; i++) {
+        if (!_instructions[i].is(JUMP_INSTRUCTION, OperationPrefixCode::JMP_OFFSET_EXACT_VAL))
+            continue;
+        int target = labelIndices[_instructions[i].identifier];
+        int next = i + 1;
+        while (next < target && _instructions[next].kind == LABEL_INSTRUCTION)
+            next++;
+        if (next != target)
+            continue;
+        removed[i] = true;
+        statistics.removed++;
+        changed = true;
+    }
+
+    compact(removed);
+    return changed;
+}
+
+bool Optimizer::threadJumps() {
+    PassStatistics &statistics = getPassStatistics("jump threading");
+    std::vector<int> labelIndices = getLabelIndices();
+    int count = _instructions.size();
+    bool changed = false;
+
+    for (int i = 0; i < count; i++) {
+        Instruction &jump = _instructions[i];
+        if (jump.kind != JUMP_INSTRUCTION)
+            continue;
+
+        int target = jump.identifier;
+        for (int hops = 0; hops < MAX_JUMP_HOPS; hops++) {
+            //Extern labels are placed by the linker
+            int next = labelIndices[target];
+            if (next < 0)
+                break;
+            while (next < count && _instructions[next].kind == LABEL_INSTRUCTION)
+                next++;
+            if (next == count || !_instructions[next].is(JUMP_INSTRUCTION, OperationPrefixCode::JMP_OFFSET_EXACT_VAL) ||
+                _instructions[next].identifier == target)
+                break;
+            target = _instructions[next].identifier;
+        }
+        if (target == jump.identifier)
+            continue;
+
+        jump.identifier = target;
+        statistics.rewritten++;
+        changed = true;
+    }
+    return changed;
+}
+
+bool Optimizer::removeUnreachableBlocks() {
+    PassStatistics &statistics = getPassStatistics("unreachable blocks");
+    std::vector<BasicBlock> blocks = getBasicBlocks();
+    if (blocks.empty())
+        return false;
+    std::vector<int> labelIndices = getLabelIndices();
+    std::vector<int> blockOf(_instructions.size());
+    for (int block = 0; block < static_cast<int>(blocks.size()); block++)
+        std::fill(blockOf.begin() + blocks[block].begin, blockOf.begin() + blocks[block].end, block);
+
+    //Other modules may jump to global labels, execution may start at the entry label
+    std::vector<bool> reachable(blocks.size(), false);
+    std::vector<int> worklist = {0};
+    reachable[0] = true;
+    for (int i = 0; i < static_cast<int>(_instructions.size()); i++) {
+        const Instruction &instruction = _instructions[i];
+        if (instruction.kind == LABEL_INSTRUCTION && isEntryPoint(instruction.identifier) && !reachable[blockOf[i]]) {
+            reachable[blockOf[i]] = true;
+            worklist.push_back(blockOf[i]);
+        }
+    }
+    while (!worklist.empty()) {
+        int block = worklist.back();
+        worklist.pop_back();
+        const Instruction &last = _instructions[blocks[block].end - 1];
+        int successors[2];
+        int successorCount = 0;
+        if (last.kind == JUMP_INSTRUCTION && labelIndices[last.identifier] >= 0)
+            successors[successorCount++] = blockOf[labelIndices[last.identifier]];
+        if (!endsFlow(last) && block + 1 < static_cast<int>(blocks.size()))
+            successors[successorCount++] = block + 1;
+        for (int k = 0; k < successorCount; k++) {
+            if (!reachable[successors[k]]) {
+                reachable[successors[k]] = true;
+                worklist.push_back(successors[k]);
+            }
+        }
+    }
+
+    std::vector<bool> removed(_instructions.size(), false);
+    bool changed = false;
+    for (int block = 0; block < static_cast<int>(blocks.size()); block++) {
+        if (reachable[block])
+            continue;
+        for (int i = blocks[block].begin; i < blocks[block].end; i++) {
+            if (_instructions[i].kind != LABEL_INSTRUCTION)
+                statistics.removed++;
+            removed[i] = true;
+        }
+        changed = true;
+    }
+    compact(removed);
+    return changed;
+}
+
+bool Optimizer::removeUnusedLabels() {
+    std::vector<bool> used(_identifiers.getCount(), false);
+    for (const Instruction &instruction : _instructions) {
+        if (instruction.kind == JUMP_INSTRUCTION ||
+            (instruction.kind == LABEL_INSTRUCTION && isEntryPoint(instruction.identifier)))
+            used[instruction.identifier] = true;
+    }
+    std::vector<int> labelIndices = getLabelIndices();
+
+    //Labels are not counted, they take no space in the bytecode
+    std::vector<bool> removed(_instructions.size(), false);
+    bool changed = false;
+    for (int i = 0; i < static_cast<int>(_instructions.size()); i++) {
+        const Instruction &instruction = _instructions[i];
+        if (instruction.kind != LABEL_INSTRUCTION ||
+            (used[instruction.identifier] && labelIndices[instruction.identifier] == i))
+            continue;
+        removed[i] = true;
+        changed = true;
+    }
+    compact(removed);
+    return changed;
+}
+
+void Optimizer::run(int level) {
+    _statistics.clear();
+    if (level <= 0 || !hasAllLabels())
+        return;
+
+    if (level >= 2)
+        getPassStatistics("jump threading");
+    getPassStatistics("jumps to next instruction");
+    getPassStatistics("code after jumps");
+    if (level >= 2)
+        getPassStatistics("unreachable blocks");
+    getPassStatistics("constant folding");
+    getPassStatistics("push and pop cancelling");
+
+    int rounds = level >= 2 ? MAX_ROUNDS : 1;
+    for (int round = 0; round < rounds; round++) {
+        bool changed = false;
+        if (level >= 2)
+            changed = threadJumps() || changed;
+        changed = removeJumpsToNext() || changed;
+        changed = removeCodeAfterJumps() || changed;
+        if (level >= 2) {
+            changed = removeUnreachableBlocks() || changed;
+            changed = removeUnusedLabels() || changed;
+        }
+        changed = foldConstants() || changed;
+        changed = cancelPushPop() || changed;
+        if (!changed)
+            break;
+    }
+}
+
+const std::vector<PassStatistics> &Optimizer::getStatistics() {
+    return _statistics;
+}
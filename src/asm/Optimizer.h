@@ -0,0 +1,69 @@
+#ifndef STACK_PROCESSOR_OPTIMIZER_H
+#define STACK_PROCESSOR_OPTIMIZER_H
+
+#include <vector>
+#include "Assembler.h"
+
+//Labels start a basic block, jumps, ret and halt end it
+struct BasicBlock {
+    int begin;
+    int end;
+};
+
+//Optimization pipeline over the parsed instructions, run before labels get their addresses.
+//Level 1 folds constant arithmetic, cancels values popped right after they are pushed and removes
+//code after jmp, ret and halt up to the next label and jumps to the next instruction. Level 2 also
+//threads jumps to jumps, removes blocks unreachable from the start and global labels and labels
+//nothing jumps to, and repeats the passes until they change nothing
+class Optimizer {
+private:
+    std::vector<Instruction> &_instructions;
+    IdentifierTable &_identifiers;
+    std::vector<PassStatistics> _statistics;
+    //Label execution starts at besides the first instruction, -1 if there is none
+    int _entryLabel;
+
+    //Global labels and the entry label, code may be entered there without a jump from this module
+    bool isEntryPoint(int identifier);
+
+    //Instruction index of every label, -1 for identifiers no label defines. The last definition of
+    //a label wins, as it does when labels get their addresses
+    std::vector<int> getLabelIndices();
+
+    std::vector<BasicBlock> getBasicBlocks();
+
+    //False if a jump refers to a label that is neither defined nor extern, code generation reports it
+    bool hasAllLabels();
+
+    PassStatistics &getPassStatistics(const std::string &name);
+
+    //Drops the instructions marked as removed
+    void compact(const std::vector<bool> &removed);
+
+    bool foldConstants();
+
+    bool cancelPushPop();
+
+    bool removeCodeAfterJumps();
+
+    bool removeJumpsToNext();
+
+    bool threadJumps();
+
+    bool removeUnreachableBlocks();
+
+    bool removeUnusedLabels();
+
+public:
+    Optimizer(std::vector<Instruction> &instructions, IdentifierTable &identifiers);
+
+    //Kept along with the code it starts, as global labels are
+    void setEntryLabel(int identifier);
+
+    //Level 0 keeps the instructions as written
+    void run(int level);
+
+    const std::vector<PassStatistics> &getStatistics();
+};
+
+#endif //STACK_PROCESSOR_OPTIMIZER_H
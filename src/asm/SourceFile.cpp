@@ -0,0 +1,81 @@
+#include "SourceFile.h"
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+SourceFile::SourceFile(): _mapping(nullptr), _mapping_size(0), _begin(nullptr), _end(nullptr) {
+}
+
+SourceFile::~SourceFile() {
+    if (_mapping != nullptr)
+        munmap(_mapping, _mapping_size);
+}
+
+bool SourceFile::open(const char *path) {
+    int file = ::open(path, O_RDONLY);
+    if (file < 0)
+        return false;
+
+    struct stat fileStat;
+    if (fstat(file, &fileStat) == 0 && S_ISREG(fileStat.st_mode) && fileStat.st_size > 0) {
+        void *ptr = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (ptr != MAP_FAILED) {
+            //The lexer reads the source front to back once
+            madvise(ptr, fileStat.st_size, MADV_SEQUENTIAL);
+            _mapping = ptr;
+            _mapping_size = fileStat.st_size;
+            _begin = static_cast<const char *>(ptr);
+            _end = _begin + _mapping_size;
+            close(file);
+            return true;
+        }
+    }
+
+    char buffer[1 << 16];
+    ssize_t count;
+    while ((count = read(file, buffer, sizeof (buffer))) > 0)
+        _contents.append(buffer, count);
+    close(file);
+    _begin = _contents.data();
+    _end = _begin + _contents.size();
+    return true;
+}
+
+const char *SourceFile::begin() const {
+    return _begin;
+}
+
+const char *SourceFile::end() const {
+    return _end;
+}
+
+//Modification time in nanoseconds, -1 if the file does not exist
+static long long getModificationTime(const std::string &path) {
+    struct stat fileStat;
+    if (stat(path.c_str(), &fileStat) != 0)
+        return -1;
+    return fileStat.st_mtim.tv_sec * 1000000000LL + fileStat.st_mtim.tv_nsec;
+}
+
+bool SourceFile::isUpToDate(const std::string &target, const std::vector<std::string> &sources,
+                            const std::string &key) {
+    long long targetTime = getModificationTime(target);
+    if (targetTime < 0)
+        return false;
+    for (const std::string &source : sources) {
+        long long sourceTime = getModificationTime(source);
+        if (sourceTime < 0 || sourceTime > targetTime)
+            return false;
+    }
+    SourceFile stamp;
+    return stamp.open((target + ".stamp").c_str()) && std::string(stamp.begin(), stamp.end()) == key;
+}
+
+bool SourceFile::writeStamp(const std::string &target, const std::string &key) {
+    std::ofstream stamp(target + ".stamp", std::ios_base::binary | std::ios_base::out);
+    stamp << key;
+    stamp.close();
+    return static_cast<bool>(stamp);
+}
@@ -0,0 +1,43 @@
+#ifndef STACK_PROCESSOR_SOURCEFILE_H
+#define STACK_PROCESSOR_SOURCEFILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+//Assembly source mapped into memory, files that cannot be mapped such as pipes are read instead
+class SourceFile {
+private:
+    void *_mapping;
+    size_t _mapping_size;
+    std::string _contents;
+    const char *_begin;
+    const char *_end;
+
+public:
+    SourceFile();
+
+    ~SourceFile();
+
+    SourceFile(const SourceFile&) = delete;
+
+    SourceFile &operator=(const SourceFile&) = delete;
+
+    //Returns false if the file cannot be opened, an empty file is valid
+    bool open(const char *path);
+
+    const char *begin() const;
+
+    const char *end() const;
+
+    //As make decides it: the target exists and none of the sources was modified after it. A source
+    //that does not exist counts as modified. The target also has to be built with the same key, the
+    //options and inputs that make it besides the sources, recorded by writeStamp
+    static bool isUpToDate(const std::string &target, const std::vector<std::string> &sources,
+                           const std::string &key);
+
+    //Keeps the key of a target that was just built in target.stamp, false if it cannot be written
+    static bool writeStamp(const std::string &target, const std::string &key);
+};
+
+#endif //STACK_PROCESSOR_SOURCEFILE_H
@@ -0,0 +1,27 @@
+#include "SourceGenerator.h"
+
+std::string SourceGenerator::generate(long long lines) {
+    static const char *const BODY[] = {
+        "push 2", "push ax", "add", "push 3.25", "mul", "pop bx", "push [16]", "push bx", "sub",
+        "pop [24]", "ipush 100", "ipush 0x1f", "iadd", "popd", "push -7", "push dx", "div", "pop cx"
+    };
+    const int bodySize = sizeof (BODY) / sizeof (BODY[0]);
+    std::string source;
+    source.reserve(lines * 10);
+    long long line = 0;
+    long long function = 0;
+    while (line < lines) {
+        std::string name = "function" + std::to_string(function++);
+        source += name + ":\n";
+        source += "loop_" + name + ":\n";
+        line += 2;
+        for (int i = 0; i < 64 && line < lines; i++, line++) {
+            source += BODY[i % bodySize];
+            source += '\n';
+        }
+        source += "push cx\npush 0\nja loop_" + name + "\ncall " + name + "\nret\n";
+        line += 5;
+    }
+    source += "halt\n";
+    return source;
+}
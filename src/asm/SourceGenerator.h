@@ -0,0 +1,13 @@
+#ifndef STACK_PROCESSOR_SOURCE_GENERATOR_H
+#define STACK_PROCESSOR_SOURCE_GENERATOR_H
+
+#include <string>
+
+class SourceGenerator {
+public:
+    //Source shaped like generated code: straight-line arithmetic on constants, registers and RAM split
+    //into functions with loops and calls. Assembles, it is not meant to be run
+    static std::string generate(long long lines);
+};
+
+#endif //STACK_PROCESSOR_SOURCE_GENERATOR_H
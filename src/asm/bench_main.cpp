@@ -0,0 +1,83 @@
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include "Assembler.h"
+#include "SourceFile.h"
+#include "SourceGenerator.h"
+
+int main(int argc, char *argv[]) {
+    long long lines = 2000000;
+    int runs = 5;
+    int optimizationLevel = 1;
+    const char *sourcePath = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strncmp(argv[i], "--lines=", 8) == 0) {
+            lines = std::atoll(argv[i] + 8);
+        } else if (std::strncmp(argv[i], "--runs=", 7) == 0) {
+            runs = std::atoi(argv[i] + 7);
+        } else if (std::strcmp(argv[i], "-O0") == 0 || std::strcmp(argv[i], "-O1") == 0 ||
+                   std::strcmp(argv[i], "-O2") == 0) {
+            optimizationLevel = argv[i][2] - '0';
+        } else if (std::strncmp(argv[i], "--source=", 9) == 0) {
+            sourcePath = argv[i] + 9;
+        } else {
+            std::cout << "Unknown option " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+    if (lines <= 0 || runs <= 0) {
+        std::cout << "Lines and runs should be positive!" << std::endl;
+        return 1;
+    }
+
+    SourceFile file;
+    std::string generated;
+    const char *begin;
+    const char *end;
+    if (sourcePath) {
+        if (!file.open(sourcePath)) {
+            std::cout << "Cannot open " << sourcePath << std::endl;
+            return 1;
+        }
+        begin = file.begin();
+        end = file.end();
+    } else {
+        generated = SourceGenerator::generate(lines);
+        begin = generated.data();
+        end = begin + generated.size();
+    }
+    long long sourceLines = 0;
+    for (const char *c = begin; c < end; c++)
+        sourceLines += *c == '\n';
+
+    //Best of the runs, the first one also faults the source in
+    double best = 0.0;
+    size_t codeSize = 0;
+    for (int run = 0; run < runs; run++) {
+        std::ostringstream out;
+        Assembler assembler(begin, end, out, std::clog);
+        assembler.setOptimizationLevel(optimizationLevel);
+        auto start = std::chrono::steady_clock::now();
+        bool success = assembler.assembleAll();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (!success) {
+            std::cout << "Assembly failed" << std::endl;
+            return 1;
+        }
+        codeSize = out.str().size();
+        if (run == 0 || seconds < best)
+            best = seconds;
+    }
+
+    std::cout << "lines: " << sourceLines << std::endl;
+    std::cout << "source bytes: " << (end - begin) << std::endl;
+    std::cout << "bytecode bytes: " << codeSize << std::endl;
+    std::cout << "seconds: " << best << std::endl;
+    std::cout << "lines per second: " << static_cast<long long>(sourceLines / best) << std::endl;
+    std::cout << "MB per second: " << (end - begin) / best / 1e6 << std::endl;
+    return 0;
+}
@@ -0,0 +1,93 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Linker.h"
+#include "SourceFile.h"
+
+int main(int argc, char *argv[]) {
+    std::vector<std::string> paths;
+    bool force = false;
+    bool raw = false;
+    bool symbolTable = true;
+    const char *entryLabel = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--force") == 0) {
+            force = true;
+        } else if (std::strcmp(argv[i], "--raw") == 0) {
+            raw = true;
+        } else if (std::strcmp(argv[i], "--no-symbols") == 0) {
+            symbolTable = false;
+        } else if (std::strncmp(argv[i], "--entry=", 8) == 0) {
+            entryLabel = argv[i] + 8;
+        } else if (argv[i][0] == '-' && argv[i][1] == '-') {
+            std::cout << "Unknown option " << argv[i] << std::endl;
+            return 0;
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+
+    if (paths.size() < 2) {
+        std::cout << "Usage: asm-link [options] object... output" << std::endl;
+        return 0;
+    }
+    std::string output = paths.back();
+    paths.pop_back();
+
+    //Relinked only when an object file changed since the program was written, or the modules or
+    //options are not the ones it was linked with
+    std::string key;
+    for (const std::string &path : paths)
+        key += path + "\n";
+    key += std::string(raw ? "--raw\n" : "") + (symbolTable ? "" : "--no-symbols\n");
+    if (entryLabel != nullptr)
+        key += std::string("--entry=") + entryLabel + "\n";
+    if (!force && SourceFile::isUpToDate(output, paths, key))
+        return 0;
+
+    std::vector<ObjectFile> modules(paths.size());
+    for (size_t i = 0; i < paths.size(); i++) {
+        SourceFile file;
+        if (!file.open(paths[i].c_str())) {
+            std::clog << "Cannot open " << paths[i] << "!" << std::endl;
+            return 1;
+        }
+        if (!modules[i].read(file.begin(), file.end())) {
+            std::clog << paths[i] << " is not an object file!" << std::endl;
+            return 1;
+        }
+    }
+
+    ExecutableFile program;
+    Linker linker(std::clog);
+    if (!linker.link(modules, paths, program))
+        return 1;
+    if (entryLabel != nullptr) {
+        bool found = false;
+        for (const ObjectSymbol &symbol : program.symbols) {
+            if (symbol.name == entryLabel) {
+                program.entry = symbol.address;
+                found = true;
+            }
+        }
+        if (!found) {
+            std::clog << "Label " << entryLabel << " is not global in any module!" << std::endl;
+            return 1;
+        }
+    }
+    if (!symbolTable)
+        program.symbols.clear();
+
+    std::ofstream out(output, std::ios_base::binary | std::ios_base::out);
+    program.write(out, raw);
+    out.close();
+    if (!out) {
+        std::clog << "Cannot write " << output << "!" << std::endl;
+        return 1;
+    }
+    SourceFile::writeStamp(output, key);
+    return 0;
+}
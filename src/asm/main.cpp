@@ -1,19 +1,131 @@
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
 #include "Assembler.h"
+#include "ModuleBuilder.h"
+#include "SourceFile.h"
+
+//Assembles every source into an object file next to it, modules with an up to date object are skipped
+static int buildModules(const std::vector<std::string> &sources, ModuleBuilder &builder, bool buildReport) {
+    std::vector<ModuleJob> jobs(sources.size());
+    for (size_t i = 0; i < sources.size(); i++) {
+        jobs[i].source = sources[i];
+        jobs[i].object = ModuleBuilder::getObjectPath(sources[i]);
+    }
+    bool success = builder.build(jobs);
+
+    int assembled = 0;
+    int upToDate = 0;
+    for (const ModuleJob &job : jobs) {
+        //Messages of a module are kept together
+        size_t begin = 0;
+        while (begin < job.logs.size()) {
+            size_t end = job.logs.find('\n', begin);
+            std::clog << job.source << ": " << job.logs.substr(begin, end - begin) << std::endl;
+            begin = end + 1;
+        }
+        assembled += job.assembled ? 1 : 0;
+        upToDate += job.upToDate ? 1 : 0;
+    }
+    if (buildReport)
+        std::clog << "modules assembled: " << assembled << ", up to date: " << upToDate << std::endl;
+    return success ? 0 : 1;
+}
 
 int main(int argc, char *argv[]) {
-    if (argc < 3) {
+    bool tailCalls = true;
+    bool tailCallReport = false;
+    int optimizationLevel = 1;
+    bool optimizationReport = false;
+    bool objectMode = false;
+    bool force = false;
+    bool buildReport = false;
+    bool raw = false;
+    bool symbolTable = true;
+    const char *entryLabel = nullptr;
+    int jobs = std::max(1u, std::thread::hardware_concurrency());
+    //Source and output of a program, or the sources of modules with -c
+    std::vector<std::string> paths;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--no-tail-calls") == 0) {
+            tailCalls = false;
+        } else if (std::strcmp(argv[i], "--tail-call-report") == 0) {
+            tailCallReport = true;
+        } else if (std::strcmp(argv[i], "-O0") == 0 || std::strcmp(argv[i], "-O1") == 0 ||
+                   std::strcmp(argv[i], "-O2") == 0) {
+            optimizationLevel = argv[i][2] - '0';
+        } else if (std::strcmp(argv[i], "--opt-report") == 0) {
+            optimizationReport = true;
+        } else if (std::strcmp(argv[i], "-c") == 0) {
+            objectMode = true;
+        } else if (std::strcmp(argv[i], "--force") == 0) {
+            force = true;
+        } else if (std::strcmp(argv[i], "--build-report") == 0) {
+            buildReport = true;
+        } else if (std::strcmp(argv[i], "--raw") == 0) {
+            raw = true;
+        } else if (std::strcmp(argv[i], "--no-symbols") == 0) {
+            symbolTable = false;
+        } else if (std::strncmp(argv[i], "--entry=", 8) == 0) {
+            entryLabel = argv[i] + 8;
+        } else if (std::strncmp(argv[i], "--jobs=", 7) == 0) {
+            jobs = std::atoi(argv[i] + 7);
+            if (jobs < 1) {
+                std::cout << "Invalid option " << argv[i] << std::endl;
+                return 0;
+            }
+        } else if (argv[i][0] == '-' && argv[i][1] == '-') {
+            std::cout << "Unknown option " << argv[i] << std::endl;
+            return 0;
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+
+    if (objectMode) {
+        if (paths.empty()) {
+            std::cout << "Paths to source files should be specified!" << std::endl;
+            return 0;
+        }
+        ModuleBuilder builder(jobs);
+        builder.setForce(force);
+        builder.setTailCallEliminationEnabled(tailCalls);
+        builder.setOptimizationLevel(optimizationLevel);
+        return buildModules(paths, builder, buildReport);
+    }
+
+    if (paths.size() < 2) {
         std::cout << "Paths to input and output files should be specified!" << std::endl;
         return 0;
     }
 
-    std::ifstream in(argv[1]);
-    std::ofstream out(argv[2], std::ios_base::binary | std::ios_base::out);
+    //A missing source assembles to an empty program, as an empty file does
+    SourceFile source;
+    source.open(paths[0].c_str());
+    std::ofstream out(paths[1], std::ios_base::binary | std::ios_base::out);
 
-    Assembler assembler(in, out, std::clog);
+    Assembler assembler(source.begin(), source.end(), out, std::clog);
+    assembler.setTailCallEliminationEnabled(tailCalls);
+    assembler.setOptimizationLevel(optimizationLevel);
+    assembler.setRawOutput(raw);
+    assembler.setSymbolTableEnabled(symbolTable);
+    if (entryLabel != nullptr)
+        assembler.setEntryLabel(entryLabel);
 
     assembler.assembleAll();
 
+    if (tailCallReport)
+        std::clog << "tail calls eliminated: " << assembler.getTailCallCount() << std::endl;
+    if (optimizationReport) {
+        for (const PassStatistics &statistics : assembler.getOptimizationStatistics())
+            std::clog << "pass " << statistics.name << ": " << statistics.rewritten << " rewritten, "
+                      << statistics.removed << " removed" << std::endl;
+    }
+
     return 0;
 }
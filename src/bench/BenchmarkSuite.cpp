@@ -0,0 +1,261 @@
+#include "BenchmarkSuite.h"
+#include "../asm/Assembler.h"
+#include "../asm/SourceFile.h"
+#include "../asm/SourceGenerator.h"
+#include "../processor/Fusion.h"
+#include "../processor/Processor.h"
+#include "../processor/Verifier.h"
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+//Sent from the child over a pipe, plain data only
+struct MeasuredRun {
+    long long instructions;
+    double seconds;
+    char status[64];
+};
+
+double WorkloadResult::getInstructionsPerSecond() const {
+    return seconds > 0.0 ? instructions / seconds : 0.0;
+}
+
+double WorkloadResult::getNsPerInstruction() const {
+    return instructions > 0 ? seconds * 1e9 / instructions : 0.0;
+}
+
+BenchmarkSuite::BenchmarkSuite(const std::string &testsDirectory, int runs):
+        _testsDirectory(testsDirectory), _runs(runs) {
+}
+
+std::vector<Workload> BenchmarkSuite::getWorkloads() {
+    std::vector<Workload> workloads;
+    workloads.push_back({"fib-15", "fibonacci.asm", 1, {15}, 3000, 0});
+    workloads.push_back({"fib-20", "fibonacci.asm", 1, {20}, 200, 0});
+    workloads.push_back({"fib-25", "fibonacci.asm", 1, {25}, 20, 0});
+    workloads.push_back({"fib-frame-20", "fibonacci_frame.asm", 1, {20}, 200, 0});
+    workloads.push_back({"fact-10", "fact.asm", 1, {10}, 200000, 0});
+    workloads.push_back({"fact-50", "fact.asm", 1, {50}, 80000, 0});
+    workloads.push_back({"fact-170", "fact.asm", 1, {170}, 30000, 0});
+
+    //Coefficients from a fixed generator, so every run solves the same equations with no, one or two
+    //roots. a is never 0, quadratic_equation.asm underflows on equations without a and b
+    Workload quadratic = {"quadratic", "quadratic_equation.asm", 3, {}, 200, 0};
+    unsigned int seed = 12345;
+    for (int i = 0; i < 3 * 1000; i++) {
+        seed = seed * 1103515245u + 12345u;
+        int coefficient = static_cast<int>((seed >> 16) % 20) - 10;
+        if (i % 3 == 0 && coefficient >= 0)
+            coefficient++;
+        quadratic.inputs.push_back(coefficient);
+    }
+    workloads.push_back(quadratic);
+
+    workloads.push_back({"ram-array", "ram_array.asm", 1, {500}, 1, 0});
+    workloads.push_back({"call-loop", "call_loop.asm", 1, {4000000}, 1, 0});
+    workloads.push_back({"assembler", "", 0, {}, 1, 1000000});
+    return workloads;
+}
+
+WorkloadResult BenchmarkSuite::run(const Workload &workload) {
+    WorkloadResult result = {workload.name, 0, 0.0, 0, "cannot start a process"};
+    int fds[2];
+    if (pipe(fds) != 0)
+        return result;
+
+    pid_t child = fork();
+    if (child < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        return result;
+    }
+    if (child == 0) {
+        close(fds[0]);
+        WorkloadResult measured = measure(workload);
+        MeasuredRun run = {measured.instructions, measured.seconds, {}};
+        std::strncpy(run.status, measured.status.c_str(), sizeof (run.status) - 1);
+        ssize_t written = write(fds[1], &run, sizeof (run));
+        _exit(written == sizeof (run) ? 0 : 1);
+    }
+
+    close(fds[1]);
+    MeasuredRun run;
+    ssize_t received = read(fds[0], &run, sizeof (run));
+    close(fds[0]);
+    int childStatus = 0;
+    struct rusage usage = {};
+    wait4(child, &childStatus, 0, &usage);
+    if (received != sizeof (run)) {
+        result.status = "process died";
+        return result;
+    }
+
+    result.instructions = run.instructions;
+    result.seconds = run.seconds;
+    result.peakRssKb = usage.ru_maxrss;
+    result.status = run.status;
+    return result;
+}
+
+WorkloadResult BenchmarkSuite::measure(const Workload &workload) {
+    return workload.program.empty() ? measureAssembler(workload) : measureProgram(workload);
+}
+
+WorkloadResult BenchmarkSuite::measureProgram(const Workload &workload) {
+    WorkloadResult result = {workload.name, 0, 0.0, 0, "success"};
+    std::string path = _testsDirectory + "/" + workload.program;
+    SourceFile source;
+    if (!source.open(path.c_str())) {
+        result.status = "cannot open " + path;
+        return result;
+    }
+    std::ostringstream out;
+    std::ostringstream logs;
+    Assembler assembler(source.begin(), source.end(), out, logs);
+    if (!assembler.assembleAll()) {
+        result.status = "cannot assemble " + path;
+        return result;
+    }
+
+    //Executable::load wants the alignment of a mapping
+    std::string bytes = out.str();
+    std::vector<double> image((bytes.size() + sizeof (double) - 1) / sizeof (double));
+    std::memcpy(image.data(), bytes.data(), bytes.size());
+    Executable executable;
+    std::string error;
+    if (!Executable::load(reinterpret_cast<const char *>(image.data()), bytes.size(), executable, error)) {
+        result.status = error;
+        return result;
+    }
+
+    int width = workload.inputWidth;
+    int records = workload.inputs.size() / width;
+    std::vector<double> output(16);
+    int outputCount = 0;
+
+    //Instructions of the program as written, fused ones would count once
+    Processor counter;
+    MemoryChannel channel;
+    counter.setIoChannel(&channel);
+    counter.setProfilingEnabled(true);
+    for (int record = 0; record < records; record++) {
+        channel.setInput(workload.inputs.data() + record * width, width);
+        channel.setOutput(output.data(), output.size());
+        ProcessorStatus status = counter.executeOperations(executable);
+        if (status != ProcessorStatus::SUCCESS) {
+            result.status = Processor::statusToStr(status);
+            return result;
+        }
+        result.instructions += counter.getProfiler()->getExecuted();
+    }
+    result.instructions *= workload.repeat;
+
+    //Loaded the way processor-batch does it
+    DecodedProgram program;
+    Decoder::decode(executable, program, RAM::DEFAULT_SIZE);
+    Decoder::eliminateTailCalls(program);
+    std::string diagnostic;
+    program.verified = Verifier::verify(program, diagnostic);
+    std::vector<int> firedCounts;
+    Fusion::fuse(program, firedCounts);
+
+    Processor processor;
+    for (int run = 0; run < _runs; run++) {
+        auto start = std::chrono::steady_clock::now();
+        for (int repeat = 0; repeat < workload.repeat; repeat++) {
+            for (int record = 0; record < records; record++) {
+                ProcessorStatus status = processor.executeRecord(program, workload.inputs.data() + record * width,
+                                                                 width, output.data(), output.size(), outputCount);
+                if (status != ProcessorStatus::SUCCESS) {
+                    result.status = Processor::statusToStr(status);
+                    return result;
+                }
+            }
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (run == 0 || seconds < result.seconds)
+            result.seconds = seconds;
+    }
+    return result;
+}
+
+WorkloadResult BenchmarkSuite::measureAssembler(const Workload &workload) {
+    WorkloadResult result = {workload.name, workload.lines, 0.0, 0, "success"};
+    std::string source = SourceGenerator::generate(workload.lines);
+    std::ostringstream logs;
+    for (int run = 0; run < _runs; run++) {
+        std::ostringstream out;
+        Assembler assembler(source.data(), source.data() + source.size(), out, logs);
+        auto start = std::chrono::steady_clock::now();
+        bool success = assembler.assembleAll();
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (!success) {
+            result.status = "cannot assemble generated source";
+            return result;
+        }
+        if (run == 0 || seconds < result.seconds)
+            result.seconds = seconds;
+    }
+    return result;
+}
+
+//Text as the inside of a JSON string, statuses hold paths and messages of the loader
+static std::string escapeJson(const std::string &text) {
+    std::string escaped;
+    for (char c : text) {
+        unsigned char code = static_cast<unsigned char>(c);
+        if (c == '"' || c == '\\') {
+            escaped += '\\';
+            escaped += c;
+        } else if (code < 0x20) {
+            char buffer[8];
+            std::snprintf(buffer, sizeof (buffer), "\\u%04x", code);
+            escaped += buffer;
+        } else {
+            escaped += c;
+        }
+    }
+    return escaped;
+}
+
+void BenchmarkSuite::writeJson(FILE *output, const std::vector<WorkloadResult> &results) {
+    std::fprintf(output, "{\n  \"workloads\": [");
+    const char *separator = "";
+    for (const WorkloadResult &result : results) {
+        std::fprintf(output, "%s\n    {\"name\": \"%s\", \"instructions\": %lld, \"seconds\": %.9f, "
+                             "\"instructions_per_second\": %.0f, \"ns_per_instruction\": %.4f, "
+                             "\"peak_rss_kb\": %lld, \"status\": \"%s\"}",
+                     separator, escapeJson(result.name).c_str(), result.instructions, result.seconds,
+                     result.getInstructionsPerSecond(), result.getNsPerInstruction(), result.peakRssKb,
+                     escapeJson(result.status).c_str());
+        separator = ",";
+    }
+    std::fprintf(output, "\n  ]\n}\n");
+}
+
+bool BenchmarkSuite::readBaseline(const char *path, std::map<std::string, double> &nsPerInstruction) {
+    SourceFile file;
+    if (!file.open(path))
+        return false;
+    std::string text(file.begin(), file.end());
+
+    //Only reads what writeJson writes: every name is followed by the ns of its workload
+    const char *nameKey = "\"name\": \"";
+    const char *nsKey = "\"ns_per_instruction\": ";
+    size_t position = 0;
+    while ((position = text.find(nameKey, position)) != std::string::npos) {
+        position += std::strlen(nameKey);
+        size_t nameEnd = text.find('"', position);
+        size_t ns = text.find(nsKey, position);
+        if (nameEnd == std::string::npos || ns == std::string::npos)
+            return false;
+        nsPerInstruction[text.substr(position, nameEnd - position)] =
+                std::strtod(text.c_str() + ns + std::strlen(nsKey), nullptr);
+        position = ns;
+    }
+    return !nsPerInstruction.empty();
+}
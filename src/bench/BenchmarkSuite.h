@@ -0,0 +1,65 @@
+#ifndef STACK_PROCESSOR_BENCHMARK_SUITE_H
+#define STACK_PROCESSOR_BENCHMARK_SUITE_H
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+//A program of the tests directory run over input records, or the assembler over generated source
+//when program is empty
+struct Workload {
+    std::string name;
+    std::string program;
+    int inputWidth;
+    //inputWidth values per record
+    std::vector<double> inputs;
+    //Times the records are run in one timed run, instructions are counted on a single pass
+    int repeat;
+    //Source lines of the assembler workload
+    long long lines;
+};
+
+struct WorkloadResult {
+    std::string name;
+    //Bytecode instructions executed, fused ones counted as the instructions they replace, or source
+    //lines assembled
+    long long instructions;
+    //Best of the runs
+    double seconds;
+    long long peakRssKb;
+    //"success", the first other status of a record or why the workload could not run
+    std::string status;
+
+    double getInstructionsPerSecond() const;
+
+    double getNsPerInstruction() const;
+};
+
+//Runs every workload in a child process, so its peak resident set size is its own, and compares
+//the results with a baseline written by an earlier run
+class BenchmarkSuite {
+private:
+    std::string _testsDirectory;
+    int _runs;
+
+    //Measures in the current process, peak RSS is left to the caller
+    WorkloadResult measure(const Workload &workload);
+
+    WorkloadResult measureProgram(const Workload &workload);
+
+    WorkloadResult measureAssembler(const Workload &workload);
+
+public:
+    BenchmarkSuite(const std::string &testsDirectory, int runs);
+
+    static std::vector<Workload> getWorkloads();
+
+    WorkloadResult run(const Workload &workload);
+
+    static void writeJson(FILE *output, const std::vector<WorkloadResult> &results);
+
+    //ns per instruction of every workload in a file written by writeJson, false if it cannot be read
+    static bool readBaseline(const char *path, std::map<std::string, double> &nsPerInstruction);
+};
+
+#endif //STACK_PROCESSOR_BENCHMARK_SUITE_H
@@ -0,0 +1,100 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include "BenchmarkSuite.h"
+
+int main(int argc, char *argv[]) {
+    int runs = 3;
+    const char *jsonPath = nullptr;
+    const char *baselinePath = nullptr;
+    double threshold = 10.0;
+    const char *filter = nullptr;
+    std::string testsDirectory = STACK_PROCESSOR_TESTS_DIR;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strncmp(argv[i], "--runs=", 7) == 0) {
+            runs = std::atoi(argv[i] + 7);
+            if (runs < 1) {
+                std::cout << "Invalid option " << argv[i] << std::endl;
+                return 0;
+            }
+        } else if (std::strncmp(argv[i], "--json=", 7) == 0) {
+            jsonPath = argv[i] + 7;
+        } else if (std::strncmp(argv[i], "--baseline=", 11) == 0) {
+            //Empty when the bench target is configured without a baseline
+            if (argv[i][11] != '\0')
+                baselinePath = argv[i] + 11;
+        } else if (std::strncmp(argv[i], "--threshold=", 12) == 0) {
+            threshold = std::atof(argv[i] + 12);
+            if (threshold < 0.0) {
+                std::cout << "Invalid option " << argv[i] << std::endl;
+                return 0;
+            }
+        } else if (std::strncmp(argv[i], "--filter=", 9) == 0) {
+            filter = argv[i] + 9;
+        } else if (std::strncmp(argv[i], "--tests-dir=", 12) == 0) {
+            testsDirectory = argv[i] + 12;
+        } else {
+            std::cout << "Unknown option " << argv[i] << std::endl;
+            return 0;
+        }
+    }
+
+    std::map<std::string, double> baseline;
+    if (baselinePath && !BenchmarkSuite::readBaseline(baselinePath, baseline)) {
+        std::cout << "Cannot read baseline " << baselinePath << std::endl;
+        return 1;
+    }
+
+    BenchmarkSuite suite(testsDirectory, runs);
+    std::vector<WorkloadResult> results;
+    int regressions = 0;
+    int failures = 0;
+    std::printf("%-14s %14s %10s %12s %10s\n", "workload", "instr/s", "ns/instr", "peak RSS KB", "change");
+    for (const Workload &workload : BenchmarkSuite::getWorkloads()) {
+        if (filter && workload.name.find(filter) == std::string::npos)
+            continue;
+        WorkloadResult result = suite.run(workload);
+        results.push_back(result);
+        if (result.status != "success") {
+            std::printf("%-14s %s\n", result.name.c_str(), result.status.c_str());
+            failures++;
+            continue;
+        }
+
+        //Slower by more than threshold percent per instruction than the baseline is a regression
+        std::string change = "-";
+        auto previous = baseline.find(result.name);
+        if (previous != baseline.end() && previous->second > 0.0) {
+            double percent = (result.getNsPerInstruction() / previous->second - 1.0) * 100.0;
+            char buffer[32];
+            std::snprintf(buffer, sizeof (buffer), "%+.1f%%", percent);
+            change = buffer;
+            if (percent > threshold) {
+                change += " !";
+                regressions++;
+            }
+        }
+        std::printf("%-14s %14.0f %10.3f %12lld %10s\n", result.name.c_str(), result.getInstructionsPerSecond(),
+                    result.getNsPerInstruction(), result.peakRssKb, change.c_str());
+        std::fflush(stdout);
+    }
+
+    if (jsonPath) {
+        FILE *json = std::fopen(jsonPath, "w");
+        if (json == nullptr) {
+            std::cout << "Cannot write " << jsonPath << std::endl;
+            return 1;
+        }
+        BenchmarkSuite::writeJson(json, results);
+        std::fclose(json);
+    }
+
+    if (regressions > 0)
+        std::cout << regressions << " workloads regressed by more than " << threshold << "%" << std::endl;
+    return regressions > 0 || failures > 0 ? 1 : 0;
+}
@@ -0,0 +1,700 @@
+#include "BatchEngine.h"
+#include "IntegerOperations.h"
+#include "Processor.h"
+#include "Verifier.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define BATCH_X86_KERNELS 1
+#endif
+
+#define SCALAR_BINARY_KERNEL(name, op) \
+static void name##Scalar(double *left, const double *right, int count) { \
+    for (int i = 0; i < count; i++) \
+        left[i] = left[i] op right[i]; \
+}
+
+SCALAR_BINARY_KERNEL(add, +)
+SCALAR_BINARY_KERNEL(sub, -)
+SCALAR_BINARY_KERNEL(mul, *)
+SCALAR_BINARY_KERNEL(div, /)
+
+static void sqrtScalar(double *values, int count) {
+    for (int i = 0; i < count; i++)
+        values[i] = std::sqrt(values[i]);
+}
+
+static const BatchKernels SCALAR_KERNELS = {"scalar", addScalar, subScalar, mulScalar, divScalar, sqrtScalar};
+
+#ifdef BATCH_X86_KERNELS
+
+//Same loop for every instruction set, the tail that does not fill a register goes through the scalar kernel
+#define VECTOR_BINARY_KERNEL(name, suffix, isa, width, type, load, store, op) \
+__attribute__((target(isa))) static void name##suffix(double *left, const double *right, int count) { \
+    int i = 0; \
+    for (; i + (width) <= count; i += (width)) { \
+        type result = op(load(left + i), load(right + i)); \
+        store(left + i, result); \
+    } \
+    name##Scalar(left + i, right + i, count - i); \
+}
+
+#define VECTOR_SQRT_KERNEL(suffix, isa, width, load, store, op) \
+__attribute__((target(isa))) static void sqrt##suffix(double *values, int count) { \
+    int i = 0; \
+    for (; i + (width) <= count; i += (width)) \
+        store(values + i, op(load(values + i))); \
+    sqrtScalar(values + i, count - i); \
+}
+
+VECTOR_BINARY_KERNEL(add, Sse2, "sse2", 2, __m128d, _mm_loadu_pd, _mm_storeu_pd, _mm_add_pd)
+VECTOR_BINARY_KERNEL(sub, Sse2, "sse2", 2, __m128d, _mm_loadu_pd, _mm_storeu_pd, _mm_sub_pd)
+VECTOR_BINARY_KERNEL(mul, Sse2, "sse2", 2, __m128d, _mm_loadu_pd, _mm_storeu_pd, _mm_mul_pd)
+VECTOR_BINARY_KERNEL(div, Sse2, "sse2", 2, __m128d, _mm_loadu_pd, _mm_storeu_pd, _mm_div_pd)
+VECTOR_SQRT_KERNEL(Sse2, "sse2", 2, _mm_loadu_pd, _mm_storeu_pd, _mm_sqrt_pd)
+
+VECTOR_BINARY_KERNEL(add, Avx2, "avx2", 4, __m256d, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_add_pd)
+VECTOR_BINARY_KERNEL(sub, Avx2, "avx2", 4, __m256d, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_sub_pd)
+VECTOR_BINARY_KERNEL(mul, Avx2, "avx2", 4, __m256d, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_mul_pd)
+VECTOR_BINARY_KERNEL(div, Avx2, "avx2", 4, __m256d, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_div_pd)
+VECTOR_SQRT_KERNEL(Avx2, "avx2", 4, _mm256_loadu_pd, _mm256_storeu_pd, _mm256_sqrt_pd)
+
+#undef VECTOR_SQRT_KERNEL
+#undef VECTOR_BINARY_KERNEL
+
+static const BatchKernels SSE2_KERNELS = {"sse2", addSse2, subSse2, mulSse2, divSse2, sqrtSse2};
+static const BatchKernels AVX2_KERNELS = {"avx2", addAvx2, subAvx2, mulAvx2, divAvx2, sqrtAvx2};
+
+#endif
+
+#undef SCALAR_BINARY_KERNEL
+
+//Same comparisons as the interpreter
+static bool conditionHolds(unsigned char opcode, double left, double right) {
+    bool equal = std::fabs(right - left) < PROCESSOR_EPSILON;
+    switch (opcode) {
+        case OperationPrefixCode::JE_OFFSET_EXACT_VAL:
+            return equal;
+        case OperationPrefixCode::JNE_OFFSET_EXACT_VAL:
+            return std::fabs(right - left) >= PROCESSOR_EPSILON;
+        case OperationPrefixCode::JA_OFFSET_EXACT_VAL:
+            return left > right + PROCESSOR_EPSILON;
+        case OperationPrefixCode::JAE_OFFSET_EXACT_VAL:
+            return left > right + PROCESSOR_EPSILON || equal;
+        case OperationPrefixCode::JB_OFFSET_EXACT_VAL:
+            return left + PROCESSOR_EPSILON < right;
+        default:
+            return left + PROCESSOR_EPSILON < right || equal;
+    }
+}
+
+static constexpr int REGISTER_ROWS = 4;
+
+BatchEngine::BatchEngine(const DecodedProgram &program, int inputWidth, int outputWidth, int ramSize):
+    _program(program), _inputWidth(inputWidth), _outputWidth(outputWidth), _ramSize(ramSize),
+    _lanePages((ramSize + PAGE_SIZE - 1) / PAGE_SIZE), _kernels(selectKernels()), _input(nullptr),
+    _output(nullptr), _mappedPages(false), _usedPages(0) {
+}
+
+const BatchKernels &BatchEngine::selectKernels() {
+#ifdef BATCH_X86_KERNELS
+    if (__builtin_cpu_supports("avx2"))
+        return AVX2_KERNELS;
+    return SSE2_KERNELS;
+#else
+    return SCALAR_KERNELS;
+#endif
+}
+
+int BatchEngine::getOutputRecordWidth() const {
+    return _outputWidth + 2;
+}
+
+const char *BatchEngine::getKernelsName() const {
+    return _kernels.name;
+}
+
+double *BatchEngine::row(LaneGroup &group, int row) {
+    return group.rows.data() + static_cast<size_t>(row) * group.lanes.size();
+}
+
+void BatchEngine::finish(LaneGroup &group, ProcessorStatus status) {
+    for (int lane : group.lanes) {
+        double *record = _output + static_cast<size_t>(lane) * getOutputRecordWidth();
+        record[0] = status;
+        record[1] = _outputCount[lane];
+    }
+    group.lanes.clear();
+    group.rows.clear();
+}
+
+LaneGroup BatchEngine::extract(const LaneGroup &group, const std::vector<unsigned char> &mask, bool selected) const {
+    LaneGroup part;
+    part.pc = group.pc;
+    part.depth = group.depth;
+    part.callStack = group.callStack;
+    part.frame = group.frame;
+    part.frames = group.frames;
+
+    int count = group.lanes.size();
+    for (int i = 0; i < count; i++) {
+        if (static_cast<bool>(mask[i]) == selected)
+            part.lanes.push_back(group.lanes[i]);
+    }
+
+    int rows = REGISTER_ROWS + group.depth;
+    part.rows.reserve(static_cast<size_t>(rows) * part.lanes.size());
+    for (int r = 0; r < rows; r++) {
+        const double *source = group.rows.data() + static_cast<size_t>(r) * count;
+        for (int i = 0; i < count; i++) {
+            if (static_cast<bool>(mask[i]) == selected)
+                part.rows.push_back(source[i]);
+        }
+    }
+    return part;
+}
+
+bool BatchEngine::sameState(const LaneGroup &first, const LaneGroup &second) const {
+    return first.pc == second.pc && first.depth == second.depth && first.callStack == second.callStack &&
+           first.frame == second.frame && first.frames == second.frames;
+}
+
+void BatchEngine::merge(LaneGroup &group, const LaneGroup &other) const {
+    size_t count = group.lanes.size();
+    size_t otherCount = other.lanes.size();
+    int rows = REGISTER_ROWS + group.depth;
+
+    std::vector<double> merged;
+    merged.reserve(rows * (count + otherCount));
+    for (int r = 0; r < rows; r++) {
+        merged.insert(merged.end(), group.rows.begin() + r * count, group.rows.begin() + (r + 1) * count);
+        merged.insert(merged.end(), other.rows.begin() + r * otherCount, other.rows.begin() + (r + 1) * otherCount);
+    }
+    group.rows.swap(merged);
+    group.lanes.insert(group.lanes.end(), other.lanes.begin(), other.lanes.end());
+}
+
+void BatchEngine::stopLanes(LaneGroup &group, const std::vector<unsigned char> &mask, ProcessorStatus status) {
+    LaneGroup stopped = extract(group, mask, true);
+    finish(stopped, status);
+    group = extract(group, mask, false);
+}
+
+LaneGroup BatchEngine::takeNext() {
+    //Deepest calls first, then the lowest instruction, so lanes that skipped ahead wait for the rest
+    size_t next = 0;
+    for (size_t i = 1; i < _pending.size(); i++) {
+        const LaneGroup &candidate = _pending[i];
+        const LaneGroup &best = _pending[next];
+        if (candidate.callStack.size() > best.callStack.size() ||
+            (candidate.callStack.size() == best.callStack.size() && candidate.pc < best.pc))
+            next = i;
+    }
+
+    LaneGroup group = std::move(_pending[next]);
+    _pending.erase(_pending.begin() + next);
+    for (size_t i = 0; i < _pending.size();) {
+        if (sameState(group, _pending[i])) {
+            merge(group, _pending[i]);
+            _pending.erase(_pending.begin() + i);
+        } else {
+            i++;
+        }
+    }
+    return group;
+}
+
+bool BatchEngine::push(LaneGroup &group) {
+    if (group.depth == Processor::DEFAULT_DATA_STACK_CAPACITY) {
+        finish(group, ProcessorStatus::DATA_STACK_OVERFLOW);
+        return false;
+    }
+    group.rows.resize(group.rows.size() + group.lanes.size());
+    group.depth++;
+    return true;
+}
+
+char *BatchEngine::getPage(int lane, int page, bool write) {
+    long long key = static_cast<long long>(lane) * _lanePages + page;
+    if (_mappedPages && !write) {
+        auto found = _pageMap.find(key);
+        return found != _pageMap.end() ? found->second : nullptr;
+    }
+    char *&entry = _mappedPages ? _pageMap[key] : _pageTable[key];
+    if (entry == nullptr && write) {
+        if (_usedPages == _pages.size())
+            _pages.emplace_back(new char[PAGE_SIZE]());
+        entry = _pages[_usedPages++].get();
+    }
+    return entry;
+}
+
+void BatchEngine::read(int lane, int addr, char *values, int size) {
+    for (int i = 0; i < size;) {
+        int page = (addr + i) / PAGE_SIZE;
+        int offset = (addr + i) % PAGE_SIZE;
+        int length = std::min(size - i, PAGE_SIZE - offset);
+        const char *memory = getPage(lane, page, false);
+        if (memory != nullptr)
+            std::memcpy(values + i, memory + offset, length);
+        else
+            std::memset(values + i, 0, length);
+        i += length;
+    }
+}
+
+void BatchEngine::write(int lane, int addr, const char *values, int size) {
+    for (int i = 0; i < size;) {
+        int page = (addr + i) / PAGE_SIZE;
+        int offset = (addr + i) % PAGE_SIZE;
+        int length = std::min(size - i, PAGE_SIZE - offset);
+        std::memcpy(getPage(lane, page, true) + offset, values + i, length);
+        i += length;
+    }
+}
+
+double BatchEngine::load(int lane, int addr) {
+    //A value may span two pages
+    DoubleChars value;
+    read(lane, addr, value.chr_val, sizeof (double));
+    return value.db_val;
+}
+
+void BatchEngine::store(int lane, int addr, double val) {
+    DoubleChars value;
+    value.db_val = val;
+    write(lane, addr, value.chr_val, sizeof (double));
+}
+
+double BatchEngine::applyVector(int lane, const VectorArguments &arguments) {
+    //Every range gets its own copy, so sources are read as they were before the instruction
+    //just like overlapping ranges in the interpreter
+    int size = arguments.count * sizeof (double);
+    _vectorScratch.resize(3 * size + 1);
+    VectorArguments copied = arguments;
+    int offset = 0;
+    if (arguments.destination >= 0) {
+        if (arguments.opcode == OperationPrefixCode::VFMA)
+            read(lane, arguments.destination, _vectorScratch.data(), size);
+        copied.destination = 0;
+        offset += size;
+    }
+    for (int i = 0; i < 2; i++) {
+        if (arguments.sources[i] < 0)
+            continue;
+        read(lane, arguments.sources[i], _vectorScratch.data() + offset, size);
+        copied.sources[i] = offset;
+        offset += size;
+    }
+
+    double result = VectorOperations::apply(copied, _vectorScratch.data());
+    if (arguments.destination >= 0)
+        write(lane, arguments.destination, _vectorScratch.data(), size);
+    return result;
+}
+
+void BatchEngine::runGroup(LaneGroup &group) {
+    const std::vector<DecodedInstruction> &code = _program.instructions;
+    std::vector<unsigned char> mask;
+
+    while (!group.lanes.empty()) {
+        const DecodedInstruction &ins = code[group.pc];
+        int count = group.lanes.size();
+        int topRow = REGISTER_ROWS + group.depth - 1;
+        bool transferred = false;
+
+        int needed, pushed;
+        Verifier::getStackEffect(ins.opcode, needed, pushed);
+        if (group.depth < needed) {
+            finish(group, ProcessorStatus::DATA_STACK_UNDERFLOW);
+            return;
+        }
+
+        switch (ins.opcode) {
+            case OperationPrefixCode::IN: {
+                if (!push(group))
+                    return;
+                double *top = row(group, topRow + 1);
+                for (int i = 0; i < count; i++) {
+                    int lane = group.lanes[i];
+                    int &cursor = _inputCursor[lane];
+                    top[i] = cursor < _inputWidth ? _input[static_cast<size_t>(lane) * _inputWidth + cursor] : 0.0;
+                    cursor++;
+                }
+                group.pc++;
+                break;
+            }
+            case OperationPrefixCode::OUT: {
+                const double *top = row(group, topRow);
+                for (int i = 0; i < count; i++) {
+                    int lane = group.lanes[i];
+                    if (_outputCount[lane] < _outputWidth)
+                        _output[static_cast<size_t>(lane) * getOutputRecordWidth() + 2 + _outputCount[lane]] = top[i];
+                    _outputCount[lane]++;
+                }
+                group.depth--;
+                group.rows.resize(group.rows.size() - count);
+                group.pc++;
+                break;
+            }
+            case OperationPrefixCode::ADD:
+            case OperationPrefixCode::SUB:
+            case OperationPrefixCode::MUL:
+            case OperationPrefixCode::DIV: {
+                double *left = row(group, topRow - 1);
+                const double *right = row(group, topRow);
+                if (ins.opcode == OperationPrefixCode::ADD)
+                    _kernels.add(left, right, count);
+                else if (ins.opcode == OperationPrefixCode::SUB)
+                    _kernels.sub(left, right, count);
+                else if (ins.opcode == OperationPrefixCode::MUL)
+                    _kernels.mul(left, right, count);
+                else
+                    _kernels.div(left, right, count);
+                group.depth--;
+                group.rows.resize(group.rows.size() - count);
+                group.pc++;
+                break;
+            }
+            case OperationPrefixCode::SIN:
+            case OperationPrefixCode::COS: {
+                double *top = row(group, topRow);
+                for (int i = 0; i < count; i++)
+                    top[i] = ins.opcode == OperationPrefixCode::SIN ? std::sin(top[i]) : std::cos(top[i]);
+                group.pc++;
+                break;
+            }
+            case OperationPrefixCode::SQRT:
+                _kernels.sqrt(row(group, topRow), count);
+                group.pc++;
+                break;
+            case OperationPrefixCode::IADD:
+            case OperationPrefixCode::ISUB:
+            case OperationPrefixCode::IMUL:
+            case OperationPrefixCode::IDIV:
+            case OperationPrefixCode::IREM:
+            case OperationPrefixCode::IAND:
+            case OperationPrefixCode::IOR:
+            case OperationPrefixCode::IXOR:
+            case OperationPrefixCode::ISHL:
+            case OperationPrefixCode::ISHR: {
+                //Lanes dividing by zero stop, the rest go on
+                double *left = row(group, topRow - 1);
+                const double *right = row(group, topRow);
+                mask.assign(count, 0);
+                bool invalid = false;
+                for (int i = 0; i < count; i++) {
+                    long long result;
+                    if (IntegerOperations::apply(ins.opcode, IntegerOperations::getBits(left[i]),
+                                                 IntegerOperations::getBits(right[i]), result)) {
+                        left[i] = IntegerOperations::fromBits(result);
+                    } else {
+                        mask[i] = 1;
+                        invalid = true;
+                    }
+                }
+                if (invalid) {
+                    stopLanes(group, mask, ProcessorStatus::INTEGER_DIVISION_BY_ZERO);
+                    count = group.lanes.size();
+                    if (count == 0)
+                        return;
+                }
+                group.depth--;
+                group.rows.resize(group.rows.size() - count);
+                group.pc++;
+                break;
+            }
+            case OperationPrefixCode::ITOD:
+            case OperationPrefixCode::DTOI: {
+                double *top = row(group, topRow);
+                for (int i = 0; i < count; i++) {
+                    top[i] = ins.opcode == OperationPrefixCode::ITOD ?
+                             static_cast<double>(IntegerOperations::getBits(top[i])) :
+                             IntegerOperations::fromBits(IntegerOperations::truncate(top[i]));
+                }
+                group.pc++;
+                break;
+            }
+            case OperationPrefixCode::RET_ABS:
+                if (group.callStack.empty()) {
+                    finish(group, ProcessorStatus::CALL_STACK_UNDERFLOW);
+                    return;
+                }
+                group.pc = group.callStack.back();
+                group.callStack.pop_back();
+                group.frame = group.frames.back();
+                group.frames.pop_back();
+                transferred = true;
+                break;
+            case OperationPrefixCode::HALT:
+                finish(group, ProcessorStatus::SUCCESS);
+                return;
+            case OperationPrefixCode::POP:
+                group.depth--;
+                group.rows.resize(group.rows.size() - count);
+                group.pc++;
+                break;
+            case OperationPrefixCode::PUSH_REG_VAL:
+                if (!push(group))
+                    return;
+                std::memcpy(row(group, topRow + 1), row(group, ins.reg), count * sizeof (double));
+                group.pc++;
+                break;
+            case OperationPrefixCode::PUSH_EXACT_VAL: {
+                if (!push(group))
+                    return;
+                double *top = row(group, topRow + 1);
+                for (int i = 0; i < count; i++)
+                    top[i] = ins.val;
+                group.pc++;
+                break;
+            }
+            case OperationPrefixCode::POP_REG_VAL:
+                std::memcpy(row(group, ins.reg), row(group, topRow), count * sizeof (double));
+                group.depth--;
+                group.rows.resize(group.rows.size() - count);
+                group.pc++;
+                break;
+            case OperationPrefixCode::PUSH_EXACT_ADDR:
+            case OperationPrefixCode::PUSH_REG_ADDR:
+            case OperationPrefixCode::POP_EXACT_ADDR:
+            case OperationPrefixCode::POP_REG_ADDR: {
+                bool loads = ins.opcode == OperationPrefixCode::PUSH_EXACT_ADDR ||
+                            ins.opcode == OperationPrefixCode::PUSH_REG_ADDR;
+                bool byRegister = ins.opcode == OperationPrefixCode::PUSH_REG_ADDR ||
+                                  ins.opcode == OperationPrefixCode::POP_REG_ADDR;
+
+                //Lanes with invalid addresses stop, the rest go on
+                std::vector<int> addresses(count, ins.arg);
+                if (byRegister) {
+                    const double *reg = row(group, ins.reg);
+                    mask.assign(count, 0);
+                    bool invalid = false;
+                    for (int i = 0; i < count; i++) {
+                        DoubleUll value;
+                        value.db_val = reg[i];
+                        addresses[i] = value.ull_val;
+                        mask[i] = !RAM::isValidAddr(static_cast<long long>(value.ull_val), _ramSize);
+                        invalid = invalid || mask[i];
+                    }
+                    if (invalid) {
+                        std::vector<int> validAddresses;
+                        for (int i = 0; i < count; i++) {
+                            if (!mask[i])
+                                validAddresses.push_back(addresses[i]);
+                        }
+                        addresses.swap(validAddresses);
+                        stopLanes(group, mask, ProcessorStatus::INVALID_RAM_ADDRESS);
+                        count = group.lanes.size();
+                        if (count == 0)
+                            return;
+                    }
+                }
+
+                if (loads) {
+                    if (!push(group))
+                        return;
+                    double *top = row(group, topRow + 1);
+                    for (int i = 0; i < count; i++)
+                        top[i] = load(group.lanes[i], addresses[i]);
+                } else {
+                    const double *top = row(group, topRow);
+                    for (int i = 0; i < count; i++)
+                        store(group.lanes[i], addresses[i], top[i]);
+                    group.depth--;
+                    group.rows.resize(group.rows.size() - count);
+                }
+                group.pc++;
+                break;
+            }
+            case OperationPrefixCode::PUSH_FRAME_SLOT:
+            case OperationPrefixCode::POP_FRAME_SLOT: {
+                //Lanes of a group share the frame, so all of them reach the same slot
+                bool pops = ins.opcode == OperationPrefixCode::POP_FRAME_SLOT;
+                int slot = group.frame + ins.arg;
+                if (slot < 0 || slot >= (pops ? group.depth - 1 : group.depth)) {
+                    finish(group, ProcessorStatus::INVALID_FRAME_SLOT);
+                    return;
+                }
+                if (pops) {
+                    std::memcpy(row(group, REGISTER_ROWS + slot), row(group, topRow), count * sizeof (double));
+                    group.depth--;
+                    group.rows.resize(group.rows.size() - count);
+                } else {
+                    if (!push(group))
+                        return;
+                    std::memcpy(row(group, topRow + 1), row(group, REGISTER_ROWS + slot), count * sizeof (double));
+                }
+                group.pc++;
+                break;
+            }
+            case OperationPrefixCode::VADD:
+            case OperationPrefixCode::VMUL:
+            case OperationPrefixCode::VFMA:
+            case OperationPrefixCode::VSUM:
+            case OperationPrefixCode::VMIN:
+            case OperationPrefixCode::VMAX:
+            case OperationPrefixCode::VDOT:
+            case OperationPrefixCode::VFILL:
+            case OperationPrefixCode::VCOPY: {
+                //Lanes with ranges outside RAM stop, the rest go on
+                int firstRow = topRow - needed + 1;
+                std::vector<VectorArguments> arguments(count);
+                mask.assign(count, 0);
+                bool invalid = false;
+                for (int i = 0; i < count; i++) {
+                    double operands[4];
+                    for (int j = 0; j < needed; j++)
+                        operands[j] = row(group, firstRow + j)[i];
+                    mask[i] = !VectorOperations::decode(ins.opcode, operands, _ramSize, arguments[i]);
+                    invalid = invalid || mask[i];
+                }
+                if (invalid) {
+                    std::vector<VectorArguments> validArguments;
+                    for (int i = 0; i < count; i++) {
+                        if (!mask[i])
+                            validArguments.push_back(arguments[i]);
+                    }
+                    arguments.swap(validArguments);
+                    stopLanes(group, mask, ProcessorStatus::INVALID_RAM_ADDRESS);
+                    count = group.lanes.size();
+                    if (count == 0)
+                        return;
+                }
+
+                std::vector<double> results(count);
+                for (int i = 0; i < count; i++)
+                    results[i] = applyVector(group.lanes[i], arguments[i]);
+                group.depth += pushed - needed;
+                group.rows.resize(static_cast<size_t>(REGISTER_ROWS + group.depth) * count);
+                if (pushed > 0)
+                    std::memcpy(row(group, REGISTER_ROWS + group.depth - 1), results.data(), count * sizeof (double));
+                group.pc++;
+                break;
+            }
+            case OperationPrefixCode::JMP_OFFSET_EXACT_VAL:
+                group.pc = ins.arg;
+                transferred = true;
+                break;
+            case OperationPrefixCode::JE_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::JNE_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::JA_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::JAE_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::JB_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::JBE_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::IJE_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::IJNE_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::IJA_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::IJAE_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::IJB_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::IJBE_OFFSET_EXACT_VAL: {
+                const double *left = row(group, topRow - 1);
+                const double *right = row(group, topRow);
+                bool integer = IntegerOperations::isIntegerJump(ins.opcode);
+                mask.resize(count);
+                int taken = 0;
+                for (int i = 0; i < count; i++) {
+                    mask[i] = integer ? IntegerOperations::compare(ins.opcode, IntegerOperations::getBits(left[i]),
+                                                                   IntegerOperations::getBits(right[i])) :
+                              conditionHolds(ins.opcode, left[i], right[i]);
+                    taken += mask[i];
+                }
+
+                if (taken != 0 && taken != count) {
+                    LaneGroup jumped = extract(group, mask, true);
+                    jumped.pc = ins.arg;
+                    LaneGroup fellThrough = extract(group, mask, false);
+                    fellThrough.pc = group.pc + 1;
+                    _pending.push_back(std::move(jumped));
+                    _pending.push_back(std::move(fellThrough));
+                    return;
+                }
+                group.pc = taken == count ? ins.arg : group.pc + 1;
+                transferred = true;
+                break;
+            }
+            case OperationPrefixCode::CALL_OFFSET_EXACT_VAL:
+                group.callStack.push_back(group.pc + 1);
+                group.frames.push_back(group.frame);
+                group.frame = group.depth;
+                group.pc = ins.arg;
+                transferred = true;
+                break;
+            case InternalOperationCode::TRAP:
+                finish(group, static_cast<ProcessorStatus>(ins.arg));
+                return;
+            default:
+                finish(group, ProcessorStatus::UNRECOGNIZED_COMMAND);
+                return;
+        }
+
+        //Gives split lanes behind this group a chance to catch up and merge
+        if (transferred && !_pending.empty()) {
+            _pending.push_back(std::move(group));
+            return;
+        }
+    }
+}
+
+void BatchEngine::run(const double *input, int count, double *output) {
+    _input = input;
+    _output = output;
+    _inputCursor.assign(count, 0);
+    _outputCount.assign(count, 0);
+    _mappedPages = static_cast<long long>(count) * _lanePages > MAX_PAGE_TABLE_ENTRIES;
+    _pageTable.assign(_mappedPages ? 0 : static_cast<size_t>(count) * _lanePages, nullptr);
+    _pageMap.clear();
+
+    size_t outputSize = static_cast<size_t>(count) * getOutputRecordWidth();
+    std::fill(output, output + outputSize, std::numeric_limits<double>::quiet_NaN());
+
+    LaneGroup group;
+    group.pc = 0;
+    group.depth = 0;
+    group.frame = 0;
+    for (int lane = 0; lane < count; lane++)
+        group.lanes.push_back(lane);
+    group.rows.assign(static_cast<size_t>(REGISTER_ROWS) * count, 0.0);
+    _pending.clear();
+    if (count > 0)
+        _pending.push_back(std::move(group));
+
+    while (!_pending.empty()) {
+        LaneGroup next = takeNext();
+        runGroup(next);
+    }
+
+    for (size_t i = 0; i < _usedPages; i++)
+        std::memset(_pages[i].get(), 0, PAGE_SIZE);
+    _usedPages = 0;
+}
+
+bool BatchEngine::run(FILE *input, FILE *output, std::string &error) {
+    std::vector<double> inputChunk(static_cast<size_t>(CHUNK_RECORDS) * _inputWidth);
+    std::vector<double> outputChunk(static_cast<size_t>(CHUNK_RECORDS) * getOutputRecordWidth());
+
+    while (true) {
+        size_t values = std::fread(inputChunk.data(), sizeof (double), inputChunk.size(), input);
+        int count = values / _inputWidth;
+        if (count > 0) {
+            run(inputChunk.data(), count, outputChunk.data());
+            size_t outputValues = static_cast<size_t>(count) * getOutputRecordWidth();
+            if (std::fwrite(outputChunk.data(), sizeof (double), outputValues, output) != outputValues) {
+                error = "cannot write output records";
+                return false;
+            }
+        }
+        //An incomplete record at the end of input is ignored
+        if (values < inputChunk.size()) {
+            if (std::ferror(input)) {
+                error = "cannot read input records";
+                return false;
+            }
+            return true;
+        }
+    }
+}
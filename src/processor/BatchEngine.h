@@ -0,0 +1,127 @@
+#ifndef STACK_PROCESSOR_BATCH_ENGINE_H
+#define STACK_PROCESSOR_BATCH_ENGINE_H
+#include "../utils.h"
+#include "Decoder.h"
+#include "VectorOperations.h"
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//Lanes that are at the same instruction with the same call stack and data stack depth.
+//Registers and stack slots are stored as rows of one value per lane: rows 0-3 hold the
+//registers, row 4 + i holds stack slot i.
+struct LaneGroup {
+    int pc;
+    int depth;
+    std::vector<int> callStack;
+    int frame; //Depth at entry of the running function
+    std::vector<int> frames;
+    std::vector<int> lanes;
+    std::vector<double> rows;
+};
+
+//Arithmetic over whole rows, picked once for the instruction set of the running CPU
+struct BatchKernels {
+    const char *name;
+    void (*add)(double *left, const double *right, int count);
+    void (*sub)(double *left, const double *right, int count);
+    void (*mul)(double *left, const double *right, int count);
+    void (*div)(double *left, const double *right, int count);
+    void (*sqrt)(double *values, int count);
+};
+
+//Runs one program over many independent input records in lockstep. Every record is a
+//lane with its own registers, stacks and RAM, all lanes of a group execute each
+//instruction together. Conditional jumps that go different ways split the group,
+//groups that reach the same state again are merged.
+//
+//in reads the next value of the lane's input record, 0 once the record is exhausted.
+//Output record of a lane is its ProcessorStatus, the number of out executed and
+//outputWidth values written by out, NaN where nothing was written.
+class BatchEngine {
+private:
+    const DecodedProgram &_program;
+    int _inputWidth;
+    int _outputWidth;
+    int _ramSize;
+    int _lanePages;
+    BatchKernels _kernels;
+
+    //State of the records being run
+    const double *_input;
+    double *_output;
+    std::vector<int> _inputCursor;
+    std::vector<int> _outputCount;
+    //RAM of every lane is split into pages that are only allocated once written,
+    //pages are zeroed and reused by the next run. Entry lane * _lanePages + page of
+    //the table, or of the map when the table would exceed MAX_PAGE_TABLE_ENTRIES
+    std::vector<char*> _pageTable;
+    std::unordered_map<long long, char*> _pageMap;
+    bool _mappedPages;
+    std::vector<std::unique_ptr<char[]>> _pages;
+    size_t _usedPages;
+    std::vector<LaneGroup> _pending;
+    //Ranges of one lane while a vector instruction runs on them
+    std::vector<char> _vectorScratch;
+
+    static const BatchKernels &selectKernels();
+
+    double *row(LaneGroup &group, int row);
+
+    void finish(LaneGroup &group, ProcessorStatus status);
+
+    //Moves lanes whose mask value equals selected into a new group
+    LaneGroup extract(const LaneGroup &group, const std::vector<unsigned char> &mask, bool selected) const;
+
+    bool sameState(const LaneGroup &first, const LaneGroup &second) const;
+
+    void merge(LaneGroup &group, const LaneGroup &other) const;
+
+    //Finishes the lanes whose mask value is set with status, the rest stay in group
+    void stopLanes(LaneGroup &group, const std::vector<unsigned char> &mask, ProcessorStatus status);
+
+    //Takes the group that should run next together with all groups in the same state
+    LaneGroup takeNext();
+
+    bool push(LaneGroup &group);
+
+    char *getPage(int lane, int page, bool write);
+
+    //Copies size bytes of the lane's RAM, pages never written read as zeros
+    void read(int lane, int addr, char *values, int size);
+
+    void write(int lane, int addr, const char *values, int size);
+
+    double load(int lane, int addr);
+
+    void store(int lane, int addr, double val);
+
+    //Runs a decoded vector instruction on the lane's RAM, returns the result of reductions
+    double applyVector(int lane, const VectorArguments &arguments);
+
+    //Runs the group until it finishes, splits or another group may need to catch up
+    void runGroup(LaneGroup &group);
+
+public:
+    static constexpr int CHUNK_RECORDS = 4096;
+    static constexpr int PAGE_SIZE = 4096;
+    static constexpr long long MAX_PAGE_TABLE_ENTRIES = 1 << 20;
+
+    //Every lane gets ramSize bytes of RAM, the size program was decoded with
+    BatchEngine(const DecodedProgram &program, int inputWidth, int outputWidth, int ramSize);
+
+    int getOutputRecordWidth() const;
+
+    const char *getKernelsName() const;
+
+    //input holds count records of inputWidth values, output receives count output records
+    void run(const double *input, int count, double *output);
+
+    //Streams records of doubles from input to output in chunks of CHUNK_RECORDS,
+    //returns false and sets error if a file cannot be read or written
+    bool run(FILE *input, FILE *output, std::string &error);
+};
+
+#endif //STACK_PROCESSOR_BATCH_ENGINE_H
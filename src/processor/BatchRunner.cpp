@@ -0,0 +1,154 @@
+#include "BatchRunner.h"
+#include <algorithm>
+#include <limits>
+#include <thread>
+
+constexpr int BatchRunner::BLOCK_RECORDS;
+constexpr int BatchRunner::WINDOW_RECORDS;
+
+BatchRunner::BatchRunner(const DecodedProgram &program, int inputWidth, int outputWidth, int threads):
+    _program(program), _inputWidth(inputWidth), _outputWidth(outputWidth), _threads(threads),
+    _dispatch_mode(DispatchMode::THREADED_DISPATCH), _ram_size(RAM::DEFAULT_SIZE), _pool(threads), _input(nullptr),
+    _count(0) {
+}
+
+void BatchRunner::setDispatchMode(DispatchMode mode) {
+    _dispatch_mode = mode;
+}
+
+void BatchRunner::setRamSize(int size) {
+    _ram_size = size;
+}
+
+int BatchRunner::getOutputRecordWidth() const {
+    return _outputWidth + 2;
+}
+
+int BatchRunner::takeBlock(int worker) {
+    WorkRange &own = *_ranges[worker];
+    {
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (own.next < own.end)
+            return own.next++;
+    }
+
+    //Steal the back half of the range with the most blocks left
+    while (true) {
+        int victim = -1;
+        int most = 0;
+        for (int i = 0; i < _threads; i++) {
+            WorkRange &range = *_ranges[i];
+            std::lock_guard<std::mutex> lock(range.mutex);
+            if (range.end - range.next > most) {
+                most = range.end - range.next;
+                victim = i;
+            }
+        }
+        if (victim < 0)
+            return -1;
+
+        int begin, end;
+        {
+            WorkRange &range = *_ranges[victim];
+            std::lock_guard<std::mutex> lock(range.mutex);
+            if (range.next >= range.end)
+                continue;
+            end = range.end;
+            begin = range.next + (range.end - range.next) / 2;
+            range.end = begin;
+        }
+
+        std::lock_guard<std::mutex> lock(own.mutex);
+        own.next = begin + 1;
+        own.end = end;
+        return begin;
+    }
+}
+
+void BatchRunner::runWorker(int worker) {
+    Processor &processor = *_processors[worker];
+    WorkerOutput &output = _outputs[worker];
+    int width = getOutputRecordWidth();
+
+    for (int block = takeBlock(worker); block >= 0; block = takeBlock(worker)) {
+        int first = block * BLOCK_RECORDS;
+        int last = std::min(first + BLOCK_RECORDS, _count);
+
+        size_t offset = output.values.size();
+        output.values.resize(offset + static_cast<size_t>(last - first) * width,
+                             std::numeric_limits<double>::quiet_NaN());
+        output.blocks.push_back(block);
+
+        for (int record = first; record < last; record++) {
+            double *result = output.values.data() + offset + static_cast<size_t>(record - first) * width;
+            int outputCount;
+            ProcessorStatus status = processor.executeRecord(_program,
+                                                             _input + static_cast<size_t>(record) * _inputWidth,
+                                                             _inputWidth, result + 2, _outputWidth, outputCount);
+            result[0] = status;
+            result[1] = outputCount;
+        }
+    }
+}
+
+bool BatchRunner::runWindow(const double *input, int count, FILE *output, std::string &error) {
+    _input = input;
+    _count = count;
+
+    //Every worker starts with an equal contiguous share of the blocks
+    int blocks = (count + BLOCK_RECORDS - 1) / BLOCK_RECORDS;
+    for (int i = 0; i < _threads; i++) {
+        _ranges[i]->next = static_cast<long long>(blocks) * i / _threads;
+        _ranges[i]->end = static_cast<long long>(blocks) * (i + 1) / _threads;
+        _outputs[i].values.clear();
+        _outputs[i].blocks.clear();
+    }
+
+    std::vector<std::thread> workers;
+    for (int i = 1; i < _threads; i++)
+        workers.emplace_back(&BatchRunner::runWorker, this, i);
+    runWorker(0);
+    for (std::thread &worker : workers)
+        worker.join();
+
+    //Where every block ended up, then write them in input order
+    std::vector<const double*> results(blocks);
+    for (const WorkerOutput &workerOutput : _outputs) {
+        const double *values = workerOutput.values.data();
+        for (int block : workerOutput.blocks) {
+            results[block] = values;
+            values += static_cast<size_t>(std::min(BLOCK_RECORDS, count - block * BLOCK_RECORDS)) *
+                      getOutputRecordWidth();
+        }
+    }
+    for (int block = 0; block < blocks; block++) {
+        size_t size = static_cast<size_t>(std::min(BLOCK_RECORDS, count - block * BLOCK_RECORDS)) *
+                      getOutputRecordWidth();
+        if (std::fwrite(results[block], sizeof (double), size, output) != size) {
+            error = "cannot write output records";
+            return false;
+        }
+    }
+    return true;
+}
+
+bool BatchRunner::run(const double *input, long long count, FILE *output, std::string &error) {
+    _processors.clear();
+    _ranges.clear();
+    _outputs.assign(_threads, WorkerOutput());
+    for (int i = 0; i < _threads; i++) {
+        _processors.push_back(_pool.acquire());
+        _processors.back()->setDispatchMode(_dispatch_mode);
+        if (_processors.back()->getRamSize() != _ram_size)
+            _processors.back()->setRamSize(_ram_size, false);
+        _ranges.emplace_back(new WorkRange);
+    }
+
+    for (long long first = 0; first < count; first += WINDOW_RECORDS) {
+        int window = static_cast<int>(std::min<long long>(WINDOW_RECORDS, count - first));
+        if (!runWindow(input + first * _inputWidth, window, output, error))
+            return false;
+    }
+    _processors.clear();
+    return true;
+}
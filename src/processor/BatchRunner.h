@@ -0,0 +1,74 @@
+#ifndef STACK_PROCESSOR_BATCH_RUNNER_H
+#define STACK_PROCESSOR_BATCH_RUNNER_H
+#include "../utils.h"
+#include "Decoder.h"
+#include "Processor.h"
+#include "ProcessorPool.h"
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+//Blocks of records owned by a worker, the owner takes them from the front and
+//other workers steal the back half
+struct WorkRange {
+    std::mutex mutex;
+    int next;
+    int end;
+};
+
+//Results of the blocks a worker ran, in the order it ran them
+struct WorkerOutput {
+    std::vector<double> values;
+    std::vector<int> blocks;
+};
+
+//Runs one prepared program over many input records on several threads, every thread
+//with its own Processor. Records use the same layout as BatchEngine: inputWidth values
+//in, status, out count and outputWidth values NaN-padded out.
+class BatchRunner {
+private:
+    const DecodedProgram &_program;
+    int _inputWidth;
+    int _outputWidth;
+    int _threads;
+    DispatchMode _dispatch_mode;
+    int _ram_size;
+
+    ProcessorPool _pool;
+    std::vector<ProcessorPool::Handle> _processors;
+    std::vector<std::unique_ptr<WorkRange>> _ranges;
+    std::vector<WorkerOutput> _outputs;
+
+    //Records of the window being run
+    const double *_input;
+    int _count;
+
+    //Returns the next block for the worker or -1 once there is nothing left to steal
+    int takeBlock(int worker);
+
+    void runWorker(int worker);
+
+    //Runs the window and writes its output records in input order
+    bool runWindow(const double *input, int count, FILE *output, std::string &error);
+
+public:
+    static constexpr int BLOCK_RECORDS = 256;
+    //Records run between two merges, bounds the memory taken by worker outputs
+    static constexpr int WINDOW_RECORDS = 1 << 20;
+
+    BatchRunner(const DecodedProgram &program, int inputWidth, int outputWidth, int threads);
+
+    void setDispatchMode(DispatchMode mode);
+
+    //RAM of every worker's processor, program has to be decoded with the same size
+    void setRamSize(int size);
+
+    int getOutputRecordWidth() const;
+
+    //input holds count records, returns false and sets error if output cannot be written
+    bool run(const double *input, long long count, FILE *output, std::string &error);
+};
+
+#endif //STACK_PROCESSOR_BATCH_RUNNER_H
@@ -0,0 +1,270 @@
+#include "Decoder.h"
+#include "Processor.h"
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+bool Decoder::isNoArgsOperation(char prefixCode) {
+    return (prefixCode >= OperationPrefixCode::IN && prefixCode <= OperationPrefixCode::POP) ||
+           (prefixCode >= OperationPrefixCode::VADD && prefixCode <= OperationPrefixCode::DTOI);
+}
+
+bool Decoder::isJump(char prefixCode) {
+    return hasTarget(prefixCode) || prefixCode == OperationPrefixCode::RET_ABS;
+}
+
+bool Decoder::hasTarget(int opcode) {
+    return (opcode >= OperationPrefixCode::JMP_OFFSET_EXACT_VAL && opcode <= OperationPrefixCode::CALL_OFFSET_EXACT_VAL) ||
+           (opcode >= OperationPrefixCode::IJE_OFFSET_EXACT_VAL && opcode <= OperationPrefixCode::IJBE_OFFSET_EXACT_VAL);
+}
+
+bool Decoder::isConditionalJump(int opcode) {
+    return (opcode >= OperationPrefixCode::JE_OFFSET_EXACT_VAL && opcode <= OperationPrefixCode::JBE_OFFSET_EXACT_VAL) ||
+           (opcode >= OperationPrefixCode::IJE_OFFSET_EXACT_VAL && opcode <= OperationPrefixCode::IJBE_OFFSET_EXACT_VAL);
+}
+
+double Decoder::getDouble(const char *buf) {
+    double res;
+    std::memcpy(&res, buf, sizeof (double));
+    return res;
+}
+
+int Decoder::getInt(const char *buf) {
+    int res;
+    std::memcpy(&res, buf, sizeof (int));
+    return res;
+}
+
+bool Decoder::isCommand(int prefixCode) {
+    return OperationPrefixCode::IN <= prefixCode && prefixCode <= OperationPrefixCode::PUSH_CONST;
+}
+
+int Decoder::getCommandLength(char prefixCode) {
+    assert(isCommand(prefixCode));
+
+    if (isNoArgsOperation(prefixCode))
+        return 1;
+    else if (isJump(prefixCode))
+        return 1 + sizeof (int);
+    else {
+        if (prefixCode == OperationPrefixCode::POP_REG_ADDR || prefixCode == OperationPrefixCode::PUSH_REG_VAL ||
+            prefixCode == OperationPrefixCode::PUSH_REG_ADDR || prefixCode == OperationPrefixCode::POP_REG_VAL)
+            return 2;
+        else if (prefixCode == OperationPrefixCode::PUSH_EXACT_ADDR ||
+                 prefixCode == OperationPrefixCode::POP_EXACT_ADDR ||
+                 prefixCode == OperationPrefixCode::PUSH_FRAME_SLOT ||
+                 prefixCode == OperationPrefixCode::POP_FRAME_SLOT ||
+                 prefixCode == OperationPrefixCode::PUSH_CONST)
+            return 1 + sizeof (int);
+        else
+            return 1 + sizeof (double);
+    }
+}
+
+Decoder::Decoder(const Executable &executable, int ramSize, DecodedProgram &program): _start(executable.code),
+    _size(executable.codeSize), _constants(executable.constants), _constantCount(executable.constantCount),
+    _ramSize(ramSize), _program(program), _offsetToIndex(_size > 0 ? _size : 0, -1), _invalidTargetIndex(-1) {
+}
+
+int Decoder::emit(unsigned char opcode, int offset) {
+    DecodedInstruction instruction;
+    instruction.opcode = opcode;
+    instruction.reg = 0;
+    instruction.arg = 0;
+    instruction.val = 0.0;
+
+    int index = _program.instructions.size();
+    _program.instructions.push_back(instruction);
+    _program.offsets.push_back(offset);
+    if (offset >= 0)
+        _offsetToIndex[offset] = index;
+    return index;
+}
+
+int Decoder::emitTrap(ProcessorStatus status, int offset) {
+    int index = emit(InternalOperationCode::TRAP, offset);
+    _program.instructions[index].arg = status;
+    return index;
+}
+
+int Decoder::decodeOne(int offset) {
+    char prefixCode = _start[offset];
+
+    if (!isCommand(prefixCode)) {
+        emitTrap(ProcessorStatus::UNRECOGNIZED_COMMAND, offset);
+        return -1;
+    }
+
+    int length = getCommandLength(prefixCode);
+    if (offset + length > _size) {
+        emitTrap(ProcessorStatus::COMMAND_ARG_ERROR, offset);
+        return -1;
+    }
+
+    if (isJump(prefixCode) && prefixCode != OperationPrefixCode::RET_ABS) {
+        int target = offset + getInt(_start + offset + 1);
+        int index = emit(prefixCode, offset);
+        //Stays a bytecode offset until resolveTargets
+        _program.instructions[index].arg = target;
+        if (target >= 0 && target < _size && _offsetToIndex[target] == -1)
+            _pendingOffsets.push_back(target);
+    } else if (isNoArgsOperation(prefixCode) || isJump(prefixCode)) {
+        emit(prefixCode, offset);
+    } else if (length == 2) {
+        char regCode = _start[offset + 1];
+        if (regCode < RegisterCode::AX || regCode > RegisterCode::DX) {
+            emitTrap(ProcessorStatus::COMMAND_ARG_ERROR, offset);
+            return -1;
+        }
+        int index = emit(prefixCode, offset);
+        _program.instructions[index].reg = regCode;
+    } else if (prefixCode == OperationPrefixCode::PUSH_EXACT_VAL) {
+        int index = emit(prefixCode, offset);
+        _program.instructions[index].val = getDouble(_start + offset + 1);
+    } else if (prefixCode == OperationPrefixCode::PUSH_CONST) {
+        //Raw bytecode has no pool, every index is out of it
+        int constant = getInt(_start + offset + 1);
+        if (constant < 0 || constant >= _constantCount) {
+            emitTrap(ProcessorStatus::COMMAND_ARG_ERROR, offset);
+            return -1;
+        }
+        int index = emit(OperationPrefixCode::PUSH_EXACT_VAL, offset);
+        _program.instructions[index].val = _constants[constant];
+    } else if (prefixCode == OperationPrefixCode::PUSH_FRAME_SLOT ||
+               prefixCode == OperationPrefixCode::POP_FRAME_SLOT) {
+        int index = emit(prefixCode, offset);
+        _program.instructions[index].arg = getInt(_start + offset + 1);
+        _program.frames = true;
+    } else {
+        int address = getInt(_start + offset + 1);
+        if (!RAM::isValidAddr(address, _ramSize)) {
+            emitTrap(ProcessorStatus::INVALID_RAM_ADDRESS, offset);
+        } else {
+            int index = emit(prefixCode, offset);
+            _program.instructions[index].arg = address;
+        }
+    }
+
+    return length;
+}
+
+void Decoder::decodeRun(int offset) {
+    bool fallsFromConditional = false;
+    while (true) {
+        if (offset >= _size) {
+            //Running off the end is a normal stop, except when a not taken conditional
+            //jump is the last operation, which the jump itself reports as bad target
+            emitTrap(fallsFromConditional ? ProcessorStatus::INVALID_INSTRUCTION_POINTER : ProcessorStatus::SUCCESS,
+                     -1);
+            return;
+        }
+        if (_offsetToIndex[offset] != -1) {
+            int index = emit(OperationPrefixCode::JMP_OFFSET_EXACT_VAL, -1);
+            _program.instructions[index].arg = offset;
+            return;
+        }
+
+        int length = decodeOne(offset);
+        if (length < 0)
+            return;
+
+        char prefixCode = _start[offset];
+        fallsFromConditional = isConditionalJump(prefixCode);
+        offset += length;
+    }
+}
+
+void Decoder::resolveTargets() {
+    int count = _program.instructions.size();
+    for (int i = 0; i < count; i++) {
+        unsigned char opcode = _program.instructions[i].opcode;
+        if (!hasTarget(opcode))
+            continue;
+
+        int target = _program.instructions[i].arg;
+        if (target >= 0 && target < _size) {
+            _program.instructions[i].arg = _offsetToIndex[target];
+            continue;
+        }
+
+        if (_invalidTargetIndex == -1)
+            _invalidTargetIndex = emitTrap(ProcessorStatus::INVALID_INSTRUCTION_POINTER, -1);
+        _program.instructions[i].arg = _invalidTargetIndex;
+    }
+}
+
+void Decoder::decode(const Executable &executable, DecodedProgram &program, int ramSize) {
+    int size = executable.codeSize;
+    program.instructions.clear();
+    program.offsets.clear();
+    program.verified = false;
+    program.frames = false;
+    program.symbols = executable.symbols;
+    program.instructions.reserve(size > 0 ? size / 2 + 2 : 1);
+
+    Decoder decoder(executable, ramSize, program);
+    decoder.decodeRun(executable.entry);
+    while (!decoder._pendingOffsets.empty()) {
+        int offset = decoder._pendingOffsets.back();
+        decoder._pendingOffsets.pop_back();
+        if (decoder._offsetToIndex[offset] == -1)
+            decoder.decodeRun(offset);
+    }
+    decoder.resolveTargets();
+}
+
+void Decoder::decode(const char *start, int size, DecodedProgram &program, int ramSize) {
+    decode(Executable::fromBytecode(start, size), program, ramSize);
+}
+
+std::string Decoder::describeOffset(const DecodedProgram &program, int offset) {
+    std::string description = "offset " + std::to_string(offset);
+    auto after = std::upper_bound(program.symbols.begin(), program.symbols.end(), offset,
+                                  [](int value, const ProgramSymbol &symbol) { return value < symbol.offset; });
+    if (after == program.symbols.begin())
+        return description;
+    const ProgramSymbol &symbol = *(after - 1);
+    description += " (" + symbol.name;
+    if (offset > symbol.offset)
+        description += "+" + std::to_string(offset - symbol.offset);
+    return description + ")";
+}
+
+//Unconditional jumps that only lead to another jump are followed this many times at most
+static constexpr int MAX_JUMP_HOPS = 8;
+
+//Index execution continues at when it reaches index, -1 for long or looping jump chains
+static int followJumps(const std::vector<DecodedInstruction> &code, int index) {
+    for (int hops = 0; code[index].opcode == OperationPrefixCode::JMP_OFFSET_EXACT_VAL; hops++) {
+        if (hops == MAX_JUMP_HOPS)
+            return -1;
+        index = code[index].arg;
+    }
+    return index;
+}
+
+int Decoder::eliminateTailCalls(DecodedProgram &program) {
+    std::vector<DecodedInstruction> &code = program.instructions;
+    int count = code.size();
+    int rewritten = 0;
+    for (int i = 0; i < count; i++) {
+        DecodedInstruction &instruction = code[i];
+        //A jump does not give the callee a frame of its own
+        if (instruction.opcode == OperationPrefixCode::CALL_OFFSET_EXACT_VAL && !program.frames) {
+            //Callee returns straight to our caller, the ret after the call may still be a jump target
+            int next = i + 1 < count ? followJumps(code, i + 1) : -1;
+            if (next >= 0 && code[next].opcode == OperationPrefixCode::RET_ABS) {
+                instruction.opcode = OperationPrefixCode::JMP_OFFSET_EXACT_VAL;
+                rewritten++;
+            }
+        } else if (instruction.opcode == OperationPrefixCode::JMP_OFFSET_EXACT_VAL) {
+            int target = followJumps(code, instruction.arg);
+            if (target >= 0 && code[target].opcode == OperationPrefixCode::RET_ABS) {
+                instruction.opcode = OperationPrefixCode::RET_ABS;
+                instruction.arg = 0;
+                rewritten++;
+            }
+        }
+    }
+    return rewritten;
+}
@@ -0,0 +1,181 @@
+#ifndef STACK_PROCESSOR_DECODER_H
+#define STACK_PROCESSOR_DECODER_H
+#include "../utils.h"
+#include "Executable.h"
+#include <string>
+#include <vector>
+
+//Opcodes that only exist in decoded programs and never appear in bytecode.
+//They start high enough not to collide with OperationPrefixCode.
+enum InternalOperationCode {
+    TRAP = 0x80, //Stops execution and returns the ProcessorStatus stored in arg
+
+    //Superinstructions produced by Fusion, see Fusion.cpp for the sequences they replace
+    FUSED_ADD_VAL,
+    FUSED_SUB_VAL,
+    FUSED_MUL_VAL,
+    FUSED_DIV_VAL,
+    FUSED_PUSH_REG_ADD_VAL,
+    FUSED_PUSH_REG_SUB_VAL,
+    FUSED_PUSH_REG_MUL_VAL,
+    FUSED_PUSH_REG_DIV_VAL,
+    FUSED_STORE_REG,
+    FUSED_SWAP_REGS,
+    FUSED_PUSH_VAL_JE,
+    FUSED_PUSH_VAL_JNE,
+    FUSED_PUSH_VAL_JA,
+    FUSED_PUSH_VAL_JAE,
+    FUSED_PUSH_VAL_JB,
+    FUSED_PUSH_VAL_JBE,
+    FUSED_JE_POP2,
+    FUSED_JNE_POP2,
+    FUSED_JA_POP2,
+    FUSED_JAE_POP2,
+    FUSED_JB_POP2,
+    FUSED_JBE_POP2,
+    FUSED_PUSH_VAL_JE_POP2,
+    FUSED_PUSH_VAL_JNE_POP2,
+    FUSED_PUSH_VAL_JA_POP2,
+    FUSED_PUSH_VAL_JAE_POP2,
+    FUSED_PUSH_VAL_JB_POP2,
+    FUSED_PUSH_VAL_JBE_POP2,
+    FUSED_IADD_VAL,
+    FUSED_ISUB_VAL,
+    FUSED_IMUL_VAL,
+    FUSED_PUSH_REG_IADD_VAL,
+    FUSED_PUSH_REG_ISUB_VAL,
+    FUSED_PUSH_REG_IMUL_VAL,
+    FUSED_PUSH_VAL_IJE,
+    FUSED_PUSH_VAL_IJNE,
+    FUSED_PUSH_VAL_IJA,
+    FUSED_PUSH_VAL_IJAE,
+    FUSED_PUSH_VAL_IJB,
+    FUSED_PUSH_VAL_IJBE,
+    FUSED_IJE_POP2,
+    FUSED_IJNE_POP2,
+    FUSED_IJA_POP2,
+    FUSED_IJAE_POP2,
+    FUSED_IJB_POP2,
+    FUSED_IJBE_POP2,
+    FUSED_PUSH_VAL_IJE_POP2,
+    FUSED_PUSH_VAL_IJNE_POP2,
+    FUSED_PUSH_VAL_IJA_POP2,
+    FUSED_PUSH_VAL_IJAE_POP2,
+    FUSED_PUSH_VAL_IJB_POP2,
+    FUSED_PUSH_VAL_IJBE_POP2,
+
+    //Trace tier, see Tracer.cpp
+    TRACE_ENTER, //Replaces the anchor instruction of a compiled trace, arg is the trace number
+    TRACE_GUARD_JE, //Stays in the trace if the condition holds, continues in program code at index arg otherwise
+    TRACE_GUARD_JNE,
+    TRACE_GUARD_JA,
+    TRACE_GUARD_JAE,
+    TRACE_GUARD_JB,
+    TRACE_GUARD_JBE,
+    TRACE_GUARD_IJE, //Integer comparisons in the same order
+    TRACE_GUARD_IJNE,
+    TRACE_GUARD_IJA,
+    TRACE_GUARD_IJAE,
+    TRACE_GUARD_IJB,
+    TRACE_GUARD_IJBE,
+    TRACE_CALL, //Pushes return index arg, the callee follows in the trace
+    TRACE_RET, //Stays in the trace if the return index is arg, returns to program code otherwise
+    TRACE_LOOP, //Back to the trace start, arg instructions before
+    TRACE_EXIT, //Continues in program code at index arg
+
+    //Memoized calls, see Memoizer.cpp
+    CALL_MEMO, //Call of the function at index arg answered from the cache if possible, val is the index of its MEMO_RETURN
+    MEMO_RETURN //Return address of recorded CALL_MEMO, caches the result and continues at index arg
+};
+
+//Fixed-size form of one bytecode operation. Operands are already assembled,
+//aligned and validated, jump and call targets are indices into the decoded array.
+struct DecodedInstruction {
+    unsigned char opcode;
+    unsigned char reg;
+    int arg; //Target instruction index, RAM address, frame slot offset or trap status
+    double val; //Immediate value of PUSH_EXACT_VAL
+};
+
+static_assert(sizeof (DecodedInstruction) == 16, "DecodedInstruction should stay compact");
+
+struct DecodedProgram {
+    std::vector<DecodedInstruction> instructions;
+    //Bytecode offset of every decoded instruction, -1 for synthetic ones
+    std::vector<int> offsets;
+    //Set once Verifier accepted the program, it then runs without dynamic safety checks
+    bool verified = false;
+    //Has frame slot operations, calls then save the frame pointer and ret restores it
+    bool frames = false;
+    //Labels of the executable sorted by offset, empty for raw bytecode
+    std::vector<ProgramSymbol> symbols;
+};
+
+class Decoder {
+private:
+    const char *_start;
+    int _size;
+    const double *_constants;
+    int _constantCount;
+    int _ramSize;
+    DecodedProgram &_program;
+    std::vector<int> _offsetToIndex;
+    std::vector<int> _pendingOffsets;
+    int _invalidTargetIndex;
+
+    static bool isNoArgsOperation(char prefixCode);
+
+    static bool isJump(char prefixCode);
+
+    //Need to ensure buf contains enough bytes
+    static double getDouble(const char *buf);
+
+    //Need to ensure buf contains enough bytes
+    static int getInt(const char *buf);
+
+    int emit(unsigned char opcode, int offset);
+
+    int emitTrap(ProcessorStatus status, int offset);
+
+    //Decodes instructions starting at offset until the end of code, an undecodable
+    //byte or an already decoded offset is reached
+    void decodeRun(int offset);
+
+    //Returns index of the emitted instruction or -1 if decoding of this run must stop
+    int decodeOne(int offset);
+
+    void resolveTargets();
+
+    Decoder(const Executable &executable, int ramSize, DecodedProgram &program);
+
+public:
+    static bool isCommand(int prefixCode);
+
+    //Jumps and calls, their arg is a target instruction index once decoded
+    static bool hasTarget(int opcode);
+
+    //Jumps that fall through when their condition does not hold, double or integer comparisons
+    static bool isConditionalJump(int opcode);
+
+    //Command length in bytes
+    static int getCommandLength(char prefixCode);
+
+    //Bytes that cannot be executed are decoded into TRAP instructions, so the
+    //error is only reported if execution actually reaches them. Constant RAM
+    //addresses are checked against ramSize. The entry point becomes instruction 0 and
+    //PUSH_CONST becomes PUSH_EXACT_VAL of the pool entry
+    static void decode(const Executable &executable, DecodedProgram &program, int ramSize);
+
+    //Raw bytecode, see Executable::fromBytecode
+    static void decode(const char *start, int size, DecodedProgram &program, int ramSize);
+
+    //"offset 12" or with the nearest symbol at or before it "offset 12 (square+4)"
+    static std::string describeOffset(const DecodedProgram &program, int offset);
+
+    //Turns calls followed by ret into jumps and jumps to ret into ret, so tail calls do not
+    //grow the call stack. Calls are kept in programs with frame slots. Returns the number of
+    //rewritten instructions
+    static int eliminateTailCalls(DecodedProgram &program);
+};
+
+#endif //STACK_PROCESSOR_DECODER_H
@@ -0,0 +1,90 @@
+#include "Executable.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+//Section of count items of itemSize bytes at offset lies within the file
+static bool isInFile(long long offset, long long count, long long itemSize, size_t size) {
+    return offset >= 0 && count >= 0 && offset + count * itemSize <= static_cast<long long>(size);
+}
+
+Executable Executable::fromBytecode(const char *code, int size) {
+    Executable executable;
+    executable.code = code;
+    executable.codeSize = size;
+    executable.constants = nullptr;
+    executable.constantCount = 0;
+    executable.entry = 0;
+    return executable;
+}
+
+bool Executable::load(const char *begin, size_t size, Executable &executable, std::string &error) {
+    if (size < sizeof (EXECUTABLE_MAGIC) || std::memcmp(begin, EXECUTABLE_MAGIC, sizeof (EXECUTABLE_MAGIC)) != 0) {
+        if (size > static_cast<size_t>(std::numeric_limits<int>::max())) {
+            error = "program is too large";
+            return false;
+        }
+        executable = fromBytecode(begin, size);
+        return true;
+    }
+
+    ExecutableHeader header;
+    if (size < sizeof (header)) {
+        error = "truncated header";
+        return false;
+    }
+    std::memcpy(&header, begin, sizeof (header));
+    if (header.version != EXECUTABLE_VERSION) {
+        error = "version " + std::to_string(header.version) + " is not supported, expected " +
+                std::to_string(EXECUTABLE_VERSION);
+        return false;
+    }
+    if (!isInFile(header.codeOffset, header.codeSize, 1, size)) {
+        error = "code section is out of the file";
+        return false;
+    }
+    //Constants are read in place, the pool has to be aligned for that
+    if (!isInFile(header.constantsOffset, header.constantCount, sizeof (double), size) ||
+        header.constantsOffset % alignof (double) != 0 ||
+        reinterpret_cast<uintptr_t>(begin) % alignof (double) != 0) {
+        error = "constant pool is out of the file or not aligned";
+        return false;
+    }
+    if (header.entry < 0 || header.entry > header.codeSize) {
+        error = "entry point is out of the code";
+        return false;
+    }
+
+    executable.code = begin + header.codeOffset;
+    executable.codeSize = header.codeSize;
+    executable.constants = reinterpret_cast<const double *>(begin + header.constantsOffset);
+    executable.constantCount = header.constantCount;
+    executable.entry = header.entry;
+    executable.symbols.clear();
+
+    if (header.symbolCount < 0 || (header.symbolCount > 0 && !isInFile(header.symbolsOffset, 0, 1, size))) {
+        error = "symbol table is out of the file";
+        return false;
+    }
+    const char *cur = begin + header.symbolsOffset;
+    const char *end = begin + size;
+    for (int i = 0; i < header.symbolCount; i++) {
+        int fields[2];
+        if (end - cur < static_cast<long>(sizeof (fields))) {
+            error = "symbol table is out of the file";
+            return false;
+        }
+        std::memcpy(fields, cur, sizeof (fields));
+        cur += sizeof (fields);
+        if (fields[0] < 0 || fields[0] > header.codeSize || fields[1] <= 0 || end - cur < fields[1]) {
+            error = "symbol " + std::to_string(i) + " is damaged";
+            return false;
+        }
+        executable.symbols.push_back({fields[0], std::string(cur, fields[1])});
+        cur += fields[1];
+    }
+    std::stable_sort(executable.symbols.begin(), executable.symbols.end(),
+                     [](const ProgramSymbol &a, const ProgramSymbol &b) { return a.offset < b.offset; });
+    return true;
+}
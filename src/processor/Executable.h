@@ -0,0 +1,33 @@
+#ifndef STACK_PROCESSOR_EXECUTABLE_H
+#define STACK_PROCESSOR_EXECUTABLE_H
+#include "../utils.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+//Label of the program at a code offset, names functions in profiles and diagnostics
+struct ProgramSymbol {
+    int offset;
+    std::string name;
+};
+
+//Program as it lies in the mapped file, code and constants are not copied
+struct Executable {
+    const char *code;
+    int codeSize;
+    const double *constants;
+    int constantCount;
+    int entry;
+    //Sorted by offset
+    std::vector<ProgramSymbol> symbols;
+
+    //Raw bytecode has no constants and symbols and starts at offset 0
+    static Executable fromBytecode(const char *code, int size);
+
+    //Bytes starting with EXECUTABLE_MAGIC are checked as an executable, any others are raw bytecode.
+    //begin has to be 8-byte aligned, as a mapping is. Returns false and sets error if the header,
+    //a section or the version is not one this processor can run
+    static bool load(const char *begin, size_t size, Executable &executable, std::string &error);
+};
+
+#endif //STACK_PROCESSOR_EXECUTABLE_H
@@ -0,0 +1,1023 @@
+#include "Processor.h"
+#include "IntegerOperations.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+ProcessorStatus Processor::execute(const DecodedProgram &program) {
+    reset();
+    ProcessorStatus status = resume(program, 0);
+    _io->flush();
+    return status;
+}
+
+ProcessorStatus Processor::resume(const DecodedProgram &program, int start) {
+    //Neither calls nor pushes check the stack capacity, the push beyond it faults and lands here
+    GuardScope calls;
+    StackGuard::enter(calls, _call_stack.getRegion());
+    if (sigsetjmp(calls.jump, 0) != 0) {
+        StackGuard::leave(calls);
+        return ProcessorStatus::CALL_STACK_OVERFLOW;
+    }
+    GuardScope data;
+    StackGuard::enter(data, _data_stack_region);
+    if (sigsetjmp(data.jump, 0) != 0) {
+        StackGuard::leave(data);
+        StackGuard::leave(calls);
+        _data_stack_top = _data_stack_base + _data_stack_capacity;
+        return ProcessorStatus::DATA_STACK_OVERFLOW;
+    }
+
+    ProcessorStatus status;
+    //Traces patch the program they were recorded from, profiles count its instructions
+    if (_profiler && &program == &_program)
+        status = resume<false, true>(program, start);
+    else if (_tracer && &program == &_program)
+        status = resume<true, false>(program, start);
+    else
+        status = resume<false, false>(program, start);
+    StackGuard::leave(data);
+    StackGuard::leave(calls);
+    return status;
+}
+
+template <bool Tracing, bool Profiling>
+ProcessorStatus Processor::resume(const DecodedProgram &program, int start) {
+    bool threaded = _dispatch_mode == DispatchMode::THREADED_DISPATCH;
+
+    if (program.verified) {
+        if (threaded)
+            return _top_of_stack_caching ? run<true, true, false, Tracing, Profiling>(program, start) :
+                   run<true, false, false, Tracing, Profiling>(program, start);
+        return _top_of_stack_caching ? run<false, true, false, Tracing, Profiling>(program, start) :
+               run<false, false, false, Tracing, Profiling>(program, start);
+    }
+    if (threaded)
+        return _top_of_stack_caching ? run<true, true, true, Tracing, Profiling>(program, start) :
+               run<true, false, true, Tracing, Profiling>(program, start);
+    return _top_of_stack_caching ? run<false, true, true, Tracing, Profiling>(program, start) :
+           run<false, false, true, Tracing, Profiling>(program, start);
+}
+
+//Labels-as-values are a GNU extension, other compilers always use the switch
+#if defined(__GNUC__)
+#define PROCESSOR_COMPUTED_GOTO 1
+#define HANDLER(label) label:
+#define DISPATCH() do { \
+    if (Profiling) \
+        _profiler->count(ins - code); \
+    if (Threaded) \
+        goto *dispatchTable[ins->opcode]; \
+    if (Tracing && recording) \
+        goto record; \
+    goto dispatch; \
+} while (0)
+//While recording every dispatch table entry leads to the recorder, handlerTable keeps the handlers
+#define START_RECORDING() do { \
+    recording = true; \
+    if (Threaded && Tracing) \
+        std::fill(dispatchTable, dispatchTable + 256, &&record); \
+} while (0)
+#define STOP_RECORDING() do { \
+    recording = false; \
+    if (Threaded && Tracing) \
+        std::copy(handlerTable, handlerTable + 256, dispatchTable); \
+} while (0)
+#else
+#define HANDLER(label)
+#define DISPATCH() do { \
+    if (Profiling) \
+        _profiler->count(ins - code); \
+    if (Tracing && recording) \
+        goto record; \
+    goto dispatch; \
+} while (0)
+#define START_RECORDING() do { recording = true; } while (0)
+#define STOP_RECORDING() do { recording = false; } while (0)
+#endif
+
+//Data stack occupies base[0, sp - base). With CacheTop the topmost value lives in tos
+//and its memory slot sp[-1] is stale, base[-1] is a spare slot so pushing on an empty
+//stack and popping the last value need no branches. The guard page starts at limit.
+#define DEPTH() (sp - base)
+#define TOP (CacheTop ? tos : sp[-1])
+#define SECOND (sp[-2])
+
+#define EXIT(status) do { \
+    if (CacheTop && sp > base) \
+        sp[-1] = tos; \
+    _data_stack_top = sp; \
+    _frame_pointer = fp - base; \
+    return (status); \
+} while (0)
+
+//Verifier guarantees these checks never fire for programs that run with Checked off
+#define REQUIRE(count) do { \
+    if (Checked && DEPTH() < (count)) \
+        EXIT(ProcessorStatus::DATA_STACK_UNDERFLOW); \
+} while (0)
+
+//Reads the slot a push fills. Beyond capacity it lies in the guard page, the read faults
+//before anything changes
+#define PROBE(slot) do { \
+    (void) *static_cast<volatile double *>(slot); \
+} while (0)
+
+//Fused sequences that leave out pushes probe the slot the last of them would have filled
+#define RESERVE(count) PROBE(sp + (count) - 1)
+
+//With CacheTop the store goes to the slot below, a second store to the new slot would be
+//slow whenever the two are on different pages, so it is probed instead
+#define PUSH(value) do { \
+    double pushed = (value); \
+    if (CacheTop) { \
+        PROBE(sp); \
+        sp[-1] = tos; \
+        tos = pushed; \
+    } else { \
+        *sp = pushed; \
+    } \
+    sp++; \
+} while (0)
+
+//Calls in programs with frame slots give the callee a frame starting at the current depth.
+//The call stack is pushed first, so calling too deep faults in its guard page
+#define ENTER_FRAME() do { \
+    if (frames) { \
+        _frame_stack.push_back(fp - base); \
+        fp = sp; \
+    } \
+} while (0)
+
+#define LEAVE_FRAME() do { \
+    if (frames) { \
+        fp = base + _frame_stack.back(); \
+        _frame_stack.pop_back(); \
+    } \
+} while (0)
+
+#define DROP(count) do { \
+    sp -= (count); \
+    if (CacheTop) \
+        tos = sp[-1]; \
+} while (0)
+
+#define BINARY_OPERATION(op) do { \
+    REQUIRE(2); \
+    left = SECOND; \
+    right = TOP; \
+    sp--; \
+    TOP = left op right; \
+    ins++; \
+    DISPATCH(); \
+} while (0)
+
+//Stack values read and written as 64-bit integers
+#define TOP_INTEGER IntegerOperations::getBits(TOP)
+#define SECOND_INTEGER IntegerOperations::getBits(SECOND)
+
+#define INTEGER_BINARY_OPERATION(operation) do { \
+    REQUIRE(2); \
+    ileft = SECOND_INTEGER; \
+    iright = TOP_INTEGER; \
+    sp--; \
+    TOP = IntegerOperations::fromBits(operation); \
+    ins++; \
+    DISPATCH(); \
+} while (0)
+
+#define INTEGER_DIVISION(operation) do { \
+    REQUIRE(2); \
+    iright = TOP_INTEGER; \
+    if (iright == 0) \
+        EXIT(ProcessorStatus::INTEGER_DIVISION_BY_ZERO); \
+    ileft = SECOND_INTEGER; \
+    sp--; \
+    TOP = IntegerOperations::fromBits(IntegerOperations::operation(ileft, iright)); \
+    ins++; \
+    DISPATCH(); \
+} while (0)
+
+#define CONDITION_JE(left, right) (std::fabs((right) - (left)) < PROCESSOR_EPSILON)
+#define CONDITION_JNE(left, right) (std::fabs((right) - (left)) >= PROCESSOR_EPSILON)
+#define CONDITION_JA(left, right) ((left) > (right) + PROCESSOR_EPSILON)
+#define CONDITION_JAE(left, right) (CONDITION_JA(left, right) || CONDITION_JE(left, right))
+#define CONDITION_JB(left, right) ((left) + PROCESSOR_EPSILON < (right))
+#define CONDITION_JBE(left, right) (CONDITION_JB(left, right) || CONDITION_JE(left, right))
+
+//Integer comparisons of the same stack values, so the jump macros below serve both kinds
+#define CONDITION_IJE(left, right) (IntegerOperations::getBits(left) == IntegerOperations::getBits(right))
+#define CONDITION_IJNE(left, right) (IntegerOperations::getBits(left) != IntegerOperations::getBits(right))
+#define CONDITION_IJA(left, right) (IntegerOperations::getBits(left) > IntegerOperations::getBits(right))
+#define CONDITION_IJAE(left, right) (IntegerOperations::getBits(left) >= IntegerOperations::getBits(right))
+#define CONDITION_IJB(left, right) (IntegerOperations::getBits(left) < IntegerOperations::getBits(right))
+#define CONDITION_IJBE(left, right) (IntegerOperations::getBits(left) <= IntegerOperations::getBits(right))
+
+#define CONDITIONAL_JUMP(cond) do { \
+    REQUIRE(2); \
+    left = SECOND; \
+    right = TOP; \
+    ins = CONDITION_##cond(left, right) ? code + ins->arg : ins + 1; \
+    DISPATCH(); \
+} while (0)
+
+//push val; jcc
+#define FUSED_PUSH_VAL_CONDITIONAL_JUMP(cond) do { \
+    REQUIRE(1); \
+    left = TOP; \
+    PUSH(ins->val); \
+    ins = CONDITION_##cond(left, ins->val) ? code + ins->arg : ins + 2; \
+    DISPATCH(); \
+} while (0)
+
+//jcc; popd; popd
+#define FUSED_CONDITIONAL_JUMP_POP2(cond) do { \
+    REQUIRE(2); \
+    left = SECOND; \
+    right = TOP; \
+    if (CONDITION_##cond(left, right)) { \
+        ins = code + ins->arg; \
+    } else { \
+        DROP(2); \
+        ins += 3; \
+    } \
+    DISPATCH(); \
+} while (0)
+
+//push val; jcc; popd; popd
+#define FUSED_PUSH_VAL_CONDITIONAL_JUMP_POP2(cond) do { \
+    REQUIRE(1); \
+    RESERVE(1); \
+    if (CONDITION_##cond(TOP, ins->val)) { \
+        PUSH(ins->val); \
+        ins = code + ins->arg; \
+    } else { \
+        DROP(1); \
+        ins += 4; \
+    } \
+    DISPATCH(); \
+} while (0)
+
+//push val; op
+#define FUSED_ARITHMETIC_VAL(op) do { \
+    REQUIRE(1); \
+    RESERVE(1); \
+    TOP = TOP op ins->val; \
+    ins += 2; \
+    DISPATCH(); \
+} while (0)
+
+//push reg; push val; op
+#define FUSED_PUSH_REG_ARITHMETIC_VAL(op) do { \
+    RESERVE(2); \
+    PUSH(_reg[ins->reg].db_val op ins->val); \
+    ins += 3; \
+    DISPATCH(); \
+} while (0)
+
+//ipush val; op
+#define FUSED_INTEGER_ARITHMETIC_VAL(operation) do { \
+    REQUIRE(1); \
+    RESERVE(1); \
+    TOP = IntegerOperations::fromBits(IntegerOperations::operation(TOP_INTEGER, IntegerOperations::getBits(ins->val))); \
+    ins += 2; \
+    DISPATCH(); \
+} while (0)
+
+//push reg; ipush val; op
+#define FUSED_PUSH_REG_INTEGER_ARITHMETIC_VAL(operation) do { \
+    RESERVE(2); \
+    PUSH(IntegerOperations::fromBits(IntegerOperations::operation(IntegerOperations::getBits(_reg[ins->reg].db_val), \
+                                                                  IntegerOperations::getBits(ins->val)))); \
+    ins += 3; \
+    DISPATCH(); \
+} while (0)
+
+//Conditional jump a trace recorded as taken
+#define TRACE_GUARD(cond) do { \
+    REQUIRE(2); \
+    left = SECOND; \
+    right = TOP; \
+    ins = CONDITION_##cond(left, right) ? ins + 1 : code + ins->arg; \
+    DISPATCH(); \
+} while (0)
+
+template <bool Threaded, bool CacheTop, bool Checked, bool Tracing, bool Profiling>
+ProcessorStatus Processor::run(const DecodedProgram &program, int start) {
+    const DecodedInstruction *code = program.instructions.data();
+    const DecodedInstruction *ins = code + start;
+    double *const base = _data_stack_base;
+    double *const limit = _data_stack_base + _data_stack_capacity;
+    double *sp = _data_stack_top;
+    double tos = sp > base ? sp[-1] : 0.0;
+    //Data stack slot the frame slots of the running function are counted from
+    const bool frames = program.frames;
+    double *fp = base + _frame_pointer;
+    double *slot;
+    double left, right;
+    long long ileft, iright;
+    int addr;
+    int needed, pushed;
+    ProcessorStatus status;
+    //Tracer sees every instruction before it is executed
+    bool recording = false;
+
+#ifdef PROCESSOR_COMPUTED_GOTO
+    const void *dispatchTable[256];
+    const void *handlerTable[256];
+    if (Threaded) {
+        for (const void *&label : dispatchTable)
+            label = &&op_unknown;
+        dispatchTable[OperationPrefixCode::IN] = &&op_in;
+        dispatchTable[OperationPrefixCode::OUT] = &&op_out;
+        dispatchTable[OperationPrefixCode::ADD] = &&op_add;
+        dispatchTable[OperationPrefixCode::SUB] = &&op_sub;
+        dispatchTable[OperationPrefixCode::MUL] = &&op_mul;
+        dispatchTable[OperationPrefixCode::DIV] = &&op_div;
+        dispatchTable[OperationPrefixCode::SIN] = &&op_sin;
+        dispatchTable[OperationPrefixCode::COS] = &&op_cos;
+        dispatchTable[OperationPrefixCode::SQRT] = &&op_sqrt;
+        dispatchTable[OperationPrefixCode::RET_ABS] = &&op_ret;
+        dispatchTable[OperationPrefixCode::HALT] = &&op_halt;
+        dispatchTable[OperationPrefixCode::POP] = &&op_pop;
+        dispatchTable[OperationPrefixCode::PUSH_REG_VAL] = &&op_push_reg_val;
+        dispatchTable[OperationPrefixCode::PUSH_EXACT_VAL] = &&op_push_exact_val;
+        dispatchTable[OperationPrefixCode::PUSH_REG_ADDR] = &&op_push_reg_addr;
+        dispatchTable[OperationPrefixCode::PUSH_EXACT_ADDR] = &&op_push_exact_addr;
+        dispatchTable[OperationPrefixCode::POP_REG_VAL] = &&op_pop_reg_val;
+        dispatchTable[OperationPrefixCode::POP_EXACT_ADDR] = &&op_pop_exact_addr;
+        dispatchTable[OperationPrefixCode::POP_REG_ADDR] = &&op_pop_reg_addr;
+        dispatchTable[OperationPrefixCode::JMP_OFFSET_EXACT_VAL] = &&op_jmp;
+        dispatchTable[OperationPrefixCode::JE_OFFSET_EXACT_VAL] = &&op_je;
+        dispatchTable[OperationPrefixCode::JNE_OFFSET_EXACT_VAL] = &&op_jne;
+        dispatchTable[OperationPrefixCode::JA_OFFSET_EXACT_VAL] = &&op_ja;
+        dispatchTable[OperationPrefixCode::JAE_OFFSET_EXACT_VAL] = &&op_jae;
+        dispatchTable[OperationPrefixCode::JB_OFFSET_EXACT_VAL] = &&op_jb;
+        dispatchTable[OperationPrefixCode::JBE_OFFSET_EXACT_VAL] = &&op_jbe;
+        dispatchTable[OperationPrefixCode::CALL_OFFSET_EXACT_VAL] = &&op_call;
+        dispatchTable[OperationPrefixCode::PUSH_FRAME_SLOT] = &&op_push_frame_slot;
+        dispatchTable[OperationPrefixCode::POP_FRAME_SLOT] = &&op_pop_frame_slot;
+        for (int opcode = OperationPrefixCode::VADD; opcode <= OperationPrefixCode::VCOPY; opcode++)
+            dispatchTable[opcode] = &&op_vector;
+        dispatchTable[OperationPrefixCode::IADD] = &&op_iadd;
+        dispatchTable[OperationPrefixCode::ISUB] = &&op_isub;
+        dispatchTable[OperationPrefixCode::IMUL] = &&op_imul;
+        dispatchTable[OperationPrefixCode::IDIV] = &&op_idiv;
+        dispatchTable[OperationPrefixCode::IREM] = &&op_irem;
+        dispatchTable[OperationPrefixCode::IAND] = &&op_iand;
+        dispatchTable[OperationPrefixCode::IOR] = &&op_ior;
+        dispatchTable[OperationPrefixCode::IXOR] = &&op_ixor;
+        dispatchTable[OperationPrefixCode::ISHL] = &&op_ishl;
+        dispatchTable[OperationPrefixCode::ISHR] = &&op_ishr;
+        dispatchTable[OperationPrefixCode::ITOD] = &&op_itod;
+        dispatchTable[OperationPrefixCode::DTOI] = &&op_dtoi;
+        dispatchTable[OperationPrefixCode::IJE_OFFSET_EXACT_VAL] = &&op_ije;
+        dispatchTable[OperationPrefixCode::IJNE_OFFSET_EXACT_VAL] = &&op_ijne;
+        dispatchTable[OperationPrefixCode::IJA_OFFSET_EXACT_VAL] = &&op_ija;
+        dispatchTable[OperationPrefixCode::IJAE_OFFSET_EXACT_VAL] = &&op_ijae;
+        dispatchTable[OperationPrefixCode::IJB_OFFSET_EXACT_VAL] = &&op_ijb;
+        dispatchTable[OperationPrefixCode::IJBE_OFFSET_EXACT_VAL] = &&op_ijbe;
+        dispatchTable[InternalOperationCode::TRAP] = &&op_trap;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_VAL_JE] = &&op_fused_push_val_je;
+        dispatchTable[InternalOperationCode::FUSED_JE_POP2] = &&op_fused_je_pop2;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_VAL_JE_POP2] = &&op_fused_push_val_je_pop2;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_VAL_JNE] = &&op_fused_push_val_jne;
+        dispatchTable[InternalOperationCode::FUSED_JNE_POP2] = &&op_fused_jne_pop2;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_VAL_JNE_POP2] = &&op_fused_push_val_jne_pop2;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_VAL_JA] = &&op_fused_push_val_ja;
+        dispatchTable[InternalOperationCode::FUSED_JA_POP2] = &&op_fused_ja_pop2;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_VAL_JA_POP2] = &&op_fused_push_val_ja_pop2;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_VAL_JAE] = &&op_fused_push_val_jae;
+        dispatchTable[InternalOperationCode::FUSED_JAE_POP2] = &&op_fused_jae_pop2;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_VAL_JAE_POP2] = &&op_fused_push_val_jae_pop2;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_VAL_JB] = &&op_fused_push_val_jb;
+        dispatchTable[InternalOperationCode::FUSED_JB_POP2] = &&op_fused_jb_pop2;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_VAL_JB_POP2] = &&op_fused_push_val_jb_pop2;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_VAL_JBE] = &&op_fused_push_val_jbe;
+        dispatchTable[InternalOperationCode::FUSED_JBE_POP2] = &&op_fused_jbe_pop2;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_VAL_JBE_POP2] = &&op_fused_push_val_jbe_pop2;
+        dispatchTable[InternalOperationCode::FUSED_ADD_VAL] = &&op_fused_add_val;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_REG_ADD_VAL] = &&op_fused_push_reg_add_val;
+        dispatchTable[InternalOperationCode::FUSED_SUB_VAL] = &&op_fused_sub_val;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_REG_SUB_VAL] = &&op_fused_push_reg_sub_val;
+        dispatchTable[InternalOperationCode::FUSED_MUL_VAL] = &&op_fused_mul_val;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_REG_MUL_VAL] = &&op_fused_push_reg_mul_val;
+        dispatchTable[InternalOperationCode::FUSED_DIV_VAL] = &&op_fused_div_val;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_REG_DIV_VAL] = &&op_fused_push_reg_div_val;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_VAL_IJE] = &&op_fused_push_val_ije;
+        dispatchTable[InternalOperationCode::FUSED_IJE_POP2] = &&op_fused_ije_pop2;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_VAL_IJE_POP2] = &&op_fused_push_val_ije_pop2;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_VAL_IJNE] = &&op_fused_push_val_ijne;
+        dispatchTable[InternalOperationCode::FUSED_IJNE_POP2] = &&op_fused_ijne_pop2;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_VAL_IJNE_POP2] = &&op_fused_push_val_ijne_pop2;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_VAL_IJA] = &&op_fused_push_val_ija;
+        dispatchTable[InternalOperationCode::FUSED_IJA_POP2] = &&op_fused_ija_pop2;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_VAL_IJA_POP2] = &&op_fused_push_val_ija_pop2;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_VAL_IJAE] = &&op_fused_push_val_ijae;
+        dispatchTable[InternalOperationCode::FUSED_IJAE_POP2] = &&op_fused_ijae_pop2;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_VAL_IJAE_POP2] = &&op_fused_push_val_ijae_pop2;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_VAL_IJB] = &&op_fused_push_val_ijb;
+        dispatchTable[InternalOperationCode::FUSED_IJB_POP2] = &&op_fused_ijb_pop2;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_VAL_IJB_POP2] = &&op_fused_push_val_ijb_pop2;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_VAL_IJBE] = &&op_fused_push_val_ijbe;
+        dispatchTable[InternalOperationCode::FUSED_IJBE_POP2] = &&op_fused_ijbe_pop2;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_VAL_IJBE_POP2] = &&op_fused_push_val_ijbe_pop2;
+        dispatchTable[InternalOperationCode::FUSED_IADD_VAL] = &&op_fused_iadd_val;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_REG_IADD_VAL] = &&op_fused_push_reg_iadd_val;
+        dispatchTable[InternalOperationCode::FUSED_ISUB_VAL] = &&op_fused_isub_val;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_REG_ISUB_VAL] = &&op_fused_push_reg_isub_val;
+        dispatchTable[InternalOperationCode::FUSED_IMUL_VAL] = &&op_fused_imul_val;
+        dispatchTable[InternalOperationCode::FUSED_PUSH_REG_IMUL_VAL] = &&op_fused_push_reg_imul_val;
+        dispatchTable[InternalOperationCode::FUSED_STORE_REG] = &&op_fused_store_reg;
+        dispatchTable[InternalOperationCode::FUSED_SWAP_REGS] = &&op_fused_swap_regs;
+        dispatchTable[InternalOperationCode::TRACE_ENTER] = &&op_trace_enter;
+        dispatchTable[InternalOperationCode::TRACE_GUARD_JE] = &&op_trace_guard_je;
+        dispatchTable[InternalOperationCode::TRACE_GUARD_JNE] = &&op_trace_guard_jne;
+        dispatchTable[InternalOperationCode::TRACE_GUARD_JA] = &&op_trace_guard_ja;
+        dispatchTable[InternalOperationCode::TRACE_GUARD_JAE] = &&op_trace_guard_jae;
+        dispatchTable[InternalOperationCode::TRACE_GUARD_JB] = &&op_trace_guard_jb;
+        dispatchTable[InternalOperationCode::TRACE_GUARD_JBE] = &&op_trace_guard_jbe;
+        dispatchTable[InternalOperationCode::TRACE_GUARD_IJE] = &&op_trace_guard_ije;
+        dispatchTable[InternalOperationCode::TRACE_GUARD_IJNE] = &&op_trace_guard_ijne;
+        dispatchTable[InternalOperationCode::TRACE_GUARD_IJA] = &&op_trace_guard_ija;
+        dispatchTable[InternalOperationCode::TRACE_GUARD_IJAE] = &&op_trace_guard_ijae;
+        dispatchTable[InternalOperationCode::TRACE_GUARD_IJB] = &&op_trace_guard_ijb;
+        dispatchTable[InternalOperationCode::TRACE_GUARD_IJBE] = &&op_trace_guard_ijbe;
+        dispatchTable[InternalOperationCode::TRACE_CALL] = &&op_trace_call;
+        dispatchTable[InternalOperationCode::TRACE_RET] = &&op_trace_ret;
+        dispatchTable[InternalOperationCode::TRACE_LOOP] = &&op_trace_loop;
+        dispatchTable[InternalOperationCode::TRACE_EXIT] = &&op_trace_exit;
+        dispatchTable[InternalOperationCode::CALL_MEMO] = &&op_call_memo;
+        dispatchTable[InternalOperationCode::MEMO_RETURN] = &&op_memo_return;
+        if (Tracing)
+            std::copy(dispatchTable, dispatchTable + 256, handlerTable);
+    }
+#endif
+
+    DISPATCH();
+
+    //Only reached while recording, which never happens inside a trace
+record:
+    if (!_tracer->record(_program, ins - code))
+        STOP_RECORDING();
+#ifdef PROCESSOR_COMPUTED_GOTO
+    if (Threaded && Tracing)
+        goto *handlerTable[ins->opcode];
+#endif
+
+dispatch:
+    switch (ins->opcode) {
+        case OperationPrefixCode::IN:
+        HANDLER(op_in)
+            PUSH(readInput());
+            ins++;
+            DISPATCH();
+        case OperationPrefixCode::OUT:
+        HANDLER(op_out)
+            REQUIRE(1);
+            writeOutput(TOP);
+            DROP(1);
+            ins++;
+            DISPATCH();
+        case OperationPrefixCode::ADD:
+        HANDLER(op_add)
+            BINARY_OPERATION(+);
+        case OperationPrefixCode::SUB:
+        HANDLER(op_sub)
+            BINARY_OPERATION(-);
+        case OperationPrefixCode::MUL:
+        HANDLER(op_mul)
+            BINARY_OPERATION(*);
+        case OperationPrefixCode::DIV:
+        HANDLER(op_div)
+            BINARY_OPERATION(/);
+        case OperationPrefixCode::SIN:
+        HANDLER(op_sin)
+            REQUIRE(1);
+            TOP = std::sin(TOP);
+            ins++;
+            DISPATCH();
+        case OperationPrefixCode::COS:
+        HANDLER(op_cos)
+            REQUIRE(1);
+            TOP = std::cos(TOP);
+            ins++;
+            DISPATCH();
+        case OperationPrefixCode::SQRT:
+        HANDLER(op_sqrt)
+            REQUIRE(1);
+            TOP = std::sqrt(TOP);
+            ins++;
+            DISPATCH();
+        case OperationPrefixCode::RET_ABS:
+        HANDLER(op_ret)
+            if (Checked && _call_stack.empty())
+                EXIT(ProcessorStatus::CALL_STACK_UNDERFLOW);
+            ins = code + _call_stack.back();
+            _call_stack.pop_back();
+            LEAVE_FRAME();
+            if (Profiling)
+                _profiler->leave();
+            DISPATCH();
+        case OperationPrefixCode::HALT:
+        HANDLER(op_halt)
+            EXIT(ProcessorStatus::SUCCESS);
+        case OperationPrefixCode::POP:
+        HANDLER(op_pop)
+            REQUIRE(1);
+            DROP(1);
+            ins++;
+            DISPATCH();
+        case OperationPrefixCode::PUSH_REG_VAL:
+        HANDLER(op_push_reg_val)
+            PUSH(_reg[ins->reg].db_val);
+            ins++;
+            DISPATCH();
+        case OperationPrefixCode::PUSH_EXACT_VAL:
+        HANDLER(op_push_exact_val)
+            PUSH(ins->val);
+            ins++;
+            DISPATCH();
+        case OperationPrefixCode::PUSH_REG_ADDR:
+        HANDLER(op_push_reg_addr)
+            if (!_ram->isValidAddr(static_cast<long long>(_reg[ins->reg].ull_val)))
+                EXIT(ProcessorStatus::INVALID_RAM_ADDRESS);
+            addr = _reg[ins->reg].ull_val;
+            PUSH(_ram->load(addr));
+            ins++;
+            DISPATCH();
+        case OperationPrefixCode::PUSH_EXACT_ADDR:
+        HANDLER(op_push_exact_addr)
+            PUSH(_ram->load(ins->arg));
+            ins++;
+            DISPATCH();
+        case OperationPrefixCode::POP_REG_VAL:
+        HANDLER(op_pop_reg_val)
+            REQUIRE(1);
+            _reg[ins->reg].db_val = TOP;
+            DROP(1);
+            ins++;
+            DISPATCH();
+        case OperationPrefixCode::POP_EXACT_ADDR:
+        HANDLER(op_pop_exact_addr)
+            REQUIRE(1);
+            _ram->store(TOP, ins->arg);
+            DROP(1);
+            ins++;
+            DISPATCH();
+        case OperationPrefixCode::POP_REG_ADDR:
+        HANDLER(op_pop_reg_addr)
+            REQUIRE(1);
+            if (!_ram->isValidAddr(static_cast<long long>(_reg[ins->reg].ull_val)))
+                EXIT(ProcessorStatus::INVALID_RAM_ADDRESS);
+            addr = _reg[ins->reg].ull_val;
+            _ram->store(TOP, addr);
+            DROP(1);
+            ins++;
+            DISPATCH();
+        case OperationPrefixCode::JMP_OFFSET_EXACT_VAL:
+        HANDLER(op_jmp)
+            if (Tracing && ins->arg <= ins - code && _tracer->countAnchor(ins->arg))
+                START_RECORDING();
+            ins = code + ins->arg;
+            DISPATCH();
+        case OperationPrefixCode::JE_OFFSET_EXACT_VAL:
+        HANDLER(op_je)
+            CONDITIONAL_JUMP(JE);
+        case OperationPrefixCode::JNE_OFFSET_EXACT_VAL:
+        HANDLER(op_jne)
+            CONDITIONAL_JUMP(JNE);
+        case OperationPrefixCode::JA_OFFSET_EXACT_VAL:
+        HANDLER(op_ja)
+            CONDITIONAL_JUMP(JA);
+        case OperationPrefixCode::JAE_OFFSET_EXACT_VAL:
+        HANDLER(op_jae)
+            CONDITIONAL_JUMP(JAE);
+        case OperationPrefixCode::JB_OFFSET_EXACT_VAL:
+        HANDLER(op_jb)
+            CONDITIONAL_JUMP(JB);
+        case OperationPrefixCode::JBE_OFFSET_EXACT_VAL:
+        HANDLER(op_jbe)
+            CONDITIONAL_JUMP(JBE);
+        case OperationPrefixCode::CALL_OFFSET_EXACT_VAL:
+        HANDLER(op_call)
+            if (Tracing && _tracer->countAnchor(ins->arg))
+                START_RECORDING();
+            _call_stack.push_back(ins - code + 1);
+            ENTER_FRAME();
+            ins = code + ins->arg;
+            if (Profiling)
+                _profiler->enter(ins - code);
+            DISPATCH();
+        case OperationPrefixCode::PUSH_FRAME_SLOT:
+        HANDLER(op_push_frame_slot)
+            slot = fp + ins->arg;
+            if (Checked && (slot < base || slot >= sp))
+                EXIT(ProcessorStatus::INVALID_FRAME_SLOT);
+            //The slot may be the top, its memory is current once tos is written back
+            if (CacheTop)
+                sp[-1] = tos;
+            PUSH(*slot);
+            ins++;
+            DISPATCH();
+        case OperationPrefixCode::POP_FRAME_SLOT:
+        HANDLER(op_pop_frame_slot)
+            REQUIRE(1);
+            slot = fp + ins->arg;
+            if (Checked && (slot < base || slot >= sp - 1))
+                EXIT(ProcessorStatus::INVALID_FRAME_SLOT);
+            //Stored before the drop, which reloads tos from memory if the slot is the new top
+            *slot = TOP;
+            DROP(1);
+            ins++;
+            DISPATCH();
+        case OperationPrefixCode::VADD:
+        case OperationPrefixCode::VMUL:
+        case OperationPrefixCode::VFMA:
+        case OperationPrefixCode::VSUM:
+        case OperationPrefixCode::VMIN:
+        case OperationPrefixCode::VMAX:
+        case OperationPrefixCode::VDOT:
+        case OperationPrefixCode::VFILL:
+        case OperationPrefixCode::VCOPY:
+        HANDLER(op_vector)
+            VectorOperations::getStackEffect(ins->opcode, needed, pushed);
+            REQUIRE(needed);
+            //Operands are read from memory, every vector operation takes at least two
+            if (CacheTop)
+                sp[-1] = tos;
+            status = executeVectorOperation(ins->opcode, sp);
+            if (status != ProcessorStatus::SUCCESS)
+                EXIT(status);
+            if (CacheTop)
+                tos = sp[-1];
+            ins++;
+            DISPATCH();
+        case OperationPrefixCode::IADD:
+        HANDLER(op_iadd)
+            INTEGER_BINARY_OPERATION(IntegerOperations::add(ileft, iright));
+        case OperationPrefixCode::ISUB:
+        HANDLER(op_isub)
+            INTEGER_BINARY_OPERATION(IntegerOperations::sub(ileft, iright));
+        case OperationPrefixCode::IMUL:
+        HANDLER(op_imul)
+            INTEGER_BINARY_OPERATION(IntegerOperations::mul(ileft, iright));
+        case OperationPrefixCode::IDIV:
+        HANDLER(op_idiv)
+            INTEGER_DIVISION(div);
+        case OperationPrefixCode::IREM:
+        HANDLER(op_irem)
+            INTEGER_DIVISION(rem);
+        case OperationPrefixCode::IAND:
+        HANDLER(op_iand)
+            INTEGER_BINARY_OPERATION(ileft & iright);
+        case OperationPrefixCode::IOR:
+        HANDLER(op_ior)
+            INTEGER_BINARY_OPERATION(ileft | iright);
+        case OperationPrefixCode::IXOR:
+        HANDLER(op_ixor)
+            INTEGER_BINARY_OPERATION(ileft ^ iright);
+        case OperationPrefixCode::ISHL:
+        HANDLER(op_ishl)
+            INTEGER_BINARY_OPERATION(IntegerOperations::shiftLeft(ileft, iright));
+        case OperationPrefixCode::ISHR:
+        HANDLER(op_ishr)
+            INTEGER_BINARY_OPERATION(IntegerOperations::shiftRight(ileft, iright));
+        case OperationPrefixCode::ITOD:
+        HANDLER(op_itod)
+            REQUIRE(1);
+            TOP = static_cast<double>(TOP_INTEGER);
+            ins++;
+            DISPATCH();
+        case OperationPrefixCode::DTOI:
+        HANDLER(op_dtoi)
+            REQUIRE(1);
+            TOP = IntegerOperations::fromBits(IntegerOperations::truncate(TOP));
+            ins++;
+            DISPATCH();
+        case OperationPrefixCode::IJE_OFFSET_EXACT_VAL:
+        HANDLER(op_ije)
+            CONDITIONAL_JUMP(IJE);
+        case OperationPrefixCode::IJNE_OFFSET_EXACT_VAL:
+        HANDLER(op_ijne)
+            CONDITIONAL_JUMP(IJNE);
+        case OperationPrefixCode::IJA_OFFSET_EXACT_VAL:
+        HANDLER(op_ija)
+            CONDITIONAL_JUMP(IJA);
+        case OperationPrefixCode::IJAE_OFFSET_EXACT_VAL:
+        HANDLER(op_ijae)
+            CONDITIONAL_JUMP(IJAE);
+        case OperationPrefixCode::IJB_OFFSET_EXACT_VAL:
+        HANDLER(op_ijb)
+            CONDITIONAL_JUMP(IJB);
+        case OperationPrefixCode::IJBE_OFFSET_EXACT_VAL:
+        HANDLER(op_ijbe)
+            CONDITIONAL_JUMP(IJBE);
+        case InternalOperationCode::TRAP:
+        HANDLER(op_trap)
+            EXIT(static_cast<ProcessorStatus>(ins->arg));
+        case InternalOperationCode::FUSED_ADD_VAL:
+        HANDLER(op_fused_add_val)
+            FUSED_ARITHMETIC_VAL(+);
+        case InternalOperationCode::FUSED_PUSH_REG_ADD_VAL:
+        HANDLER(op_fused_push_reg_add_val)
+            FUSED_PUSH_REG_ARITHMETIC_VAL(+);
+        case InternalOperationCode::FUSED_SUB_VAL:
+        HANDLER(op_fused_sub_val)
+            FUSED_ARITHMETIC_VAL(-);
+        case InternalOperationCode::FUSED_PUSH_REG_SUB_VAL:
+        HANDLER(op_fused_push_reg_sub_val)
+            FUSED_PUSH_REG_ARITHMETIC_VAL(-);
+        case InternalOperationCode::FUSED_MUL_VAL:
+        HANDLER(op_fused_mul_val)
+            FUSED_ARITHMETIC_VAL(*);
+        case InternalOperationCode::FUSED_PUSH_REG_MUL_VAL:
+        HANDLER(op_fused_push_reg_mul_val)
+            FUSED_PUSH_REG_ARITHMETIC_VAL(*);
+        case InternalOperationCode::FUSED_DIV_VAL:
+        HANDLER(op_fused_div_val)
+            FUSED_ARITHMETIC_VAL(/);
+        case InternalOperationCode::FUSED_PUSH_REG_DIV_VAL:
+        HANDLER(op_fused_push_reg_div_val)
+            FUSED_PUSH_REG_ARITHMETIC_VAL(/);
+        case InternalOperationCode::FUSED_STORE_REG:
+        HANDLER(op_fused_store_reg)
+            REQUIRE(1);
+            _reg[ins->reg].db_val = TOP;
+            ins += 2;
+            DISPATCH();
+        case InternalOperationCode::FUSED_SWAP_REGS:
+        HANDLER(op_fused_swap_regs)
+            REQUIRE(2);
+            right = TOP;
+            left = SECOND;
+            _reg[ins->reg].db_val = right;
+            _reg[ins->arg].db_val = left;
+            TOP = left;
+            SECOND = right;
+            ins += 4;
+            DISPATCH();
+        case InternalOperationCode::FUSED_PUSH_VAL_JE:
+        HANDLER(op_fused_push_val_je)
+            FUSED_PUSH_VAL_CONDITIONAL_JUMP(JE);
+        case InternalOperationCode::FUSED_JE_POP2:
+        HANDLER(op_fused_je_pop2)
+            FUSED_CONDITIONAL_JUMP_POP2(JE);
+        case InternalOperationCode::FUSED_PUSH_VAL_JE_POP2:
+        HANDLER(op_fused_push_val_je_pop2)
+            FUSED_PUSH_VAL_CONDITIONAL_JUMP_POP2(JE);
+        case InternalOperationCode::FUSED_PUSH_VAL_JNE:
+        HANDLER(op_fused_push_val_jne)
+            FUSED_PUSH_VAL_CONDITIONAL_JUMP(JNE);
+        case InternalOperationCode::FUSED_JNE_POP2:
+        HANDLER(op_fused_jne_pop2)
+            FUSED_CONDITIONAL_JUMP_POP2(JNE);
+        case InternalOperationCode::FUSED_PUSH_VAL_JNE_POP2:
+        HANDLER(op_fused_push_val_jne_pop2)
+            FUSED_PUSH_VAL_CONDITIONAL_JUMP_POP2(JNE);
+        case InternalOperationCode::FUSED_PUSH_VAL_JA:
+        HANDLER(op_fused_push_val_ja)
+            FUSED_PUSH_VAL_CONDITIONAL_JUMP(JA);
+        case InternalOperationCode::FUSED_JA_POP2:
+        HANDLER(op_fused_ja_pop2)
+            FUSED_CONDITIONAL_JUMP_POP2(JA);
+        case InternalOperationCode::FUSED_PUSH_VAL_JA_POP2:
+        HANDLER(op_fused_push_val_ja_pop2)
+            FUSED_PUSH_VAL_CONDITIONAL_JUMP_POP2(JA);
+        case InternalOperationCode::FUSED_PUSH_VAL_JAE:
+        HANDLER(op_fused_push_val_jae)
+            FUSED_PUSH_VAL_CONDITIONAL_JUMP(JAE);
+        case InternalOperationCode::FUSED_JAE_POP2:
+        HANDLER(op_fused_jae_pop2)
+            FUSED_CONDITIONAL_JUMP_POP2(JAE);
+        case InternalOperationCode::FUSED_PUSH_VAL_JAE_POP2:
+        HANDLER(op_fused_push_val_jae_pop2)
+            FUSED_PUSH_VAL_CONDITIONAL_JUMP_POP2(JAE);
+        case InternalOperationCode::FUSED_PUSH_VAL_JB:
+        HANDLER(op_fused_push_val_jb)
+            FUSED_PUSH_VAL_CONDITIONAL_JUMP(JB);
+        case InternalOperationCode::FUSED_JB_POP2:
+        HANDLER(op_fused_jb_pop2)
+            FUSED_CONDITIONAL_JUMP_POP2(JB);
+        case InternalOperationCode::FUSED_PUSH_VAL_JB_POP2:
+        HANDLER(op_fused_push_val_jb_pop2)
+            FUSED_PUSH_VAL_CONDITIONAL_JUMP_POP2(JB);
+        case InternalOperationCode::FUSED_PUSH_VAL_JBE:
+        HANDLER(op_fused_push_val_jbe)
+            FUSED_PUSH_VAL_CONDITIONAL_JUMP(JBE);
+        case InternalOperationCode::FUSED_JBE_POP2:
+        HANDLER(op_fused_jbe_pop2)
+            FUSED_CONDITIONAL_JUMP_POP2(JBE);
+        case InternalOperationCode::FUSED_PUSH_VAL_JBE_POP2:
+        HANDLER(op_fused_push_val_jbe_pop2)
+            FUSED_PUSH_VAL_CONDITIONAL_JUMP_POP2(JBE);
+        case InternalOperationCode::FUSED_PUSH_VAL_IJE:
+        HANDLER(op_fused_push_val_ije)
+            FUSED_PUSH_VAL_CONDITIONAL_JUMP(IJE);
+        case InternalOperationCode::FUSED_IJE_POP2:
+        HANDLER(op_fused_ije_pop2)
+            FUSED_CONDITIONAL_JUMP_POP2(IJE);
+        case InternalOperationCode::FUSED_PUSH_VAL_IJE_POP2:
+        HANDLER(op_fused_push_val_ije_pop2)
+            FUSED_PUSH_VAL_CONDITIONAL_JUMP_POP2(IJE);
+        case InternalOperationCode::FUSED_PUSH_VAL_IJNE:
+        HANDLER(op_fused_push_val_ijne)
+            FUSED_PUSH_VAL_CONDITIONAL_JUMP(IJNE);
+        case InternalOperationCode::FUSED_IJNE_POP2:
+        HANDLER(op_fused_ijne_pop2)
+            FUSED_CONDITIONAL_JUMP_POP2(IJNE);
+        case InternalOperationCode::FUSED_PUSH_VAL_IJNE_POP2:
+        HANDLER(op_fused_push_val_ijne_pop2)
+            FUSED_PUSH_VAL_CONDITIONAL_JUMP_POP2(IJNE);
+        case InternalOperationCode::FUSED_PUSH_VAL_IJA:
+        HANDLER(op_fused_push_val_ija)
+            FUSED_PUSH_VAL_CONDITIONAL_JUMP(IJA);
+        case InternalOperationCode::FUSED_IJA_POP2:
+        HANDLER(op_fused_ija_pop2)
+            FUSED_CONDITIONAL_JUMP_POP2(IJA);
+        case InternalOperationCode::FUSED_PUSH_VAL_IJA_POP2:
+        HANDLER(op_fused_push_val_ija_pop2)
+            FUSED_PUSH_VAL_CONDITIONAL_JUMP_POP2(IJA);
+        case InternalOperationCode::FUSED_PUSH_VAL_IJAE:
+        HANDLER(op_fused_push_val_ijae)
+            FUSED_PUSH_VAL_CONDITIONAL_JUMP(IJAE);
+        case InternalOperationCode::FUSED_IJAE_POP2:
+        HANDLER(op_fused_ijae_pop2)
+            FUSED_CONDITIONAL_JUMP_POP2(IJAE);
+        case InternalOperationCode::FUSED_PUSH_VAL_IJAE_POP2:
+        HANDLER(op_fused_push_val_ijae_pop2)
+            FUSED_PUSH_VAL_CONDITIONAL_JUMP_POP2(IJAE);
+        case InternalOperationCode::FUSED_PUSH_VAL_IJB:
+        HANDLER(op_fused_push_val_ijb)
+            FUSED_PUSH_VAL_CONDITIONAL_JUMP(IJB);
+        case InternalOperationCode::FUSED_IJB_POP2:
+        HANDLER(op_fused_ijb_pop2)
+            FUSED_CONDITIONAL_JUMP_POP2(IJB);
+        case InternalOperationCode::FUSED_PUSH_VAL_IJB_POP2:
+        HANDLER(op_fused_push_val_ijb_pop2)
+            FUSED_PUSH_VAL_CONDITIONAL_JUMP_POP2(IJB);
+        case InternalOperationCode::FUSED_PUSH_VAL_IJBE:
+        HANDLER(op_fused_push_val_ijbe)
+            FUSED_PUSH_VAL_CONDITIONAL_JUMP(IJBE);
+        case InternalOperationCode::FUSED_IJBE_POP2:
+        HANDLER(op_fused_ijbe_pop2)
+            FUSED_CONDITIONAL_JUMP_POP2(IJBE);
+        case InternalOperationCode::FUSED_PUSH_VAL_IJBE_POP2:
+        HANDLER(op_fused_push_val_ijbe_pop2)
+            FUSED_PUSH_VAL_CONDITIONAL_JUMP_POP2(IJBE);
+        case InternalOperationCode::FUSED_IADD_VAL:
+        HANDLER(op_fused_iadd_val)
+            FUSED_INTEGER_ARITHMETIC_VAL(add);
+        case InternalOperationCode::FUSED_PUSH_REG_IADD_VAL:
+        HANDLER(op_fused_push_reg_iadd_val)
+            FUSED_PUSH_REG_INTEGER_ARITHMETIC_VAL(add);
+        case InternalOperationCode::FUSED_ISUB_VAL:
+        HANDLER(op_fused_isub_val)
+            FUSED_INTEGER_ARITHMETIC_VAL(sub);
+        case InternalOperationCode::FUSED_PUSH_REG_ISUB_VAL:
+        HANDLER(op_fused_push_reg_isub_val)
+            FUSED_PUSH_REG_INTEGER_ARITHMETIC_VAL(sub);
+        case InternalOperationCode::FUSED_IMUL_VAL:
+        HANDLER(op_fused_imul_val)
+            FUSED_INTEGER_ARITHMETIC_VAL(mul);
+        case InternalOperationCode::FUSED_PUSH_REG_IMUL_VAL:
+        HANDLER(op_fused_push_reg_imul_val)
+            FUSED_PUSH_REG_INTEGER_ARITHMETIC_VAL(mul);
+        case InternalOperationCode::TRACE_ENTER:
+        HANDLER(op_trace_enter)
+            ins = _tracer->enter(ins->arg);
+            DISPATCH();
+        case InternalOperationCode::TRACE_GUARD_JE:
+        HANDLER(op_trace_guard_je)
+            TRACE_GUARD(JE);
+        case InternalOperationCode::TRACE_GUARD_JNE:
+        HANDLER(op_trace_guard_jne)
+            TRACE_GUARD(JNE);
+        case InternalOperationCode::TRACE_GUARD_JA:
+        HANDLER(op_trace_guard_ja)
+            TRACE_GUARD(JA);
+        case InternalOperationCode::TRACE_GUARD_JAE:
+        HANDLER(op_trace_guard_jae)
+            TRACE_GUARD(JAE);
+        case InternalOperationCode::TRACE_GUARD_JB:
+        HANDLER(op_trace_guard_jb)
+            TRACE_GUARD(JB);
+        case InternalOperationCode::TRACE_GUARD_JBE:
+        HANDLER(op_trace_guard_jbe)
+            TRACE_GUARD(JBE);
+        case InternalOperationCode::TRACE_GUARD_IJE:
+        HANDLER(op_trace_guard_ije)
+            TRACE_GUARD(IJE);
+        case InternalOperationCode::TRACE_GUARD_IJNE:
+        HANDLER(op_trace_guard_ijne)
+            TRACE_GUARD(IJNE);
+        case InternalOperationCode::TRACE_GUARD_IJA:
+        HANDLER(op_trace_guard_ija)
+            TRACE_GUARD(IJA);
+        case InternalOperationCode::TRACE_GUARD_IJAE:
+        HANDLER(op_trace_guard_ijae)
+            TRACE_GUARD(IJAE);
+        case InternalOperationCode::TRACE_GUARD_IJB:
+        HANDLER(op_trace_guard_ijb)
+            TRACE_GUARD(IJB);
+        case InternalOperationCode::TRACE_GUARD_IJBE:
+        HANDLER(op_trace_guard_ijbe)
+            TRACE_GUARD(IJBE);
+        case InternalOperationCode::TRACE_CALL:
+        HANDLER(op_trace_call)
+            _call_stack.push_back(ins->arg);
+            ENTER_FRAME();
+            ins++;
+            DISPATCH();
+        case InternalOperationCode::TRACE_RET:
+        HANDLER(op_trace_ret)
+            if (Checked && _call_stack.empty())
+                EXIT(ProcessorStatus::CALL_STACK_UNDERFLOW);
+            addr = _call_stack.back();
+            _call_stack.pop_back();
+            LEAVE_FRAME();
+            ins = addr == ins->arg ? ins + 1 : code + addr;
+            DISPATCH();
+        case InternalOperationCode::TRACE_LOOP:
+        HANDLER(op_trace_loop)
+            ins -= ins->arg;
+            DISPATCH();
+        case InternalOperationCode::TRACE_EXIT:
+        HANDLER(op_trace_exit)
+            ins = code + ins->arg;
+            DISPATCH();
+        case InternalOperationCode::CALL_MEMO:
+        HANDLER(op_call_memo)
+            //Memoizer works on the stack in memory
+            if (CacheTop && sp > base)
+                sp[-1] = tos;
+            switch (_memoizer->lookup(ins->arg, sp, base, limit, _call_stack.size(),
+                                      _call_stack.getCapacity(), _reg)) {
+                case MemoLookup::MEMO_HIT:
+                    if (CacheTop)
+                        tos = sp[-1];
+                    ins++;
+                    DISPATCH();
+                case MemoLookup::MEMO_RECORD:
+                    _call_stack.push_back(static_cast<int>(ins->val));
+                    break;
+                default:
+                    _call_stack.push_back(ins - code + 1);
+            }
+            ENTER_FRAME();
+            ins = code + ins->arg;
+            DISPATCH();
+        case InternalOperationCode::MEMO_RETURN:
+        HANDLER(op_memo_return)
+            if (CacheTop && sp > base)
+                sp[-1] = tos;
+            _memoizer->record(sp, _reg);
+            ins = code + ins->arg;
+            DISPATCH();
+        default:
+        HANDLER(op_unknown)
+            EXIT(ProcessorStatus::UNRECOGNIZED_COMMAND);
+    }
+}
+
+#undef TRACE_GUARD
+#undef FUSED_PUSH_REG_INTEGER_ARITHMETIC_VAL
+#undef FUSED_INTEGER_ARITHMETIC_VAL
+#undef FUSED_PUSH_REG_ARITHMETIC_VAL
+#undef FUSED_ARITHMETIC_VAL
+#undef FUSED_PUSH_VAL_CONDITIONAL_JUMP_POP2
+#undef FUSED_CONDITIONAL_JUMP_POP2
+#undef FUSED_PUSH_VAL_CONDITIONAL_JUMP
+#undef CONDITIONAL_JUMP
+#undef CONDITION_IJBE
+#undef CONDITION_IJB
+#undef CONDITION_IJAE
+#undef CONDITION_IJA
+#undef CONDITION_IJNE
+#undef CONDITION_IJE
+#undef CONDITION_JBE
+#undef CONDITION_JB
+#undef CONDITION_JAE
+#undef CONDITION_JA
+#undef CONDITION_JNE
+#undef CONDITION_JE
+#undef INTEGER_DIVISION
+#undef INTEGER_BINARY_OPERATION
+#undef SECOND_INTEGER
+#undef TOP_INTEGER
+#undef BINARY_OPERATION
+#undef DROP
+#undef LEAVE_FRAME
+#undef ENTER_FRAME
+#undef PUSH
+#undef RESERVE
+#undef PROBE
+#undef REQUIRE
+#undef EXIT
+#undef SECOND
+#undef TOP
+#undef DEPTH
+#undef STOP_RECORDING
+#undef START_RECORDING
+#undef DISPATCH
+#undef HANDLER
@@ -0,0 +1,151 @@
+#include "Fusion.h"
+
+static bool sameRegisters(const DecodedInstruction *sequence) {
+    return sequence[0].reg == sequence[1].reg;
+}
+
+//pop r1; pop r2; push r1; push r2
+static bool swapRegisters(const DecodedInstruction *sequence) {
+    return sequence[0].reg != sequence[1].reg && sequence[2].reg == sequence[0].reg &&
+           sequence[3].reg == sequence[1].reg;
+}
+
+#define CONDITIONAL_RULES(cond, mnemonic) \
+    {"push val; " mnemonic "; popd; popd", FUSED_PUSH_VAL_##cond##_POP2, 4, \
+        {PUSH_EXACT_VAL, cond##_OFFSET_EXACT_VAL, POP, POP}, nullptr}, \
+    {mnemonic "; popd; popd", FUSED_##cond##_POP2, 3, {cond##_OFFSET_EXACT_VAL, POP, POP}, nullptr}, \
+    {"push val; " mnemonic, FUSED_PUSH_VAL_##cond, 2, {PUSH_EXACT_VAL, cond##_OFFSET_EXACT_VAL}, nullptr}
+
+#define ARITHMETIC_RULES(op, mnemonic) \
+    {"push reg; push val; " mnemonic, FUSED_PUSH_REG_##op##_VAL, 3, {PUSH_REG_VAL, PUSH_EXACT_VAL, op}, nullptr}, \
+    {"push val; " mnemonic, FUSED_##op##_VAL, 2, {PUSH_EXACT_VAL, op}, nullptr}
+
+//Longer sequences go first, the first matching rule wins
+const FusionRule Fusion::RULES[] = {
+    {"pop r1; pop r2; push r1; push r2", FUSED_SWAP_REGS, 4,
+        {POP_REG_VAL, POP_REG_VAL, PUSH_REG_VAL, PUSH_REG_VAL}, swapRegisters},
+    CONDITIONAL_RULES(JE, "je"),
+    CONDITIONAL_RULES(JNE, "jne"),
+    CONDITIONAL_RULES(JA, "ja"),
+    CONDITIONAL_RULES(JAE, "jae"),
+    CONDITIONAL_RULES(JB, "jb"),
+    CONDITIONAL_RULES(JBE, "jbe"),
+    CONDITIONAL_RULES(IJE, "ije"),
+    CONDITIONAL_RULES(IJNE, "ijne"),
+    CONDITIONAL_RULES(IJA, "ija"),
+    CONDITIONAL_RULES(IJAE, "ijae"),
+    CONDITIONAL_RULES(IJB, "ijb"),
+    CONDITIONAL_RULES(IJBE, "ijbe"),
+    ARITHMETIC_RULES(ADD, "add"),
+    ARITHMETIC_RULES(SUB, "sub"),
+    ARITHMETIC_RULES(MUL, "mul"),
+    ARITHMETIC_RULES(DIV, "div"),
+    ARITHMETIC_RULES(IADD, "iadd"),
+    ARITHMETIC_RULES(ISUB, "isub"),
+    ARITHMETIC_RULES(IMUL, "imul"),
+    {"pop reg; push reg", FUSED_STORE_REG, 2, {POP_REG_VAL, PUSH_REG_VAL}, sameRegisters}
+};
+
+#undef ARITHMETIC_RULES
+#undef CONDITIONAL_RULES
+
+int Fusion::getRuleCount() {
+    return sizeof (RULES) / sizeof (RULES[0]);
+}
+
+const FusionRule &Fusion::getRule(int rule) {
+    return RULES[rule];
+}
+
+int Fusion::getFusedLength(unsigned char opcode) {
+    for (const FusionRule &rule : RULES) {
+        if (rule.fused == opcode)
+            return rule.length;
+    }
+    return 1;
+}
+
+std::vector<bool> Fusion::findEntryPoints(const DecodedProgram &program) {
+    int size = program.instructions.size();
+    std::vector<bool> entryPoints(size, false);
+    if (size > 0)
+        entryPoints[0] = true;
+
+    for (int i = 0; i < size; i++) {
+        const DecodedInstruction &instruction = program.instructions[i];
+        bool call = instruction.opcode == OperationPrefixCode::CALL_OFFSET_EXACT_VAL ||
+                    instruction.opcode == InternalOperationCode::CALL_MEMO;
+        if (!call && instruction.opcode != InternalOperationCode::MEMO_RETURN && !Decoder::hasTarget(instruction.opcode))
+            continue;
+        entryPoints[instruction.arg] = true;
+        //Return address
+        if (call && i + 1 < size)
+            entryPoints[i + 1] = true;
+    }
+
+    return entryPoints;
+}
+
+bool Fusion::matches(const FusionRule &rule, const DecodedInstruction *sequence) {
+    for (int i = 0; i < rule.length; i++) {
+        if (sequence[i].opcode != rule.pattern[i])
+            return false;
+    }
+    return rule.accepts == nullptr || rule.accepts(sequence);
+}
+
+DecodedInstruction Fusion::build(const FusionRule &rule, const DecodedInstruction *sequence) {
+    DecodedInstruction fused = sequence[0];
+    fused.opcode = rule.fused;
+
+    bool regTaken = false;
+    for (int i = 0; i < rule.length; i++) {
+        const DecodedInstruction &part = sequence[i];
+        if (part.opcode == OperationPrefixCode::PUSH_EXACT_VAL) {
+            fused.val = part.val;
+        } else if (Decoder::hasTarget(part.opcode)) {
+            fused.arg = part.arg;
+        } else if ((part.opcode == OperationPrefixCode::PUSH_REG_VAL ||
+                    part.opcode == OperationPrefixCode::POP_REG_VAL) && !regTaken) {
+            fused.reg = part.reg;
+            regTaken = true;
+        }
+    }
+
+    //Second register of the swap
+    if (rule.fused == InternalOperationCode::FUSED_SWAP_REGS)
+        fused.arg = sequence[1].reg;
+
+    return fused;
+}
+
+void Fusion::fuse(DecodedProgram &program, std::vector<int> &firedCounts) {
+    fuse(program, firedCounts, findEntryPoints(program));
+}
+
+void Fusion::fuse(DecodedProgram &program, std::vector<int> &firedCounts, const std::vector<bool> &entryPoints) {
+    firedCounts.assign(getRuleCount(), 0);
+
+    std::vector<DecodedInstruction> &code = program.instructions;
+    int size = code.size();
+
+    for (int i = 0; i < size; i++) {
+        for (int rule = 0; rule < getRuleCount(); rule++) {
+            const FusionRule &current = RULES[rule];
+            if (i + current.length > size || !matches(current, &code[i]))
+                continue;
+
+            //Only the first instruction of the sequence may be entered from outside
+            bool entered = false;
+            for (int j = 1; j < current.length; j++)
+                entered = entered || entryPoints[i + j];
+            if (entered)
+                continue;
+
+            code[i] = build(current, &code[i]);
+            firedCounts[rule]++;
+            i += current.length - 1;
+            break;
+        }
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef STACK_PROCESSOR_FUSION_H
+#define STACK_PROCESSOR_FUSION_H
+#include "Decoder.h"
+#include <vector>
+
+//Sequence of decoded instructions that gets replaced by one superinstruction
+struct FusionRule {
+    const char *name;
+    unsigned char fused;
+    int length;
+    unsigned char pattern[4];
+    //Extra operand constraints, nullptr if any operands fit
+    bool (*accepts)(const DecodedInstruction *sequence);
+};
+
+class Fusion {
+private:
+    static const FusionRule RULES[];
+
+    static std::vector<bool> findEntryPoints(const DecodedProgram &program);
+
+    static bool matches(const FusionRule &rule, const DecodedInstruction *sequence);
+
+    static DecodedInstruction build(const FusionRule &rule, const DecodedInstruction *sequence);
+
+public:
+    static int getRuleCount();
+
+    static const FusionRule &getRule(int rule);
+
+    //Number of original instructions covered by opcode, 1 for anything but superinstructions
+    static int getFusedLength(unsigned char opcode);
+
+    //The first instruction of every matched sequence is replaced by the superinstruction,
+    //the rest stay in place unreachable, so instruction indices and offsets do not change.
+    //firedCounts receives the number of replacements made by every rule.
+    static void fuse(DecodedProgram &program, std::vector<int> &firedCounts);
+
+    //Same with entry points given by the caller, for code whose jump targets are not its own indices
+    static void fuse(DecodedProgram &program, std::vector<int> &firedCounts, const std::vector<bool> &entryPoints);
+};
+
+#endif //STACK_PROCESSOR_FUSION_H
@@ -0,0 +1,100 @@
+#include "GuardedStack.h"
+#include <csignal>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static thread_local GuardScope *activeScope = nullptr;
+static struct sigaction previousAction;
+
+static void handleFault(int signal, siginfo_t *info, void *context) {
+    const char *address = static_cast<const char*>(info->si_addr);
+    for (GuardScope *scope = activeScope; scope != nullptr; scope = scope->previous) {
+        if (address >= scope->guardBegin && address < scope->guardEnd)
+            siglongjmp(scope->jump, 1);
+    }
+
+    //Not a guard page, the fault goes to the previous handler and this one stays installed
+    //for the next overflow. Without a previous handler the fault is fatal as it would have been
+    if ((previousAction.sa_flags & SA_SIGINFO) != 0) {
+        previousAction.sa_sigaction(signal, info, context);
+    } else if (previousAction.sa_handler != SIG_DFL && previousAction.sa_handler != SIG_IGN) {
+        previousAction.sa_handler(signal);
+    } else {
+        struct sigaction fatal = {};
+        fatal.sa_handler = SIG_DFL;
+        sigemptyset(&fatal.sa_mask);
+        sigaction(signal, &fatal, nullptr);
+        raise(signal);
+    }
+}
+
+static bool installHandler() {
+    struct sigaction action = {};
+    action.sa_sigaction = handleFault;
+    //Not blocked in the handler, so jumping out of it needs no signal mask restore
+    action.sa_flags = SA_SIGINFO | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+    return sigaction(SIGSEGV, &action, &previousAction) == 0;
+}
+
+GuardedRegion::GuardedRegion(): _mapping(nullptr), _mappingSize(0), _start(nullptr), _guard(nullptr) {
+}
+
+GuardedRegion::~GuardedRegion() {
+    release();
+}
+
+void GuardedRegion::release() {
+    if (_mapping != nullptr)
+        munmap(_mapping, _mappingSize);
+    _mapping = nullptr;
+    _mappingSize = 0;
+}
+
+void GuardedRegion::allocate(size_t size) {
+    release();
+
+    size_t pageSize = sysconf(_SC_PAGESIZE);
+    size_t usable = (size + pageSize - 1) / pageSize * pageSize;
+    void *mapping = mmap(nullptr, usable + pageSize, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mapping == MAP_FAILED)
+        throw std::bad_alloc();
+    _mapping = static_cast<char*>(mapping);
+    _mappingSize = usable + pageSize;
+    _guard = _mapping + usable;
+    _start = _guard - size;
+    if (mprotect(_guard, pageSize, PROT_NONE) != 0) {
+        release();
+        throw std::bad_alloc();
+    }
+}
+
+char *GuardedRegion::getStart() const {
+    return _start;
+}
+
+const char *GuardedRegion::getGuard() const {
+    return _guard;
+}
+
+const char *GuardedRegion::getGuardEnd() const {
+    return _mapping + _mappingSize;
+}
+
+void StackGuard::install() {
+    static bool installed = installHandler();
+    (void) installed;
+}
+
+void StackGuard::enter(GuardScope &scope, const GuardedRegion &region) {
+    scope.guardBegin = region.getGuard();
+    scope.guardEnd = region.getGuardEnd();
+    scope.previous = activeScope;
+    activeScope = &scope;
+}
+
+void StackGuard::leave(GuardScope &scope) {
+    activeScope = scope.previous;
+}
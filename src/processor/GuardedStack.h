@@ -0,0 +1,126 @@
+#ifndef STACK_PROCESSOR_GUARDEDSTACK_H
+#define STACK_PROCESSOR_GUARDEDSTACK_H
+#include <algorithm>
+#include <csetjmp>
+#include <cstddef>
+
+//Address space reserved with mmap and followed by an inaccessible guard page. Pages are only
+//committed once touched, so the reserved size is a bound rather than a cost
+class GuardedRegion {
+private:
+    char *_mapping;
+    size_t _mappingSize;
+    char *_start;
+    char *_guard;
+
+    void release();
+
+public:
+    GuardedRegion();
+
+    GuardedRegion(const GuardedRegion &) = delete;
+
+    GuardedRegion &operator=(const GuardedRegion &) = delete;
+
+    ~GuardedRegion();
+
+    //Drops the previous mapping, the size usable bytes end right at the guard page.
+    //Throws std::bad_alloc if the address space cannot be reserved
+    void allocate(size_t size);
+
+    char *getStart() const;
+
+    const char *getGuard() const;
+
+    const char *getGuardEnd() const;
+};
+
+//Where execution continues once an access hits the guard page of a region
+struct GuardScope {
+    sigjmp_buf jump;
+    const char *guardBegin;
+    const char *guardEnd;
+    GuardScope *previous;
+};
+
+//Turns SIGSEGV in a guard page into siglongjmp to the innermost scope of the faulting thread
+//that covers it. Faults anywhere else get the handler that was installed before
+class StackGuard {
+public:
+    //Installs the handler once per process
+    static void install();
+
+    //The caller does sigsetjmp(scope.jump, 0) right after entering and leaves on every return
+    static void enter(GuardScope &scope, const GuardedRegion &region);
+
+    static void leave(GuardScope &scope);
+};
+
+//Stack of fixed maximum depth that never reallocates and never checks its capacity, pushing
+//beyond it faults in the guard page. Same interface as the std::vector it replaces
+template <typename T>
+class GuardedStack {
+private:
+    GuardedRegion _region;
+    T *_base;
+    T *_top;
+    int _capacity;
+
+public:
+    GuardedStack(): _base(nullptr), _top(nullptr), _capacity(0) {}
+
+    //Drops the current contents
+    void setCapacity(int capacity) {
+        _region.allocate(capacity * sizeof (T));
+        _base = reinterpret_cast<T*>(_region.getStart());
+        _top = _base;
+        _capacity = capacity;
+    }
+
+    int getCapacity() const {
+        return _capacity;
+    }
+
+    const GuardedRegion &getRegion() const {
+        return _region;
+    }
+
+    void push_back(T value) {
+        *_top++ = value;
+    }
+
+    T back() const {
+        return _top[-1];
+    }
+
+    void pop_back() {
+        _top--;
+    }
+
+    bool empty() const {
+        return _top == _base;
+    }
+
+    size_t size() const {
+        return _top - _base;
+    }
+
+    void clear() {
+        _top = _base;
+    }
+
+    const T *begin() const {
+        return _base;
+    }
+
+    const T *end() const {
+        return _top;
+    }
+
+    //Needs last - first <= capacity
+    void assign(const T *first, const T *last) {
+        _top = std::copy(first, last, _base);
+    }
+};
+
+#endif //STACK_PROCESSOR_GUARDEDSTACK_H
@@ -0,0 +1,128 @@
+#ifndef STACK_PROCESSOR_INTEGER_OPERATIONS_H
+#define STACK_PROCESSOR_INTEGER_OPERATIONS_H
+#include "../utils.h"
+#include <climits>
+
+//Semantics of the integer operations shared by every execution mode. A stack slot holds the bits
+//of a 64-bit signed integer in place of a double, arithmetic wraps around instead of overflowing
+class IntegerOperations {
+public:
+    static long long getBits(double value) {
+        DoubleLl bits;
+        bits.db_val = value;
+        return bits.ll_val;
+    }
+
+    static double fromBits(long long value) {
+        DoubleLl bits;
+        bits.ll_val = value;
+        return bits.db_val;
+    }
+
+    static bool isIntegerOperation(unsigned char opcode) {
+        return opcode >= OperationPrefixCode::IADD && opcode <= OperationPrefixCode::DTOI;
+    }
+
+    static bool isIntegerJump(unsigned char opcode) {
+        return opcode >= OperationPrefixCode::IJE_OFFSET_EXACT_VAL && opcode <= OperationPrefixCode::IJBE_OFFSET_EXACT_VAL;
+    }
+
+    static long long add(long long left, long long right) {
+        return static_cast<long long>(static_cast<unsigned long long>(left) + static_cast<unsigned long long>(right));
+    }
+
+    static long long sub(long long left, long long right) {
+        return static_cast<long long>(static_cast<unsigned long long>(left) - static_cast<unsigned long long>(right));
+    }
+
+    static long long mul(long long left, long long right) {
+        return static_cast<long long>(static_cast<unsigned long long>(left) * static_cast<unsigned long long>(right));
+    }
+
+    //Needs right != 0, LLONG_MIN / -1 wraps to LLONG_MIN
+    static long long div(long long left, long long right) {
+        return right == -1 ? sub(0, left) : left / right;
+    }
+
+    //Needs right != 0
+    static long long rem(long long left, long long right) {
+        return right == -1 ? 0 : left % right;
+    }
+
+    static long long shiftLeft(long long left, long long right) {
+        return static_cast<long long>(static_cast<unsigned long long>(left) << (right & 63));
+    }
+
+    static long long shiftRight(long long left, long long right) {
+        return left >> (right & 63);
+    }
+
+    //Same result as cvttsd2si
+    static long long truncate(double value) {
+        if (!(value >= -9223372036854775808.0 && value < 9223372036854775808.0))
+            return LLONG_MIN;
+        return static_cast<long long>(value);
+    }
+
+    //Binary operations and conversions, returns false on division by zero
+    static bool apply(unsigned char opcode, long long left, long long right, long long &result) {
+        switch (opcode) {
+            case OperationPrefixCode::IADD:
+                result = add(left, right);
+                return true;
+            case OperationPrefixCode::ISUB:
+                result = sub(left, right);
+                return true;
+            case OperationPrefixCode::IMUL:
+                result = mul(left, right);
+                return true;
+            case OperationPrefixCode::IDIV:
+                if (right == 0)
+                    return false;
+                result = div(left, right);
+                return true;
+            case OperationPrefixCode::IREM:
+                if (right == 0)
+                    return false;
+                result = rem(left, right);
+                return true;
+            case OperationPrefixCode::IAND:
+                result = left & right;
+                return true;
+            case OperationPrefixCode::IOR:
+                result = left | right;
+                return true;
+            case OperationPrefixCode::IXOR:
+                result = left ^ right;
+                return true;
+            case OperationPrefixCode::ISHL:
+                result = shiftLeft(left, right);
+                return true;
+            case OperationPrefixCode::ISHR:
+                result = shiftRight(left, right);
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    //Signed comparison of an integer jump
+    static bool compare(unsigned char opcode, long long left, long long right) {
+        switch (opcode) {
+            case OperationPrefixCode::IJE_OFFSET_EXACT_VAL:
+                return left == right;
+            case OperationPrefixCode::IJNE_OFFSET_EXACT_VAL:
+                return left != right;
+            case OperationPrefixCode::IJA_OFFSET_EXACT_VAL:
+                return left > right;
+            case OperationPrefixCode::IJAE_OFFSET_EXACT_VAL:
+                return left >= right;
+            case OperationPrefixCode::IJB_OFFSET_EXACT_VAL:
+                return left < right;
+            default:
+                return left <= right;
+        }
+    }
+};
+
+#endif //STACK_PROCESSOR_INTEGER_OPERATIONS_H
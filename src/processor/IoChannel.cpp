@@ -0,0 +1,179 @@
+#include "IoChannel.h"
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+double InteractiveTextChannel::read() {
+    double val = 0.0;
+    std::printf("in: ");
+    std::scanf("%lg", &val);
+    return val;
+}
+
+void InteractiveTextChannel::write(double val) {
+    std::printf("out: %lg\n", val);
+}
+
+BufferedTextChannel::BufferedTextChannel(FILE *input, FILE *output): _input(input), _output(output),
+    _in_buffer(new char[BUFFER_SIZE + 1]), _in_begin(0), _in_end(0), _in_eof(false), _in_failed(false),
+    _out_buffer(new char[BUFFER_SIZE]), _out_size(0) {
+    _in_buffer[0] = '\0';
+}
+
+BufferedTextChannel::~BufferedTextChannel() {
+    flush();
+}
+
+void BufferedTextChannel::refill() {
+    int left = _in_end - _in_begin;
+    std::memmove(_in_buffer.get(), _in_buffer.get() + _in_begin, left);
+    _in_begin = 0;
+    _in_end = left;
+    size_t got = std::fread(_in_buffer.get() + _in_end, 1, BUFFER_SIZE - _in_end, _input);
+    if (got == 0)
+        _in_eof = true;
+    _in_end += got;
+    //strtod stops at the terminator
+    _in_buffer[_in_end] = '\0';
+}
+
+double BufferedTextChannel::read() {
+    if (_in_failed)
+        return 0.0;
+
+    while (true) {
+        while (_in_begin < _in_end && std::isspace(static_cast<unsigned char>(_in_buffer[_in_begin])))
+            _in_begin++;
+        if (_in_begin == _in_end) {
+            if (_in_eof)
+                break;
+            refill();
+            continue;
+        }
+
+        //A value cut by the end of the buffer is completed first
+        int end = _in_begin;
+        while (end < _in_end && !std::isspace(static_cast<unsigned char>(_in_buffer[end])))
+            end++;
+        if (end == _in_end && !_in_eof && (_in_begin > 0 || _in_end < BUFFER_SIZE)) {
+            refill();
+            continue;
+        }
+
+        //Like scanf, the parsed prefix is consumed and a value that does not parse stops input
+        char *start = _in_buffer.get() + _in_begin;
+        char *parsed;
+        double val = std::strtod(start, &parsed);
+        if (parsed == start)
+            break;
+        _in_begin += parsed - start;
+        return val;
+    }
+
+    _in_failed = true;
+    return 0.0;
+}
+
+void BufferedTextChannel::write(double val) {
+    //Longest %lg is well below 32 characters
+    if (_out_size > BUFFER_SIZE - 32)
+        flush();
+    _out_size += std::snprintf(_out_buffer.get() + _out_size, BUFFER_SIZE - _out_size, "%lg\n", val);
+}
+
+void BufferedTextChannel::flush() {
+    if (_out_size > 0) {
+        std::fwrite(_out_buffer.get(), 1, _out_size, _output);
+        _out_size = 0;
+    }
+    std::fflush(_output);
+}
+
+BinaryFileChannel::BinaryFileChannel(): _mapping(nullptr), _mapping_size(0), _input(nullptr), _input_size(0),
+    _input_position(0), _output(nullptr), _out_buffer(new double[BUFFER_VALUES]), _out_size(0) {
+}
+
+BinaryFileChannel::~BinaryFileChannel() {
+    flush();
+    if (_mapping != nullptr)
+        munmap(_mapping, _mapping_size);
+}
+
+bool BinaryFileChannel::open(const char *inputPath, FILE *output, std::string &error) {
+    _output = output;
+
+    FILE *file = fopen(inputPath, "rb");
+    if (file == nullptr) {
+        error = "cannot open input file";
+        return false;
+    }
+
+    struct stat fileStat;
+    int res = fstat(fileno(file), &fileStat);
+    if (res < 0) {
+        fclose(file);
+        error = "cannot read input file";
+        return false;
+    }
+
+    if (fileStat.st_size > 0) {
+        void *ptr = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+        if (ptr == MAP_FAILED) {
+            fclose(file);
+            error = "input file memory mapping failed";
+            return false;
+        }
+        //Values are read front to back once
+        madvise(ptr, fileStat.st_size, MADV_SEQUENTIAL);
+        _mapping = ptr;
+        _mapping_size = fileStat.st_size;
+        _input = static_cast<const double*>(ptr);
+        _input_size = fileStat.st_size / sizeof (double);
+    }
+    fclose(file);
+    return true;
+}
+
+double BinaryFileChannel::read() {
+    return _input_position < _input_size ? _input[_input_position++] : 0.0;
+}
+
+void BinaryFileChannel::write(double val) {
+    if (_out_size == BUFFER_VALUES)
+        flush();
+    _out_buffer[_out_size++] = val;
+}
+
+void BinaryFileChannel::flush() {
+    if (_output == nullptr)
+        return;
+    if (_out_size > 0) {
+        std::fwrite(_out_buffer.get(), sizeof (double), _out_size, _output);
+        _out_size = 0;
+    }
+    std::fflush(_output);
+}
+
+MemoryChannel::MemoryChannel(): _input(nullptr), _input_size(0), _input_position(0), _output(nullptr),
+    _output_size(0), _output_count(0) {
+}
+
+void MemoryChannel::setInput(const double *input, int size) {
+    _input = input;
+    _input_size = size;
+    _input_position = 0;
+}
+
+void MemoryChannel::setOutput(double *output, int size) {
+    _output = output;
+    _output_size = size;
+    _output_count = 0;
+}
+
+int MemoryChannel::getOutputCount() const {
+    return _output_count;
+}
@@ -0,0 +1,126 @@
+#ifndef STACK_PROCESSOR_IO_CHANNEL_H
+#define STACK_PROCESSOR_IO_CHANNEL_H
+#include <cstdio>
+#include <memory>
+#include <string>
+
+//Where in takes its values from and where out sends them. Reading past the end of
+//the input gives 0, like a failed scanf did.
+class IoChannel {
+public:
+    virtual ~IoChannel() = default;
+
+    virtual double read() = 0;
+
+    virtual void write(double val) = 0;
+
+    //Pushes buffered output out, called when a program stops
+    virtual void flush() {}
+};
+
+//Prompts with "in: " and reads with scanf, prints "out: value" for every out
+class InteractiveTextChannel: public IoChannel {
+public:
+    double read() override;
+
+    void write(double val) override;
+};
+
+//Whitespace separated values from a file without prompts, one value per output line.
+//Both directions go through large buffers
+class BufferedTextChannel: public IoChannel {
+private:
+    static constexpr int BUFFER_SIZE = 1 << 16;
+
+    FILE *_input;
+    FILE *_output;
+    std::unique_ptr<char[]> _in_buffer;
+    int _in_begin;
+    int _in_end;
+    bool _in_eof;
+    bool _in_failed;
+    std::unique_ptr<char[]> _out_buffer;
+    int _out_size;
+
+    //Moves unread text to the front and reads more after it
+    void refill();
+
+public:
+    BufferedTextChannel(FILE *input, FILE *output);
+
+    ~BufferedTextChannel() override;
+
+    double read() override;
+
+    void write(double val) override;
+
+    void flush() override;
+};
+
+//Native doubles from a memory-mapped file, out writes native doubles through a buffer
+class BinaryFileChannel: public IoChannel {
+private:
+    static constexpr int BUFFER_VALUES = 1 << 13;
+
+    void *_mapping;
+    size_t _mapping_size;
+    const double *_input;
+    size_t _input_size;
+    size_t _input_position;
+    FILE *_output;
+    std::unique_ptr<double[]> _out_buffer;
+    int _out_size;
+
+public:
+    BinaryFileChannel();
+
+    ~BinaryFileChannel() override;
+
+    BinaryFileChannel(const BinaryFileChannel&) = delete;
+
+    BinaryFileChannel &operator=(const BinaryFileChannel&) = delete;
+
+    //Returns false and sets error if the input cannot be mapped. An empty file is valid
+    bool open(const char *inputPath, FILE *output, std::string &error);
+
+    double read() override;
+
+    void write(double val) override;
+
+    void flush() override;
+};
+
+//Caller-owned spans for embedding. Values written past the output capacity are
+//dropped but still counted
+class MemoryChannel: public IoChannel {
+private:
+    const double *_input;
+    int _input_size;
+    int _input_position;
+    double *_output;
+    int _output_size;
+    int _output_count;
+
+public:
+    MemoryChannel();
+
+    void setInput(const double *input, int size);
+
+    void setOutput(double *output, int size);
+
+    //How many times out was executed since setOutput
+    int getOutputCount() const;
+
+    double read() override {
+        int position = _input_position++;
+        return position < _input_size ? _input[position] : 0.0;
+    }
+
+    void write(double val) override {
+        if (_output_count < _output_size)
+            _output[_output_count] = val;
+        _output_count++;
+    }
+};
+
+#endif //STACK_PROCESSOR_IO_CHANNEL_H
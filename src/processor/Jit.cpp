@@ -0,0 +1,946 @@
+#include "Jit.h"
+#include "Processor.h"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <sys/mman.h>
+
+//Everything the generated code reads from or writes back to the processor
+struct JitContext {
+    double *stackTop;
+    double *stackBase;
+    double *stackLimit;
+    int *callTop;
+    int *callBase;
+    int *callLimit;
+    char *memory;
+    //Register addresses below it are valid, see RAM::isValidAddr
+    unsigned long long memoryLimit;
+    const void *const *entries;
+    DoubleUll reg[4];
+    double epsilon;
+    unsigned long long absMask;
+    Processor *processor;
+    //Instruction index to enter at, after a side exit the one the interpreter resumes from
+    int start;
+};
+
+//Value the generated code returns after a side exit instead of a ProcessorStatus
+static constexpr int SIDE_EXIT = -1;
+
+#if defined(__x86_64__)
+
+enum GeneralRegister {
+    RAX = 0, RCX, RDX, RBX, RSP, RBP, RSI, RDI, R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+enum XmmRegister {
+    XMM0 = 0, XMM1, XMM2, XMM3, XMM4, XMM5, XMM6, XMM7,
+    XMM8, XMM9, XMM10, XMM11, XMM12, XMM13, XMM14, XMM15
+};
+
+enum ConditionCode {
+    CC_B = 0x2, CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5, CC_BE = 0x6, CC_A = 0x7,
+    CC_L = 0xC, CC_GE = 0xD, CC_LE = 0xE, CC_G = 0xF
+};
+
+//Register assignment of the generated code. General purpose registers are callee-saved,
+//xmm ones are spilled to JitContext around calls to C functions.
+static constexpr int SP = RBX; //Data stack pointer, layout matches the interpreter with top of stack caching
+static constexpr int STACK_BASE = R12;
+static constexpr int STACK_LIMIT = R13;
+static constexpr int CONTEXT = R14;
+static constexpr int CALL_SP = R15;
+static constexpr int MEMORY = RBP;
+static constexpr int REG_BASE = XMM8; //_reg[i] lives in XMM8 + i
+static constexpr int TOS = XMM12;
+static constexpr int EPSILON = XMM13;
+static constexpr int ABS_MASK = XMM14;
+
+//Just enough of x86-64 encoding for the templates below
+class X86Emitter {
+private:
+    struct Fixup {
+        size_t position;
+        int label;
+    };
+
+    std::vector<unsigned char> _code;
+    std::vector<long> _labels;
+    std::vector<Fixup> _fixups;
+
+    void rex(bool wide, int reg, int index, int base) {
+        int prefix = 0x40 | (wide ? 8 : 0) | ((reg >> 3) << 2) | ((index >> 3) << 1) | (base >> 3);
+        if (prefix != 0x40)
+            byte(prefix);
+    }
+
+    void registerOperand(int reg, int rm) {
+        byte(0xC0 | (reg & 7) << 3 | (rm & 7));
+    }
+
+    //[base + disp32]
+    void memoryOperand(int reg, int base, int disp) {
+        byte(0x80 | (reg & 7) << 3 | (base & 7));
+        if ((base & 7) == RSP)
+            byte(0x24);
+        int32(disp);
+    }
+
+    void sse(int prefix, int opcode, int reg, int rm) {
+        byte(prefix);
+        rex(false, reg, 0, rm);
+        byte(0x0F);
+        byte(opcode);
+        registerOperand(reg, rm);
+    }
+
+    void sseMemory(int prefix, int opcode, int reg, int base, int disp) {
+        byte(prefix);
+        rex(false, reg, 0, base);
+        byte(0x0F);
+        byte(opcode);
+        memoryOperand(reg, base, disp);
+    }
+
+    void arithmeticImmediate(int extension, int reg, int imm) {
+        rex(true, 0, 0, reg);
+        byte(0x81);
+        registerOperand(extension, reg);
+        int32(imm);
+    }
+
+    void fixup(int label) {
+        _fixups.push_back({_code.size(), label});
+        int32(0);
+    }
+
+public:
+    void byte(int value) {
+        _code.push_back(static_cast<unsigned char>(value));
+    }
+
+    void int32(int value) {
+        unsigned char bytes[sizeof (int)];
+        std::memcpy(bytes, &value, sizeof (int));
+        _code.insert(_code.end(), bytes, bytes + sizeof (int));
+    }
+
+    void int64(unsigned long long value) {
+        unsigned char bytes[sizeof (value)];
+        std::memcpy(bytes, &value, sizeof (value));
+        _code.insert(_code.end(), bytes, bytes + sizeof (value));
+    }
+
+    int newLabel() {
+        _labels.push_back(-1);
+        return _labels.size() - 1;
+    }
+
+    void bind(int label) {
+        _labels[label] = _code.size();
+    }
+
+    long getLabelPosition(int label) const {
+        return _labels[label];
+    }
+
+    const std::vector<unsigned char> &getCode() {
+        for (const Fixup &pending : _fixups) {
+            int relative = _labels[pending.label] - static_cast<long>(pending.position + sizeof (int));
+            std::memcpy(&_code[pending.position], &relative, sizeof (int));
+        }
+        _fixups.clear();
+        return _code;
+    }
+
+    void movsdLoad(int xmm, int base, int disp) { sseMemory(0xF2, 0x10, xmm, base, disp); }
+    void movsdStore(int base, int disp, int xmm) { sseMemory(0xF2, 0x11, xmm, base, disp); }
+    void movapd(int dst, int src) { sse(0x66, 0x28, dst, src); }
+    void addsd(int dst, int src) { sse(0xF2, 0x58, dst, src); }
+    void addsdMemory(int dst, int base, int disp) { sseMemory(0xF2, 0x58, dst, base, disp); }
+    void mulsdMemory(int dst, int base, int disp) { sseMemory(0xF2, 0x59, dst, base, disp); }
+    void subsd(int dst, int src) { sse(0xF2, 0x5C, dst, src); }
+    void divsd(int dst, int src) { sse(0xF2, 0x5E, dst, src); }
+    void sqrtsd(int dst, int src) { sse(0xF2, 0x51, dst, src); }
+    void andpd(int dst, int src) { sse(0x66, 0x54, dst, src); }
+    void ucomisd(int left, int right) { sse(0x66, 0x2E, left, right); }
+
+    //cvtsi2sd xmm, r64
+    void cvtsi2sd(int xmm, int reg) {
+        byte(0xF2);
+        rex(true, xmm, 0, reg);
+        byte(0x0F);
+        byte(0x2A);
+        registerOperand(xmm, reg);
+    }
+
+    //cvttsd2si r64, xmm
+    void cvttsd2si(int reg, int xmm) {
+        byte(0xF2);
+        rex(true, reg, 0, xmm);
+        byte(0x0F);
+        byte(0x2C);
+        registerOperand(reg, xmm);
+    }
+
+    //movq xmm, r64
+    void movqToXmm(int xmm, int reg) {
+        byte(0x66);
+        rex(true, xmm, 0, reg);
+        byte(0x0F);
+        byte(0x6E);
+        registerOperand(xmm, reg);
+    }
+
+    //movq r64, xmm
+    void movqFromXmm(int reg, int xmm) {
+        byte(0x66);
+        rex(true, xmm, 0, reg);
+        byte(0x0F);
+        byte(0x7E);
+        registerOperand(xmm, reg);
+    }
+
+    void movImmediate64(int reg, unsigned long long value) {
+        rex(true, 0, 0, reg);
+        byte(0xB8 | (reg & 7));
+        int64(value);
+    }
+
+    void movImmediate32(int reg, int value) {
+        rex(false, 0, 0, reg);
+        byte(0xB8 | (reg & 7));
+        int32(value);
+    }
+
+    void mov(int dst, int src) {
+        rex(true, src, 0, dst);
+        byte(0x89);
+        registerOperand(src, dst);
+    }
+
+    //Zero extends the low half of reg
+    void mov32(int dst, int src) {
+        rex(false, src, 0, dst);
+        byte(0x89);
+        registerOperand(src, dst);
+    }
+
+    void load(int dst, int base, int disp) {
+        rex(true, dst, 0, base);
+        byte(0x8B);
+        memoryOperand(dst, base, disp);
+    }
+
+    void load32(int dst, int base, int disp) {
+        rex(false, dst, 0, base);
+        byte(0x8B);
+        memoryOperand(dst, base, disp);
+    }
+
+    void store(int base, int disp, int src) {
+        rex(true, src, 0, base);
+        byte(0x89);
+        memoryOperand(src, base, disp);
+    }
+
+    void storeImmediate32(int base, int disp, int value) {
+        rex(false, 0, 0, base);
+        byte(0xC7);
+        memoryOperand(0, base, disp);
+        int32(value);
+    }
+
+    void add(int dst, int src) {
+        rex(true, src, 0, dst);
+        byte(0x01);
+        registerOperand(src, dst);
+    }
+
+    void sub(int dst, int src) {
+        rex(true, src, 0, dst);
+        byte(0x29);
+        registerOperand(src, dst);
+    }
+
+    void bitAnd(int dst, int src) {
+        rex(true, src, 0, dst);
+        byte(0x21);
+        registerOperand(src, dst);
+    }
+
+    void bitOr(int dst, int src) {
+        rex(true, src, 0, dst);
+        byte(0x09);
+        registerOperand(src, dst);
+    }
+
+    void bitXor(int dst, int src) {
+        rex(true, src, 0, dst);
+        byte(0x31);
+        registerOperand(src, dst);
+    }
+
+    void test(int left, int right) {
+        rex(true, right, 0, left);
+        byte(0x85);
+        registerOperand(right, left);
+    }
+
+    void imul(int dst, int src) {
+        rex(true, dst, 0, src);
+        byte(0x0F);
+        byte(0xAF);
+        registerOperand(dst, src);
+    }
+
+    //Sign extends rax into rdx
+    void cqo() {
+        byte(0x48);
+        byte(0x99);
+    }
+
+    //rdx:rax / reg, quotient in rax, remainder in rdx
+    void idiv(int reg) {
+        rex(true, 0, 0, reg);
+        byte(0xF7);
+        registerOperand(7, reg);
+    }
+
+    void neg(int reg) {
+        rex(true, 0, 0, reg);
+        byte(0xF7);
+        registerOperand(3, reg);
+    }
+
+    //Shifts by cl modulo 64
+    void shlCl(int reg) {
+        rex(true, 0, 0, reg);
+        byte(0xD3);
+        registerOperand(4, reg);
+    }
+
+    void sarCl(int reg) {
+        rex(true, 0, 0, reg);
+        byte(0xD3);
+        registerOperand(7, reg);
+    }
+
+    void addImmediate(int reg, int value) { arithmeticImmediate(0, reg, value); }
+    void subImmediate(int reg, int value) { arithmeticImmediate(5, reg, value); }
+    void cmpImmediate(int reg, int value) { arithmeticImmediate(7, reg, value); }
+
+    void cmpImmediate32(int reg, int value) {
+        rex(false, 0, 0, reg);
+        byte(0x81);
+        registerOperand(7, reg);
+        int32(value);
+    }
+
+    void cmp(int left, int right) {
+        rex(true, right, 0, left);
+        byte(0x39);
+        registerOperand(right, left);
+    }
+
+    void cmpMemory(int left, int base, int disp) {
+        rex(true, left, 0, base);
+        byte(0x3B);
+        memoryOperand(left, base, disp);
+    }
+
+    void push(int reg) {
+        rex(false, 0, 0, reg);
+        byte(0x50 | (reg & 7));
+    }
+
+    void pop(int reg) {
+        rex(false, 0, 0, reg);
+        byte(0x58 | (reg & 7));
+    }
+
+    void call(int reg) {
+        rex(false, 0, 0, reg);
+        byte(0xFF);
+        registerOperand(2, reg);
+    }
+
+    //jmp [table + index * 8], table must not be rbp or r13
+    void jmpTable(int table, int index) {
+        rex(false, 0, index, table);
+        byte(0xFF);
+        byte(0x24);
+        byte(0xC0 | (index & 7) << 3 | (table & 7));
+    }
+
+    void jmp(int label) {
+        byte(0xE9);
+        fixup(label);
+    }
+
+    void jcc(ConditionCode condition, int label) {
+        byte(0x0F);
+        byte(0x80 | condition);
+        fixup(label);
+    }
+
+    void ret() {
+        byte(0xC3);
+    }
+};
+
+#define CONTEXT_FIELD(field) static_cast<int>(offsetof(JitContext, field))
+
+//Emits the templates of one program
+class JitCompiler {
+private:
+    const DecodedProgram &_program;
+    X86Emitter _x;
+    std::vector<int> _instructionLabels;
+    int _statusLabels[ProcessorStatus::INTEGER_DIVISION_BY_ZERO + 1];
+    int _epilogue;
+    //Side exit label and instruction index it resumes from
+    std::vector<std::pair<int, int>> _sideExits;
+
+    int getStatusLabel(ProcessorStatus status) {
+        return _statusLabels[status];
+    }
+
+    int addSideExit(int index) {
+        int label = _x.newLabel();
+        _sideExits.push_back(std::make_pair(label, index));
+        return label;
+    }
+
+    void spillRegisters() {
+        for (int i = 0; i < 4; i++)
+            _x.movsdStore(CONTEXT, CONTEXT_FIELD(reg) + i * sizeof (DoubleUll), REG_BASE + i);
+    }
+
+    void reloadRegisters() {
+        for (int i = 0; i < 4; i++)
+            _x.movsdLoad(REG_BASE + i, CONTEXT, CONTEXT_FIELD(reg) + i * sizeof (DoubleUll));
+        _x.movsdLoad(EPSILON, CONTEXT, CONTEXT_FIELD(epsilon));
+        _x.movsdLoad(ABS_MASK, CONTEXT, CONTEXT_FIELD(absMask));
+    }
+
+    //Arguments must already be in place, TOS does not survive the call
+    void callFunction(const void *function) {
+        spillRegisters();
+        _x.movImmediate64(RAX, reinterpret_cast<unsigned long long>(function));
+        _x.call(RAX);
+        reloadRegisters();
+    }
+
+    void require(int count) {
+        if (_program.verified)
+            return;
+        _x.mov(RAX, SP);
+        _x.sub(RAX, STACK_BASE);
+        _x.cmpImmediate(RAX, count * sizeof (double));
+        _x.jcc(CC_B, getStatusLabel(ProcessorStatus::DATA_STACK_UNDERFLOW));
+    }
+
+    //Makes room for a new top of stack, the value is then written to TOS
+    void beginPush() {
+        _x.cmp(SP, STACK_LIMIT);
+        _x.jcc(CC_AE, getStatusLabel(ProcessorStatus::DATA_STACK_OVERFLOW));
+        _x.movsdStore(SP, -8, TOS);
+        _x.addImmediate(SP, sizeof (double));
+    }
+
+    void drop() {
+        _x.subImmediate(SP, sizeof (double));
+        _x.movsdLoad(TOS, SP, -8);
+    }
+
+    //Leaves the RAM address held by register reg in rax
+    void registerAddress(int reg) {
+        _x.movqFromXmm(RAX, REG_BASE + reg);
+        _x.cmpMemory(RAX, CONTEXT, CONTEXT_FIELD(memoryLimit));
+        _x.jcc(CC_AE, getStatusLabel(ProcessorStatus::INVALID_RAM_ADDRESS));
+        _x.mov32(RAX, RAX);
+        _x.add(RAX, MEMORY);
+    }
+
+    void binaryOperation(unsigned char opcode) {
+        require(2);
+        _x.subImmediate(SP, sizeof (double));
+        switch (opcode) {
+            case OperationPrefixCode::ADD:
+                _x.addsdMemory(TOS, SP, -8);
+                break;
+            case OperationPrefixCode::MUL:
+                _x.mulsdMemory(TOS, SP, -8);
+                break;
+            default:
+                _x.movsdLoad(XMM0, SP, -8);
+                if (opcode == OperationPrefixCode::SUB)
+                    _x.subsd(XMM0, TOS);
+                else
+                    _x.divsd(XMM0, TOS);
+                _x.movapd(TOS, XMM0);
+        }
+    }
+
+    //Jumps to target if the condition holds for SECOND and TOS, same comparisons as ExecutionLoop.cpp
+    void conditionalJump(unsigned char opcode, int target) {
+        require(2);
+        _x.movsdLoad(XMM0, SP, -16);
+        bool equal = opcode == OperationPrefixCode::JE_OFFSET_EXACT_VAL ||
+                     opcode == OperationPrefixCode::JAE_OFFSET_EXACT_VAL ||
+                     opcode == OperationPrefixCode::JBE_OFFSET_EXACT_VAL;
+        switch (opcode) {
+            case OperationPrefixCode::JNE_OFFSET_EXACT_VAL:
+                _x.movapd(XMM1, TOS);
+                _x.subsd(XMM1, XMM0);
+                _x.andpd(XMM1, ABS_MASK);
+                _x.ucomisd(XMM1, EPSILON);
+                _x.jcc(CC_AE, target);
+                return;
+            case OperationPrefixCode::JA_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::JAE_OFFSET_EXACT_VAL:
+                _x.movapd(XMM1, TOS);
+                _x.addsd(XMM1, EPSILON);
+                _x.ucomisd(XMM0, XMM1);
+                _x.jcc(CC_A, target);
+                break;
+            case OperationPrefixCode::JB_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::JBE_OFFSET_EXACT_VAL:
+                _x.movapd(XMM1, XMM0);
+                _x.addsd(XMM1, EPSILON);
+                _x.ucomisd(TOS, XMM1);
+                _x.jcc(CC_A, target);
+                break;
+        }
+        if (equal) {
+            _x.movapd(XMM1, TOS);
+            _x.subsd(XMM1, XMM0);
+            _x.andpd(XMM1, ABS_MASK);
+            _x.ucomisd(EPSILON, XMM1);
+            _x.jcc(CC_A, target);
+        }
+    }
+
+    //SECOND in rax and TOS in rcx as integers, same operations as IntegerOperations.h
+    void integerOperation(unsigned char opcode) {
+        require(2);
+        _x.load(RAX, SP, -16);
+        _x.movqFromXmm(RCX, TOS);
+        switch (opcode) {
+            case OperationPrefixCode::IADD:
+                _x.add(RAX, RCX);
+                break;
+            case OperationPrefixCode::ISUB:
+                _x.sub(RAX, RCX);
+                break;
+            case OperationPrefixCode::IMUL:
+                _x.imul(RAX, RCX);
+                break;
+            case OperationPrefixCode::IAND:
+                _x.bitAnd(RAX, RCX);
+                break;
+            case OperationPrefixCode::IOR:
+                _x.bitOr(RAX, RCX);
+                break;
+            case OperationPrefixCode::IXOR:
+                _x.bitXor(RAX, RCX);
+                break;
+            case OperationPrefixCode::ISHL:
+                _x.shlCl(RAX);
+                break;
+            case OperationPrefixCode::ISHR:
+                _x.sarCl(RAX);
+                break;
+            default: {
+                //idiv faults on LLONG_MIN / -1, dividing by -1 negates instead
+                bool remainder = opcode == OperationPrefixCode::IREM;
+                int byMinusOne = _x.newLabel();
+                int done = _x.newLabel();
+                _x.test(RCX, RCX);
+                _x.jcc(CC_E, getStatusLabel(ProcessorStatus::INTEGER_DIVISION_BY_ZERO));
+                _x.cmpImmediate(RCX, -1);
+                _x.jcc(CC_E, byMinusOne);
+                _x.cqo();
+                _x.idiv(RCX);
+                if (remainder)
+                    _x.mov(RAX, RDX);
+                _x.jmp(done);
+                _x.bind(byMinusOne);
+                if (remainder)
+                    _x.bitXor(RAX, RAX);
+                else
+                    _x.neg(RAX);
+                _x.bind(done);
+            }
+        }
+        _x.subImmediate(SP, sizeof (double));
+        _x.movqToXmm(TOS, RAX);
+    }
+
+    void integerJump(unsigned char opcode, int target) {
+        static const ConditionCode conditions[] = {CC_E, CC_NE, CC_G, CC_GE, CC_L, CC_LE};
+        require(2);
+        _x.load(RAX, SP, -16);
+        _x.movqFromXmm(RCX, TOS);
+        _x.cmp(RAX, RCX);
+        _x.jcc(conditions[opcode - OperationPrefixCode::IJE_OFFSET_EXACT_VAL], target);
+    }
+
+    void emitPrologue() {
+        _x.push(RBX);
+        _x.push(RBP);
+        _x.push(R12);
+        _x.push(R13);
+        _x.push(R14);
+        _x.push(R15);
+        //Keeps the stack 16 byte aligned at calls
+        _x.subImmediate(RSP, 8);
+
+        _x.mov(CONTEXT, RDI);
+        _x.load(SP, CONTEXT, CONTEXT_FIELD(stackTop));
+        _x.load(STACK_BASE, CONTEXT, CONTEXT_FIELD(stackBase));
+        _x.load(STACK_LIMIT, CONTEXT, CONTEXT_FIELD(stackLimit));
+        _x.load(CALL_SP, CONTEXT, CONTEXT_FIELD(callTop));
+        _x.load(MEMORY, CONTEXT, CONTEXT_FIELD(memory));
+        reloadRegisters();
+        //Stale or spare slot if the stack is empty
+        _x.movsdLoad(TOS, SP, -8);
+
+        _x.load32(RAX, CONTEXT, CONTEXT_FIELD(start));
+        _x.load(RCX, CONTEXT, CONTEXT_FIELD(entries));
+        _x.jmpTable(RCX, RAX);
+    }
+
+    //Status or SIDE_EXIT is in eax
+    void emitEpilogue() {
+        _x.bind(_epilogue);
+        _x.movsdStore(SP, -8, TOS);
+        spillRegisters();
+        _x.store(CONTEXT, CONTEXT_FIELD(stackTop), SP);
+        _x.store(CONTEXT, CONTEXT_FIELD(callTop), CALL_SP);
+        _x.addImmediate(RSP, 8);
+        _x.pop(R15);
+        _x.pop(R14);
+        _x.pop(R13);
+        _x.pop(R12);
+        _x.pop(RBP);
+        _x.pop(RBX);
+        _x.ret();
+    }
+
+    void emitExits() {
+        for (int status = 0; status <= ProcessorStatus::INTEGER_DIVISION_BY_ZERO; status++) {
+            _x.bind(_statusLabels[status]);
+            _x.movImmediate32(RAX, status);
+            _x.jmp(_epilogue);
+        }
+        for (const std::pair<int, int> &exit : _sideExits) {
+            _x.bind(exit.first);
+            _x.storeImmediate32(CONTEXT, CONTEXT_FIELD(start), exit.second);
+            _x.movImmediate32(RAX, SIDE_EXIT);
+            _x.jmp(_epilogue);
+        }
+    }
+
+    void emitInstruction(int index) {
+        const DecodedInstruction &ins = _program.instructions[index];
+        DoubleUll immediate;
+
+        switch (ins.opcode) {
+            case OperationPrefixCode::IN:
+                //Input is read before the overflow check like in the interpreter
+                _x.movsdStore(SP, -8, TOS);
+                _x.mov(RDI, CONTEXT);
+                callFunction(reinterpret_cast<const void*>(&Jit::readInput));
+                _x.movsdLoad(TOS, SP, -8);
+                beginPush();
+                _x.movapd(TOS, XMM0);
+                break;
+            case OperationPrefixCode::OUT:
+                require(1);
+                _x.mov(RDI, CONTEXT);
+                _x.movapd(XMM0, TOS);
+                callFunction(reinterpret_cast<const void*>(&Jit::writeOutput));
+                drop();
+                break;
+            case OperationPrefixCode::ADD:
+            case OperationPrefixCode::SUB:
+            case OperationPrefixCode::MUL:
+            case OperationPrefixCode::DIV:
+                binaryOperation(ins.opcode);
+                break;
+            case OperationPrefixCode::SIN:
+            case OperationPrefixCode::COS: {
+                double (*function)(double) = ins.opcode == OperationPrefixCode::SIN ?
+                    static_cast<double (*)(double)>(std::sin) : static_cast<double (*)(double)>(std::cos);
+                require(1);
+                _x.movapd(XMM0, TOS);
+                callFunction(reinterpret_cast<const void*>(function));
+                _x.movapd(TOS, XMM0);
+                break;
+            }
+            case OperationPrefixCode::SQRT:
+                require(1);
+                _x.sqrtsd(TOS, TOS);
+                break;
+            case OperationPrefixCode::IADD:
+            case OperationPrefixCode::ISUB:
+            case OperationPrefixCode::IMUL:
+            case OperationPrefixCode::IDIV:
+            case OperationPrefixCode::IREM:
+            case OperationPrefixCode::IAND:
+            case OperationPrefixCode::IOR:
+            case OperationPrefixCode::IXOR:
+            case OperationPrefixCode::ISHL:
+            case OperationPrefixCode::ISHR:
+                integerOperation(ins.opcode);
+                break;
+            case OperationPrefixCode::ITOD:
+                require(1);
+                _x.movqFromXmm(RAX, TOS);
+                _x.cvtsi2sd(TOS, RAX);
+                break;
+            case OperationPrefixCode::DTOI:
+                //NaN and values out of range give LLONG_MIN like IntegerOperations::truncate
+                require(1);
+                _x.cvttsd2si(RAX, TOS);
+                _x.movqToXmm(TOS, RAX);
+                break;
+            case OperationPrefixCode::RET_ABS:
+                if (!_program.verified) {
+                    _x.cmpMemory(CALL_SP, CONTEXT, CONTEXT_FIELD(callBase));
+                    _x.jcc(CC_BE, getStatusLabel(ProcessorStatus::CALL_STACK_UNDERFLOW));
+                }
+                _x.subImmediate(CALL_SP, sizeof (int));
+                _x.load32(RAX, CALL_SP, 0);
+                _x.load(RCX, CONTEXT, CONTEXT_FIELD(entries));
+                _x.jmpTable(RCX, RAX);
+                break;
+            case OperationPrefixCode::HALT:
+                _x.jmp(getStatusLabel(ProcessorStatus::SUCCESS));
+                break;
+            case OperationPrefixCode::POP:
+                require(1);
+                drop();
+                break;
+            case OperationPrefixCode::PUSH_REG_VAL:
+                beginPush();
+                _x.movapd(TOS, REG_BASE + ins.reg);
+                break;
+            case OperationPrefixCode::PUSH_EXACT_VAL:
+                beginPush();
+                immediate.db_val = ins.val;
+                _x.movImmediate64(RAX, immediate.ull_val);
+                _x.movqToXmm(TOS, RAX);
+                break;
+            case OperationPrefixCode::PUSH_REG_ADDR:
+                registerAddress(ins.reg);
+                beginPush();
+                _x.movsdLoad(TOS, RAX, 0);
+                break;
+            case OperationPrefixCode::PUSH_EXACT_ADDR:
+                beginPush();
+                _x.movsdLoad(TOS, MEMORY, ins.arg);
+                break;
+            case OperationPrefixCode::POP_REG_VAL:
+                require(1);
+                _x.movapd(REG_BASE + ins.reg, TOS);
+                drop();
+                break;
+            case OperationPrefixCode::POP_EXACT_ADDR:
+                require(1);
+                _x.movsdStore(MEMORY, ins.arg, TOS);
+                drop();
+                break;
+            case OperationPrefixCode::POP_REG_ADDR:
+                require(1);
+                registerAddress(ins.reg);
+                _x.movsdStore(RAX, 0, TOS);
+                drop();
+                break;
+            case OperationPrefixCode::JMP_OFFSET_EXACT_VAL:
+                _x.jmp(_instructionLabels[ins.arg]);
+                break;
+            case OperationPrefixCode::JE_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::JNE_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::JA_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::JAE_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::JB_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::JBE_OFFSET_EXACT_VAL:
+                conditionalJump(ins.opcode, _instructionLabels[ins.arg]);
+                break;
+            case OperationPrefixCode::IJE_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::IJNE_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::IJA_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::IJAE_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::IJB_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::IJBE_OFFSET_EXACT_VAL:
+                integerJump(ins.opcode, _instructionLabels[ins.arg]);
+                break;
+            case OperationPrefixCode::CALL_OFFSET_EXACT_VAL:
+                //The interpreter continues with its deeper call stack or reports the overflow
+                _x.cmpMemory(CALL_SP, CONTEXT, CONTEXT_FIELD(callLimit));
+                _x.jcc(CC_AE, addSideExit(index));
+                _x.storeImmediate32(CALL_SP, 0, index + 1);
+                _x.addImmediate(CALL_SP, sizeof (int));
+                _x.jmp(_instructionLabels[ins.arg]);
+                break;
+            case OperationPrefixCode::VADD:
+            case OperationPrefixCode::VMUL:
+            case OperationPrefixCode::VFMA:
+            case OperationPrefixCode::VSUM:
+            case OperationPrefixCode::VMIN:
+            case OperationPrefixCode::VMAX:
+            case OperationPrefixCode::VDOT:
+            case OperationPrefixCode::VFILL:
+            case OperationPrefixCode::VCOPY: {
+                int needed, pushed;
+                VectorOperations::getStackEffect(ins.opcode, needed, pushed);
+                require(needed);
+                _x.movsdStore(SP, -8, TOS);
+                _x.store(CONTEXT, CONTEXT_FIELD(stackTop), SP);
+                _x.mov(RDI, CONTEXT);
+                _x.movImmediate32(RSI, ins.opcode);
+                callFunction(reinterpret_cast<const void*>(&Jit::vectorOperation));
+                _x.load(SP, CONTEXT, CONTEXT_FIELD(stackTop));
+                _x.movsdLoad(TOS, SP, -8);
+                //The status is left in eax for the epilogue
+                _x.cmpImmediate32(RAX, ProcessorStatus::SUCCESS);
+                _x.jcc(CC_NE, _epilogue);
+                break;
+            }
+            case InternalOperationCode::TRAP:
+                _x.jmp(getStatusLabel(static_cast<ProcessorStatus>(ins.arg)));
+                break;
+            default:
+                _x.jmp(addSideExit(index));
+        }
+    }
+
+public:
+    explicit JitCompiler(const DecodedProgram &program): _program(program) {
+        for (int &label : _statusLabels)
+            label = _x.newLabel();
+        _epilogue = _x.newLabel();
+        for (size_t i = 0; i < program.instructions.size(); i++)
+            _instructionLabels.push_back(_x.newLabel());
+    }
+
+    const std::vector<unsigned char> &compile() {
+        emitPrologue();
+        for (size_t i = 0; i < _program.instructions.size(); i++) {
+            _x.bind(_instructionLabels[i]);
+            emitInstruction(i);
+        }
+        emitExits();
+        emitEpilogue();
+        return _x.getCode();
+    }
+
+    long getInstructionPosition(int index) const {
+        return _x.getLabelPosition(_instructionLabels[index]);
+    }
+};
+
+#undef CONTEXT_FIELD
+
+#endif
+
+Jit::Jit(): _code(nullptr), _codeSize(0), _callStack(new int[CALL_STACK_CAPACITY]) {
+}
+
+Jit::~Jit() {
+    release();
+}
+
+void Jit::release() {
+    if (_code != nullptr)
+        munmap(_code, _codeSize);
+    _code = nullptr;
+    _codeSize = 0;
+    _entries.clear();
+}
+
+double Jit::readInput(JitContext *context) {
+    return context->processor->readInput();
+}
+
+void Jit::writeOutput(JitContext *context, double val) {
+    context->processor->writeOutput(val);
+}
+
+int Jit::vectorOperation(JitContext *context, int opcode) {
+    return context->processor->executeVectorOperation(opcode, context->stackTop);
+}
+
+bool Jit::compile(const DecodedProgram &program, std::string &diagnostic) {
+    release();
+    //Native calls do not keep the frame pointer
+    if (program.frames) {
+        diagnostic = "frame slots run in the interpreter";
+        return false;
+    }
+#if defined(__x86_64__)
+    JitCompiler compiler(program);
+    const std::vector<unsigned char> &code = compiler.compile();
+
+    void *memory = mmap(nullptr, code.size(), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) {
+        diagnostic = "cannot allocate memory for native code";
+        return false;
+    }
+    std::memcpy(memory, code.data(), code.size());
+    if (mprotect(memory, code.size(), PROT_READ | PROT_EXEC) != 0) {
+        munmap(memory, code.size());
+        diagnostic = "cannot make native code executable";
+        return false;
+    }
+    _code = memory;
+    _codeSize = code.size();
+
+    for (size_t i = 0; i < program.instructions.size(); i++)
+        _entries.push_back(static_cast<const char*>(_code) + compiler.getInstructionPosition(i));
+    diagnostic.clear();
+    return true;
+#else
+    (void) program;
+    diagnostic = "native code generation needs x86-64";
+    return false;
+#endif
+}
+
+ProcessorStatus Jit::run(Processor &processor) {
+    std::memset(processor._reg, 0, sizeof (processor._reg));
+    if (_code == nullptr || processor._call_stack.size() > static_cast<size_t>(CALL_STACK_CAPACITY))
+        return processor.resume(processor._program, 0);
+
+    JitContext context;
+    context.stackTop = processor._data_stack_top;
+    context.stackBase = processor._data_stack_base;
+    context.stackLimit = processor._data_stack_base + processor._data_stack_capacity;
+    context.callBase = _callStack.get();
+    //Calls past the capacity of the processor side exit and overflow in the interpreter
+    int callCapacity = processor._call_stack.getCapacity();
+    context.callLimit = _callStack.get() + (callCapacity < CALL_STACK_CAPACITY ? callCapacity : CALL_STACK_CAPACITY);
+    context.callTop = std::copy(processor._call_stack.begin(), processor._call_stack.end(), context.callBase);
+    context.memory = processor._ram->getMemory();
+    context.memoryLimit = processor._ram->getSize() - sizeof (double) + 1;
+    context.entries = _entries.data();
+    std::memcpy(context.reg, processor._reg, sizeof (context.reg));
+    context.epsilon = PROCESSOR_EPSILON;
+    context.absMask = ~0ULL >> 1;
+    context.processor = &processor;
+    context.start = 0;
+
+    int result = reinterpret_cast<int (*)(JitContext*)>(_code)(&context);
+
+    processor._data_stack_top = context.stackTop;
+    processor._call_stack.assign(context.callBase, context.callTop);
+    std::memcpy(processor._reg, context.reg, sizeof (context.reg));
+    if (result == SIDE_EXIT)
+        return processor.resume(processor._program, context.start);
+    return static_cast<ProcessorStatus>(result);
+}
@@ -0,0 +1,57 @@
+#ifndef STACK_PROCESSOR_JIT_H
+#define STACK_PROCESSOR_JIT_H
+#include "../utils.h"
+#include "Decoder.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+class Processor;
+struct JitContext;
+
+//Template compiler from a decoded program to x86-64 machine code. Every decoded
+//instruction becomes a fixed sequence of native instructions, _reg and the top of
+//the data stack live in xmm registers, the rest of the stack stays in Processor memory.
+//Whatever the generated code cannot handle leaves through a side exit and the
+//interpreter continues from the same instruction with the same state.
+class Jit {
+private:
+    friend class JitCompiler;
+
+    void *_code;
+    size_t _codeSize;
+    //Native address of every decoded instruction, return addresses are looked up here
+    std::vector<const void*> _entries;
+    std::unique_ptr<int[]> _callStack;
+
+    static double readInput(JitContext *context);
+
+    static void writeOutput(JitContext *context, double val);
+
+    //Runs a vector instruction on the stack spilled to stackTop, returns the ProcessorStatus
+    static int vectorOperation(JitContext *context, int opcode);
+
+    void release();
+
+public:
+    //Deeper calls continue in the interpreter
+    static constexpr int CALL_STACK_CAPACITY = 1 << 16;
+
+    Jit();
+
+    ~Jit();
+
+    Jit(const Jit&) = delete;
+
+    Jit &operator=(const Jit&) = delete;
+
+    //Expects a program that was not fused. Returns false and sets diagnostic if no
+    //native code can be generated on this platform or the program uses frame slots
+    bool compile(const DecodedProgram &program, std::string &diagnostic);
+
+    //Runs the compiled program on the processor state, side exits resume processor's
+    //own program, which must have the same instruction indices as the compiled one
+    ProcessorStatus run(Processor &processor);
+};
+
+#endif //STACK_PROCESSOR_JIT_H
@@ -0,0 +1,436 @@
+#include "Memoizer.h"
+#include <algorithm>
+#include <cstring>
+#include <unordered_map>
+
+//Written registers hold this while a call is recorded, finding it at return means the call left them alone.
+//Callees never read these registers before writing them, so they cannot observe it
+static constexpr unsigned long long UNWRITTEN_REGISTER = 0x7ff8dead5eed0001ull;
+
+//What a function does to registers and whether it may be memoized, summarized over all its paths
+struct RegisterFacts {
+    bool pure;
+    bool loops; //Has a backward jump or a call, otherwise it is not worth a lookup
+    unsigned char exposed; //Registers read before written on some path
+    unsigned char mustWrite; //Registers written on every path to ret
+    unsigned char mayWrite;
+
+    bool operator!=(const RegisterFacts &other) const {
+        return pure != other.pure || loops != other.loops || exposed != other.exposed ||
+               mustWrite != other.mustWrite || mayWrite != other.mayWrite;
+    }
+};
+
+//Forward pass over the instructions of one function, calls use the facts known for their callee
+static RegisterFacts analyzeFunction(const std::vector<DecodedInstruction> &code, int entry,
+                                     const std::vector<int> &factsByEntry, const std::vector<RegisterFacts> &facts) {
+    RegisterFacts result = {true, false, 0, 0xf, 0};
+    int size = code.size();
+    //Registers written on every path to an instruction, -1 until it is reached
+    std::vector<int> written(size, -1);
+    std::vector<int> worklist;
+
+    auto flow = [&](int target, int mask) {
+        if (written[target] < 0) {
+            written[target] = mask;
+            worklist.push_back(target);
+        } else if ((written[target] & mask) != written[target]) {
+            written[target] &= mask;
+            worklist.push_back(target);
+        }
+    };
+
+    flow(entry, 0);
+    while (!worklist.empty() && result.pure) {
+        int index = worklist.back();
+        worklist.pop_back();
+        const DecodedInstruction &instruction = code[index];
+        int mask = written[index];
+        int bit = 1 << instruction.reg;
+        bool last = index + 1 >= size;
+
+        switch (instruction.opcode) {
+            case OperationPrefixCode::ADD:
+            case OperationPrefixCode::SUB:
+            case OperationPrefixCode::MUL:
+            case OperationPrefixCode::DIV:
+            case OperationPrefixCode::SIN:
+            case OperationPrefixCode::COS:
+            case OperationPrefixCode::SQRT:
+            case OperationPrefixCode::POP:
+            case OperationPrefixCode::PUSH_EXACT_VAL:
+            case OperationPrefixCode::IADD:
+            case OperationPrefixCode::ISUB:
+            case OperationPrefixCode::IMUL:
+            case OperationPrefixCode::IDIV:
+            case OperationPrefixCode::IREM:
+            case OperationPrefixCode::IAND:
+            case OperationPrefixCode::IOR:
+            case OperationPrefixCode::IXOR:
+            case OperationPrefixCode::ISHL:
+            case OperationPrefixCode::ISHR:
+            case OperationPrefixCode::ITOD:
+            case OperationPrefixCode::DTOI:
+                if (last)
+                    result.pure = false;
+                else
+                    flow(index + 1, mask);
+                break;
+            case OperationPrefixCode::PUSH_REG_VAL:
+                if (!(mask & bit))
+                    result.exposed |= bit;
+                if (last)
+                    result.pure = false;
+                else
+                    flow(index + 1, mask);
+                break;
+            case OperationPrefixCode::POP_REG_VAL:
+                result.mayWrite |= bit;
+                if (last)
+                    result.pure = false;
+                else
+                    flow(index + 1, mask | bit);
+                break;
+            case OperationPrefixCode::RET_ABS:
+                result.mustWrite &= mask;
+                break;
+            case OperationPrefixCode::JMP_OFFSET_EXACT_VAL:
+                result.loops = result.loops || instruction.arg <= index;
+                flow(instruction.arg, mask);
+                break;
+            case OperationPrefixCode::JE_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::JNE_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::JA_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::JAE_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::JB_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::JBE_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::IJE_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::IJNE_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::IJA_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::IJAE_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::IJB_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::IJBE_OFFSET_EXACT_VAL:
+                result.loops = result.loops || instruction.arg <= index;
+                flow(instruction.arg, mask);
+                if (last)
+                    result.pure = false;
+                else
+                    flow(index + 1, mask);
+                break;
+            case OperationPrefixCode::CALL_OFFSET_EXACT_VAL: {
+                int callee = factsByEntry[instruction.arg];
+                if (callee < 0 || !facts[callee].pure || last) {
+                    result.pure = false;
+                    break;
+                }
+                result.loops = true;
+                result.exposed |= facts[callee].exposed & ~mask;
+                result.mayWrite |= facts[callee].mayWrite;
+                flow(index + 1, mask | facts[callee].mustWrite);
+                break;
+            }
+            default:
+                //in, out, RAM, frame slots, halt and traps
+                result.pure = false;
+        }
+    }
+    return result;
+}
+
+//Deepest data stack above the arguments and call stack entries a function may take, see MemoFunction.
+//-1 if functions that are not memoized call each other recursively
+struct FrameBound {
+    int peak;
+    int calls;
+};
+
+static FrameBound measureFunction(const std::vector<DecodedInstruction> &code, int function,
+                                  const std::vector<FunctionSummary> &summaries, const std::vector<int> &summaryByEntry,
+                                  const std::vector<bool> &memoized, std::vector<FrameBound> &bounds,
+                                  std::vector<char> &measured) {
+    static constexpr char MEASURING = 1;
+    static constexpr char DONE = 2;
+    const FrameBound unbounded = {-1, -1};
+    if (measured[function] == DONE)
+        return bounds[function];
+    if (measured[function] == MEASURING)
+        return unbounded;
+    measured[function] = MEASURING;
+
+    const FunctionSummary &summary = summaries[function];
+    FrameBound result = {summary.required, 1};
+    std::unordered_map<int, int> depths;
+    std::vector<int> worklist;
+    bool consistent = true;
+    auto flow = [&](int target, int depth) {
+        auto inserted = depths.insert({target, depth});
+        if (inserted.second)
+            worklist.push_back(target);
+        else if (inserted.first->second != depth)
+            consistent = false;
+    };
+
+    flow(summary.entry, summary.required);
+    while (!worklist.empty() && consistent && result.peak >= 0) {
+        int index = worklist.back();
+        worklist.pop_back();
+        const DecodedInstruction &instruction = code[index];
+        int depth = depths[index];
+        result.peak = std::max(result.peak, depth);
+
+        if (instruction.opcode == OperationPrefixCode::RET_ABS)
+            continue;
+        if (instruction.opcode == OperationPrefixCode::JMP_OFFSET_EXACT_VAL) {
+            flow(instruction.arg, depth);
+            continue;
+        }
+        if (instruction.opcode == OperationPrefixCode::CALL_OFFSET_EXACT_VAL) {
+            int callee = summaryByEntry[instruction.arg];
+            if (!memoized[callee]) {
+                FrameBound bound = measureFunction(code, callee, summaries, summaryByEntry, memoized, bounds, measured);
+                if (bound.peak < 0) {
+                    result = unbounded;
+                    break;
+                }
+                result.peak = std::max(result.peak, depth - summaries[callee].required + bound.peak);
+                result.calls = std::max(result.calls, 1 + bound.calls);
+            }
+            flow(index + 1, depth + summaries[callee].effect);
+            continue;
+        }
+
+        //Pure functions hold nothing else that leaves the function
+        int needed, pushed;
+        Verifier::getStackEffect(instruction.opcode, needed, pushed);
+        int next = depth - needed + pushed;
+        if (Decoder::isConditionalJump(instruction.opcode))
+            flow(instruction.arg, next);
+        flow(index + 1, next);
+    }
+    //Code shared with a caller at another depth is not worth following
+    if (!consistent)
+        result = unbounded;
+
+    measured[function] = DONE;
+    bounds[function] = result;
+    return result;
+}
+
+static int countRegisters(unsigned char registers) {
+    int count = 0;
+    for (int reg = 0; reg < 4; reg++)
+        count += (registers >> reg) & 1;
+    return count;
+}
+
+Memoizer::Memoizer(DecodedProgram &program, const std::vector<FunctionSummary> &summaries):
+    _functionByEntry(program.instructions.size(), -1), _slots(new Slot[CACHE_SLOTS]), _evictions(0) {
+    for (int i = 0; i < CACHE_SLOTS; i++)
+        _slots[i].function = -1;
+
+    std::vector<DecodedInstruction> &code = program.instructions;
+    int size = code.size();
+
+    //Optimistic start, repeated until recursive functions settle
+    std::vector<int> factsByEntry(size, -1);
+    std::vector<RegisterFacts> facts;
+    for (const FunctionSummary &summary : summaries) {
+        factsByEntry[summary.entry] = facts.size();
+        facts.push_back(RegisterFacts{true, false, 0, 0xf, 0});
+    }
+    for (bool changed = true; changed;) {
+        changed = false;
+        for (size_t i = 0; i < summaries.size(); i++) {
+            RegisterFacts next = analyzeFunction(code, summaries[i].entry, factsByEntry, facts);
+            if (next != facts[i]) {
+                facts[i] = next;
+                changed = true;
+            }
+        }
+    }
+
+    std::vector<bool> memoized(summaries.size(), false);
+    for (size_t i = 0; i < summaries.size(); i++) {
+        const FunctionSummary &summary = summaries[i];
+        const RegisterFacts &fact = facts[i];
+        int results = summary.required + summary.effect;
+        memoized[i] = summary.entry != 0 && summary.returns && fact.pure && fact.loops && results >= 0 &&
+                      summary.required + countRegisters(fact.exposed) <= MAX_KEY &&
+                      results + countRegisters(fact.mayWrite) <= MAX_VALUE;
+    }
+
+    //A function whose depth has no bound cannot tell whether a hit fits, dropping it lets its callers
+    //count it in their own bound instead
+    std::vector<FrameBound> bounds(summaries.size());
+    for (bool dropped = true; dropped;) {
+        dropped = false;
+        std::vector<char> measured(summaries.size(), 0);
+        for (size_t i = 0; i < summaries.size(); i++) {
+            if (memoized[i] && measureFunction(code, i, summaries, factsByEntry, memoized, bounds, measured).peak < 0) {
+                memoized[i] = false;
+                dropped = true;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < summaries.size(); i++) {
+        if (!memoized[i])
+            continue;
+        const FunctionSummary &summary = summaries[i];
+        const RegisterFacts &fact = facts[i];
+        _functionByEntry[summary.entry] = _functions.size();
+        _functions.push_back(MemoFunction{summary.entry, program.offsets[summary.entry], summary.required,
+                                          summary.required + summary.effect, bounds[i].peak, bounds[i].calls,
+                                          fact.exposed, fact.mayWrite, 0, 0, false});
+    }
+
+    for (int i = 0; i < size; i++) {
+        if (code[i].opcode != OperationPrefixCode::CALL_OFFSET_EXACT_VAL || _functionByEntry[code[i].arg] < 0)
+            continue;
+        DecodedInstruction memoReturn = DecodedInstruction();
+        memoReturn.opcode = InternalOperationCode::MEMO_RETURN;
+        memoReturn.arg = i + 1;
+        code[i].opcode = InternalOperationCode::CALL_MEMO;
+        code[i].val = code.size();
+        code.push_back(memoReturn);
+        program.offsets.push_back(-1);
+    }
+}
+
+int Memoizer::buildKey(const MemoFunction &function, const double *sp, const DoubleUll *reg,
+                       unsigned long long *key) const {
+    std::memcpy(key, sp - function.required, function.required * sizeof (double));
+    int length = function.required;
+    for (int i = 0; i < 4; i++) {
+        if (function.readRegisters & (1 << i))
+            key[length++] = reg[i].ull_val;
+    }
+    return length;
+}
+
+int Memoizer::hash(int function, const unsigned long long *key, int length) {
+    unsigned long long hash = (function + 1) * 0x9e3779b97f4a7c15ull;
+    for (int i = 0; i < length; i++) {
+        hash ^= key[i];
+        hash *= 0xff51afd7ed558ccdull;
+        hash ^= hash >> 33;
+    }
+    //Keys of small integers differ only in their high bits, the high bits of a product depend on all of them
+    return (hash * 0x9e3779b97f4a7c15ull) >> (64 - CACHE_BITS);
+}
+
+void Memoizer::observe(int peak, int calls) {
+    if (_pending.empty())
+        return;
+    Pending &pending = _pending.back();
+    pending.peak = std::max(pending.peak, peak);
+    pending.calls = std::max(pending.calls, calls);
+}
+
+MemoLookup Memoizer::lookup(int entry, double *&sp, const double *base, const double *limit, int callDepth,
+                            int callCapacity, DoubleUll *reg) {
+    int id = _functionByEntry[entry];
+    MemoFunction &function = _functions[id];
+    int arguments = sp - base - function.required;
+    if (function.disabled || arguments < 0) {
+        observe(arguments + function.peak, callDepth + function.calls);
+        return MemoLookup::MEMO_CALL;
+    }
+
+    unsigned long long key[MAX_KEY];
+    int length = buildKey(function, sp, reg, key);
+    int slot = hash(id, key, length);
+    function.lookups++;
+
+    const Slot &cached = _slots[slot];
+    if (cached.function == id && std::equal(key, key + length, cached.key)) {
+        //A call that overflows a stack has to fail the same way, so it runs
+        if (arguments + cached.peak > limit - base || callDepth + cached.calls > callCapacity) {
+            observe(arguments + function.peak, callDepth + function.calls);
+            return MemoLookup::MEMO_CALL;
+        }
+        observe(arguments + cached.peak, callDepth + cached.calls);
+        function.hits++;
+        double *results = sp - function.required;
+        std::memcpy(results, cached.value, function.results * sizeof (double));
+        sp = results + function.results;
+        int value = function.results;
+        for (int i = 0; i < 4; i++) {
+            int bit = 1 << i;
+            if (!(function.writtenRegisters & bit))
+                continue;
+            if (!(cached.keptRegisters & bit))
+                reg[i].ull_val = cached.value[value];
+            value++;
+        }
+        return MemoLookup::MEMO_HIT;
+    }
+
+    if (function.lookups == SAMPLE_LOOKUPS && function.hits * MIN_HIT_RATIO < function.lookups) {
+        function.disabled = true;
+        observe(arguments + function.peak, callDepth + function.calls);
+        return MemoLookup::MEMO_CALL;
+    }
+
+    _pending.emplace_back();
+    Pending &pending = _pending.back();
+    pending.function = id;
+    pending.slot = slot;
+    pending.arguments = arguments;
+    pending.callDepth = callDepth;
+    pending.peak = arguments + function.peak;
+    pending.calls = callDepth + function.calls;
+    std::copy(key, key + length, pending.key);
+    for (int i = 0; i < 4; i++) {
+        int bit = 1 << i;
+        if ((function.writtenRegisters & bit) && !(function.readRegisters & bit)) {
+            pending.entryRegisters[i] = reg[i].ull_val;
+            reg[i].ull_val = UNWRITTEN_REGISTER;
+        }
+    }
+    return MemoLookup::MEMO_RECORD;
+}
+
+void Memoizer::record(const double *sp, DoubleUll *reg) {
+    const Pending &pending = _pending.back();
+    const MemoFunction &function = _functions[pending.function];
+    Slot &slot = _slots[pending.slot];
+    if (slot.function >= 0)
+        _evictions++;
+
+    slot.function = pending.function;
+    slot.peak = pending.peak - pending.arguments;
+    slot.calls = pending.calls - pending.callDepth;
+    std::copy(pending.key, pending.key + MAX_KEY, slot.key);
+    std::memcpy(slot.value, sp - function.results, function.results * sizeof (double));
+    slot.keptRegisters = 0;
+    int value = function.results;
+    for (int i = 0; i < 4; i++) {
+        int bit = 1 << i;
+        if (!(function.writtenRegisters & bit))
+            continue;
+        if (!(function.readRegisters & bit) && reg[i].ull_val == UNWRITTEN_REGISTER) {
+            slot.keptRegisters |= bit;
+            reg[i].ull_val = pending.entryRegisters[i];
+        } else {
+            slot.value[value] = reg[i].ull_val;
+        }
+        value++;
+    }
+    int peak = pending.peak;
+    int calls = pending.calls;
+    _pending.pop_back();
+    observe(peak, calls);
+}
+
+void Memoizer::reset() {
+    _pending.clear();
+}
+
+const std::vector<MemoFunction> &Memoizer::getFunctions() const {
+    return _functions;
+}
+
+long long Memoizer::getEvictions() const {
+    return _evictions;
+}
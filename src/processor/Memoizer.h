@@ -0,0 +1,103 @@
+#ifndef STACK_PROCESSOR_MEMOIZER_H
+#define STACK_PROCESSOR_MEMOIZER_H
+#include "../utils.h"
+#include "Decoder.h"
+#include "Verifier.h"
+#include <memory>
+#include <vector>
+
+//Function whose calls are answered from the cache. Its key is the stack values it reads
+//and the registers it reads before writing them, its result is the stack values it leaves
+//in their place and the registers it may write
+struct MemoFunction {
+    int entry;
+    int offset; //Bytecode offset of the entry
+    int required;
+    int results;
+    //Data stack depth above its arguments and call stack entries its own code and the functions it calls
+    //without a lookup may take. Memoized callees are measured as they run
+    int peak;
+    int calls;
+    unsigned char readRegisters;
+    unsigned char writtenRegisters;
+    long long lookups;
+    long long hits;
+    bool disabled; //Hit rate was too low to pay for the lookups
+};
+
+enum MemoLookup {
+    MEMO_CALL = 0, //Call normally
+    MEMO_RECORD, //Call and return through MEMO_RETURN so the result gets cached
+    MEMO_HIT //Result is on the stack, skip the call
+};
+
+//Finds pure functions of a verified program: no in, out, RAM access, frame slot or halt
+//anywhere in them or their callees. Only functions that loop or call are memoized,
+//straight-line ones are cheaper to run than to look up.
+class Memoizer {
+private:
+    static constexpr int MAX_KEY = 8;
+    static constexpr int MAX_VALUE = 8;
+    static constexpr int CACHE_BITS = 14;
+    static constexpr int CACHE_SLOTS = 1 << CACHE_BITS;
+    //Functions hitting less than one lookup in MIN_HIT_RATIO after SAMPLE_LOOKUPS are disabled
+    static constexpr int SAMPLE_LOOKUPS = 4096;
+    static constexpr int MIN_HIT_RATIO = 16;
+
+    struct Slot {
+        int function;
+        //Deepest data stack above the arguments and call stack above the caller the recorded call reached
+        int peak;
+        int calls;
+        unsigned char keptRegisters; //Written registers the call left unchanged
+        unsigned long long key[MAX_KEY];
+        unsigned long long value[MAX_VALUE];
+    };
+
+    struct Pending {
+        int function;
+        int slot;
+        //Depths when the call was made and the deepest ones reached since, counted from the bottom
+        int arguments;
+        int callDepth;
+        int peak;
+        int calls;
+        unsigned long long key[MAX_KEY];
+        unsigned long long entryRegisters[4];
+    };
+
+    std::vector<MemoFunction> _functions;
+    std::vector<int> _functionByEntry;
+    std::unique_ptr<Slot[]> _slots;
+    std::vector<Pending> _pending;
+    long long _evictions;
+
+    //Every call made while recording may take the recorded call deeper
+    void observe(int peak, int calls);
+
+    int buildKey(const MemoFunction &function, const double *sp, const DoubleUll *reg,
+                 unsigned long long *key) const;
+
+    static int hash(int function, const unsigned long long *key, int length);
+
+public:
+    //Rewrites calls of memoized functions into CALL_MEMO and appends a MEMO_RETURN for each
+    explicit Memoizer(DecodedProgram &program, const std::vector<FunctionSummary> &summaries);
+
+    //Hits need room for everything the call they replace would have pushed, callDepth is the call stack
+    //size before the call
+    MemoLookup lookup(int entry, double *&sp, const double *base, const double *limit, int callDepth,
+                      int callCapacity, DoubleUll *reg);
+
+    //Caches the result of the innermost call that got MEMO_RECORD, sp is right after its return
+    void record(const double *sp, DoubleUll *reg);
+
+    //Forgets calls that were running when execution stopped
+    void reset();
+
+    const std::vector<MemoFunction> &getFunctions() const;
+
+    long long getEvictions() const;
+};
+
+#endif //STACK_PROCESSOR_MEMOIZER_H
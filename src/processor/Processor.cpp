@@ -3,313 +3,361 @@
 //
 
 #include "Processor.h"
+#include "Fusion.h"
+#include "Verifier.h"
+#include <algorithm>
 #include <cassert>
 #include <cstring>
-#include <cmath>
+#include <cstdint>
 #include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <sys/mman.h>
+
+RAM::RAM(int size, bool hugePages): _size(size), _dirty_pages((size / PAGE_SIZE + 1 + 63) / 64, 0),
+    _all_dirty(false) {
+    assert(size >= static_cast<int>(sizeof (double)));
+
+    //Transparent huge pages need 2 MB alignment, the mapping is padded to find an aligned start
+    size_t alignment = hugePages ? 2u << 20 : PAGE_SIZE;
+    size_t length = (static_cast<size_t>(size) + alignment - 1) / alignment * alignment;
+    _mappingSize = length + alignment - PAGE_SIZE;
+    void *mapping = mmap(nullptr, _mappingSize, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (mapping == MAP_FAILED)
+        throw std::bad_alloc();
+    _mapping = static_cast<char*>(mapping);
+    uintptr_t start = (reinterpret_cast<uintptr_t>(_mapping) + alignment - 1) / alignment * alignment;
+    _memory = reinterpret_cast<char*>(start);
+#ifdef MADV_HUGEPAGE
+    if (hugePages)
+        madvise(_memory, length, MADV_HUGEPAGE);
+#endif
+}
 
-void RAM::store(double val, int address) {
-    assert(address >= 0 && address < MEM_SIZE);
-
-    DoubleChars buf;
-    buf.db_val = val;
-    for (int i = 0; i < sizeof (double); i++) {
-        mem[i + address] = buf.chr_val[i];
+long long RAM::parseSize(const char *text) {
+    char *end;
+    long long size = std::strtoll(text, &end, 10);
+    if (end == text || size < 0 || size > std::numeric_limits<int>::max())
+        return -1;
+    switch (*end) {
+        case 'K':
+            size <<= 10;
+            end++;
+            break;
+        case 'M':
+            size <<= 20;
+            end++;
+            break;
+        case 'G':
+            size <<= 30;
+            end++;
+            break;
     }
+    if (*end != '\0' || size > std::numeric_limits<int>::max())
+        return -1;
+    return size;
+}
 
+RAM::~RAM() {
+    munmap(_mapping, _mappingSize);
 }
 
-bool RAM::isValidAddr(int addr) { return addr >= 0 && addr < MEM_SIZE; }
+char *RAM::getMemory() {
+    return _memory;
+}
 
-double RAM::load(int address) {
-    assert(address >= 0 && address < MEM_SIZE);
+void RAM::markRangeDirty(int address, int size) {
+    if (size <= 0)
+        return;
+    for (int page = address / PAGE_SIZE; page <= (address + size - 1) / PAGE_SIZE; page++)
+        _dirty_pages[page / 64] |= 1ull << (page % 64);
+}
 
-    DoubleChars buf;
-    for (int i = 0; i < sizeof (double); i++)
-        buf.chr_val[i] = mem[i + address];
-    return buf.db_val;
+void RAM::reset() {
+    if (_all_dirty) {
+        //Anonymous pages read as zeros again once dropped
+        madvise(_mapping, _mappingSize, MADV_DONTNEED);
+        std::fill(_dirty_pages.begin(), _dirty_pages.end(), 0);
+        _all_dirty = false;
+        return;
+    }
+    for (size_t word = 0; word < _dirty_pages.size(); word++) {
+        for (unsigned long long bits = _dirty_pages[word]; bits != 0; bits &= bits - 1) {
+            size_t page = word * 64 + __builtin_ctzll(bits);
+            std::memset(_memory + page * PAGE_SIZE, 0, PAGE_SIZE);
+        }
+        _dirty_pages[word] = 0;
+    }
 }
 
-bool Processor::isNoArgsOperation(char prefixCode) {
-    return prefixCode >= OperationPrefixCode::IN && prefixCode <= OperationPrefixCode::POP;
+void RAM::markAllDirty() {
+    _all_dirty = true;
 }
 
-bool Processor::isHalt(char prefixCode) {
-    return prefixCode == OperationPrefixCode::HALT;
+double Processor::readInput() {
+    return _io->read();
 }
 
-bool Processor::isJump(char prefixCode) {
-    return (prefixCode >= OperationPrefixCode::JMP_OFFSET_EXACT_VAL && prefixCode <= CALL_OFFSET_EXACT_VAL)
-           || prefixCode == OperationPrefixCode::RET_ABS;
+void Processor::writeOutput(double val) {
+    _io->write(val);
 }
 
-double Processor::getDouble(char *buf) {
-    DoubleChars res;
-    for (int i = 0; i < sizeof (double); i++)
-        res.chr_val[i] = buf[i];
-    return res.db_val;
+ProcessorStatus Processor::executeVectorOperation(unsigned char opcode, double *&sp) {
+    int needed, pushed;
+    VectorOperations::getStackEffect(opcode, needed, pushed);
+    VectorArguments arguments;
+    if (!VectorOperations::decode(opcode, sp - needed, _ram->getSize(), arguments))
+        return ProcessorStatus::INVALID_RAM_ADDRESS;
+    if (arguments.destination >= 0)
+        _ram->markRangeDirty(arguments.destination, arguments.count * sizeof (double));
+    double result = VectorOperations::apply(arguments, _ram->getMemory());
+    sp -= needed;
+    if (pushed > 0)
+        *sp++ = result;
+    return ProcessorStatus::SUCCESS;
 }
 
-int Processor::getInt(char *buf) {
-    IntChars res;
-    for (int i = 0; i < sizeof (int); i++)
-        res.chr_val[i] = buf[i];
-    return res.itn_val;
+Processor::Processor() {
+    StackGuard::install();
+    setDataStackCapacity(DEFAULT_DATA_STACK_CAPACITY);
+    setCallStackCapacity(DEFAULT_CALL_STACK_CAPACITY);
+    _ram.reset(new RAM(RAM::DEFAULT_SIZE, false));
+    _dispatch_mode = DispatchMode::THREADED_DISPATCH;
+    _top_of_stack_caching = true;
+    _verification_enabled = true;
+    _tail_call_elimination_enabled = true;
+    _tail_call_count = 0;
+    _fusion_enabled = true;
+    _tracing_enabled = false;
+    _memoization_enabled = false;
+    _profiling_enabled = false;
+    _jit_enabled = false;
+    _register_machine_enabled = false;
+    _io = &_console;
 }
 
-bool Processor::isCommand(int prefixCode) {
-    return OperationPrefixCode::IN <= prefixCode && prefixCode <= OperationPrefixCode::CALL_OFFSET_EXACT_VAL;
+ProcessorStatus Processor::executeOperations(char *start, int size) {
+    return executeOperations(Executable::fromBytecode(start, size));
 }
 
-int Processor::getCommandLength(char prefixCode) {
-    assert(isCommand(prefixCode));
+ProcessorStatus Processor::executeOperations(const Executable &executable) {
+    Decoder::decode(executable, _program, _ram->getSize());
+    _tail_call_count = _tail_call_elimination_enabled ? Decoder::eliminateTailCalls(_program) : 0;
+    std::vector<FunctionSummary> functions;
+    if (_verification_enabled)
+        _program.verified = Verifier::verify(_program, _verification_diagnostic, functions);
+    else
+        _verification_diagnostic = "verification disabled";
+
+    //Profiles count the instructions of the program as it was written
+    if (_profiling_enabled) {
+        _profiler.reset(new Profiler(_program));
+        _memoizer.reset();
+        _jit_diagnostic = "profiling runs in the interpreter";
+        _register_machine_diagnostic = "profiling runs in the interpreter";
+        _tracer.reset();
+        _fusion_counts.assign(Fusion::getRuleCount(), 0);
+        _profiler->start();
+        ProcessorStatus status = execute(_program);
+        _profiler->stop();
+        return status;
+    }
+    _profiler.reset();
+
+    //Jit expects the unfused program, side exits continue in the fused one
+    bool native = false;
+    if (_jit_enabled) {
+        if (!_jit)
+            _jit.reset(new Jit);
+        native = _jit->compile(_program, _jit_diagnostic);
+    } else {
+        _jit_diagnostic = "jit disabled";
+    }
 
-    if (isNoArgsOperation(prefixCode))
-        return 1;
-    else if (isJump(prefixCode))
-        return 1 + sizeof (int);
-    else {
-        if (prefixCode == OperationPrefixCode::POP_REG_ADDR || prefixCode == OperationPrefixCode::PUSH_REG_VAL ||
-            prefixCode == OperationPrefixCode::PUSH_REG_ADDR || prefixCode == OperationPrefixCode::POP_REG_VAL)
-            return 2;
-        else if (prefixCode == OperationPrefixCode::PUSH_EXACT_ADDR ||
-                 prefixCode == OperationPrefixCode::POP_EXACT_ADDR)
-            return 1 + sizeof (int);
-        else
-            return 1 + sizeof (double);
+    //RegisterMachine translates the unfused program as well
+    bool registers = false;
+    if (_register_machine_enabled && !native) {
+        if (!_register_machine)
+            _register_machine.reset(new RegisterMachine);
+        registers = _register_machine->translate(_program, functions, _register_machine_diagnostic);
+    } else {
+        _register_machine_diagnostic = native ? "native code runs instead" : "register machine disabled";
     }
+
+    //Calls are rewritten before tracing and fusion see the program, native and register code do not use them
+    if (_memoization_enabled && _program.verified && !native && !registers)
+        _memoizer.reset(new Memoizer(_program, functions));
+    else
+        _memoizer.reset();
+
+    //Tracer keeps the unfused program to build traces from
+    if (_tracing_enabled)
+        _tracer.reset(new Tracer(_program, _fusion_enabled));
+    else
+        _tracer.reset();
+
+    if (_fusion_enabled)
+        Fusion::fuse(_program, _fusion_counts);
+    else
+        _fusion_counts.assign(Fusion::getRuleCount(), 0);
+    if (native) {
+        reset();
+        ProcessorStatus status = _jit->run(*this);
+        //Native code stores to RAM directly
+        _ram->markAllDirty();
+        _io->flush();
+        return status;
+    }
+    if (registers) {
+        reset();
+        ProcessorStatus status = _register_machine->run(*this);
+        _io->flush();
+        return status;
+    }
+    return execute(_program);
 }
 
-ProcessorStatus Processor::executeJumpOperation(char prefixCode) {
-    assert(isJump(prefixCode));
-    assert(prefixCode != OperationPrefixCode::HALT);
+void Processor::reset() {
+    std::memset(_reg, 0, sizeof (_reg));
+    _data_stack_top = _data_stack_base;
+    _call_stack.clear();
+    _frame_pointer = 0;
+    _frame_stack.clear();
+    _ram->reset();
+    if (_memoizer)
+        _memoizer->reset();
+}
 
-    if (prefixCode == OperationPrefixCode::RET_ABS) {
-        if (_call_stack.empty())
-            return ProcessorStatus::CALL_STACK_UNDERFLOW;
-        _ip = _call_stack.back();
-        _call_stack.pop_back();
-        return ProcessorStatus::SUCCESS;
-    }
+ProcessorStatus Processor::executeRecord(const DecodedProgram &program, const double *input, int inputSize,
+                                         double *output, int outputSize, int &outputCount) {
+    reset();
 
-    if (_ip + sizeof (int) >= _start + _operations_size)
-        return ProcessorStatus::COMMAND_ARG_ERROR;
+    _record_channel.setInput(input, inputSize);
+    _record_channel.setOutput(output, outputSize);
+    IoChannel *channel = _io;
+    _io = &_record_channel;
 
-    int offset = getInt(_ip + 1);
+    ProcessorStatus status = resume(program, 0);
 
-    if (prefixCode == OperationPrefixCode::CALL_OFFSET_EXACT_VAL) {
-        _call_stack.push_back(_ip + getCommandLength(prefixCode));
-        _ip += offset;
-    } else if (prefixCode == OperationPrefixCode::JMP_OFFSET_EXACT_VAL) {
-        _ip += offset;
-    } else {
-        if (_data_stack.size() < 2)
-            return ProcessorStatus::DATA_STACK_UNDERFLOW;
-        double left = _data_stack[_data_stack.size() - 2], right = _data_stack.back();
-        bool condition = false;
-        switch (prefixCode) {
-            case OperationPrefixCode::JE_OFFSET_EXACT_VAL:
-                if (std::fabs(right - left) < PROCESSOR_EPSILON)
-                    condition = true;
-                break;
-            case OperationPrefixCode::JNE_OFFSET_EXACT_VAL:
-                if (std::fabs(right - left) >= PROCESSOR_EPSILON)
-                    condition = true;
-                break;
-            case OperationPrefixCode::JA_OFFSET_EXACT_VAL:
-                if (left > right + PROCESSOR_EPSILON)
-                    condition = true;
-                break;
-            case OperationPrefixCode::JAE_OFFSET_EXACT_VAL:
-                if (left > right + PROCESSOR_EPSILON || fabs(right - left) < PROCESSOR_EPSILON)
-                    condition = true;
-                break;
-            case OperationPrefixCode::JB_OFFSET_EXACT_VAL:
-                if (left + PROCESSOR_EPSILON < right)
-                    condition = true;
-                break;
-            case OperationPrefixCode::JBE_OFFSET_EXACT_VAL:
-                if (left + PROCESSOR_EPSILON < right || fabs(right - left) < PROCESSOR_EPSILON)
-                    condition = true;
-                break;
-        }
-        if (condition)
-            _ip += offset;
-        else
-            _ip += getCommandLength(prefixCode);
-    }
+    outputCount = _record_channel.getOutputCount();
+    _io = channel;
+    return status;
+}
 
-    if (_ip < _start || _ip >= _start + _operations_size)
-        return ProcessorStatus::INVALID_INSTRUCTION_POINTER;
-    return ProcessorStatus::SUCCESS;
+void Processor::setIoChannel(IoChannel *channel) {
+    _io = channel != nullptr ? channel : &_console;
 }
 
-ProcessorStatus Processor::executeNoArgsNonJump(char prefixCode) {
-    assert(isNoArgsOperation(prefixCode) && !isJump(prefixCode));
-    assert(prefixCode != OperationPrefixCode::HALT);
-    assert(prefixCode != OperationPrefixCode::RET_ABS);
-
-    if (prefixCode == OperationPrefixCode::IN) {
-        double val = 0.0;
-        std::printf("in: ");
-        std::scanf("%lg", &val);
-        _data_stack.push_back(val);
-    } else if (prefixCode == OperationPrefixCode::OUT) {
-        if (_data_stack.empty())
-            return ProcessorStatus::DATA_STACK_UNDERFLOW;
-        double val = _data_stack.back();
-        _data_stack.pop_back();
-        std::printf("out: %lg\n", val);
-    } else if (OperationPrefixCode::ADD <= prefixCode && prefixCode <= OperationPrefixCode::DIV) {
-        if (_data_stack.size() < 2)
-            return ProcessorStatus::DATA_STACK_UNDERFLOW;
-        double left = _data_stack[_data_stack.size() - 2], right = _data_stack.back();
-        _data_stack.pop_back();
-        _data_stack.pop_back();
-        switch (prefixCode) {
-            case OperationPrefixCode::ADD: _data_stack.push_back(left + right); break;
-            case OperationPrefixCode::SUB: _data_stack.push_back(left - right); break;
-            case OperationPrefixCode::MUL: _data_stack.push_back(left * right); break;
-            case OperationPrefixCode::DIV: _data_stack.push_back(left / right); break;
-        }
-    } else {
-        if (_data_stack.empty())
-            return ProcessorStatus::DATA_STACK_UNDERFLOW;
-        double val = _data_stack.back();
-        _data_stack.pop_back();
-        switch (prefixCode) {
-            case OperationPrefixCode::SIN: _data_stack.push_back(std::sin(val)); break;
-            case OperationPrefixCode::COS: _data_stack.push_back(std::cos(val)); break;
-            case OperationPrefixCode::SQRT: _data_stack.push_back(std::sqrt(val)); break;
-        }
-    }
+IoChannel *Processor::getIoChannel() const {
+    return _io;
+}
 
-    _ip += getCommandLength(prefixCode);
-    return ProcessorStatus::SUCCESS;
+void Processor::setDispatchMode(DispatchMode mode) {
+    _dispatch_mode = mode;
 }
 
-ProcessorStatus Processor::executeRegArg(char prefixCode) {
-    if (_ip + 2 > _start + _operations_size)
-        return ProcessorStatus::COMMAND_ARG_ERROR;
-
-    char regCode = _ip[1];
-    double val;
-    int addr;
-    switch (prefixCode) {
-        case OperationPrefixCode::POP_REG_VAL:
-            if (_data_stack.empty())
-                return ProcessorStatus::DATA_STACK_UNDERFLOW;
-            val = _data_stack.back();
-            _data_stack.pop_back();
-            _reg[regCode].db_val = val;
-            break;
-        case OperationPrefixCode::PUSH_REG_VAL:
-            val = _reg[regCode].db_val;
-            _data_stack.push_back(val);
-            break;
-        case OperationPrefixCode::PUSH_REG_ADDR:
-            addr = _reg[regCode].ull_val;
-            if (!RAM::isValidAddr(addr))
-                return ProcessorStatus::INVALID_RAM_ADDRESS;
-            val = _ram->load(addr);
-            _data_stack.push_back(val);
-            break;
-        case OperationPrefixCode::POP_REG_ADDR:
-            if (_data_stack.empty())
-                return ProcessorStatus::DATA_STACK_UNDERFLOW;
-            addr = _reg[regCode].ull_val;
-            if (!RAM::isValidAddr(addr))
-                return ProcessorStatus::INVALID_RAM_ADDRESS;
-            val = _data_stack.back();
-            _data_stack.pop_back();
-            _ram->store(val, addr);
-    }
-    _ip += 2;
-    return ProcessorStatus::SUCCESS;
+DispatchMode Processor::getDispatchMode() const {
+    return _dispatch_mode;
 }
 
-ProcessorStatus Processor::executeExactAddr(char prefixCode) {
-    if (_ip + 1 + sizeof (int) > _start + _operations_size)
-        return ProcessorStatus::COMMAND_ARG_ERROR;
+void Processor::setTopOfStackCaching(bool enabled) {
+    _top_of_stack_caching = enabled;
+}
 
-    int addr = getInt(_ip + 1);
-    if (!RAM::isValidAddr(addr))
-        return ProcessorStatus::INVALID_RAM_ADDRESS;
+void Processor::setDataStackCapacity(int capacity) {
+    assert(capacity > 0);
 
-    if (prefixCode == OperationPrefixCode::PUSH_EXACT_ADDR) {
-        double val = _ram->load(addr);
-        _data_stack.push_back(val);
-    } else if (prefixCode == OperationPrefixCode::POP_EXACT_ADDR) {
-        if (_data_stack.empty())
-            return ProcessorStatus::DATA_STACK_UNDERFLOW;
-        double val = _data_stack.back();
-        _data_stack.pop_back();
-        _ram->store(val, addr);
-    }
+    //One spare slot below the base, the guard page starts right after capacity values, see ExecutionLoop.cpp
+    _data_stack_region.allocate((capacity + 1) * sizeof (double));
+    _data_stack_base = reinterpret_cast<double*>(_data_stack_region.getStart()) + 1;
+    _data_stack_top = _data_stack_base;
+    _data_stack_capacity = capacity;
+    _frame_pointer = 0;
+}
 
-    _ip += 1 + sizeof (int);
-    return ProcessorStatus::SUCCESS;
+void Processor::setRamSize(int size, bool hugePages) {
+    _ram.reset(new RAM(size, hugePages));
 }
 
-ProcessorStatus Processor::executeUnaryNonJump(char prefixCode) {
-    assert(isCommand(prefixCode) && !isJump(prefixCode) && !isNoArgsOperation(prefixCode));
+int Processor::getRamSize() const {
+    return _ram->getSize();
+}
 
-    if (prefixCode == OperationPrefixCode::POP_REG_VAL || prefixCode == OperationPrefixCode::PUSH_REG_VAL ||
-        prefixCode == OperationPrefixCode::PUSH_REG_ADDR || prefixCode == OperationPrefixCode::POP_REG_ADDR) {
-        return executeRegArg(prefixCode);
-    } else if (prefixCode == OperationPrefixCode::POP_EXACT_ADDR ||
-               prefixCode == OperationPrefixCode::PUSH_EXACT_ADDR) {
-        return executeExactAddr(prefixCode);
-    } else if (prefixCode == OperationPrefixCode::PUSH_EXACT_VAL) {
-        if (_ip + 1 + sizeof (double) > _start + _operations_size)
-            return ProcessorStatus::COMMAND_ARG_ERROR;
+void Processor::setCallStackCapacity(int capacity) {
+    assert(capacity > 0);
+    _call_stack.setCapacity(capacity);
+    _frame_stack.setCapacity(capacity);
+    _frame_pointer = 0;
+}
 
-        double val = getDouble(_ip + 1);
-        _data_stack.push_back(val);
-        _ip += 1 + sizeof (double);
-        return ProcessorStatus::SUCCESS;
-    }
+void Processor::setVerificationEnabled(bool enabled) {
+    _verification_enabled = enabled;
+}
 
-    return ProcessorStatus::UNRECOGNIZED_COMMAND;
+const std::string &Processor::getVerificationDiagnostic() const {
+    return _verification_diagnostic;
 }
 
-Processor::Processor() {
-    _call_stack.reserve(1000);
-    _data_stack.reserve(1000);
-    _ram.reset(new RAM);
+void Processor::setTailCallEliminationEnabled(bool enabled) {
+    _tail_call_elimination_enabled = enabled;
 }
 
-ProcessorStatus Processor::executeOperations(char *start, int size) {
-    std::memset(_reg, 0, sizeof(double) * 4);
-    _start = _ip = start;
-    _operations_size = size;
-
-    while (_ip >= _start && _ip < _start + _operations_size) {
-        char prefixCode = _ip[0];
-
-        if (!isCommand(prefixCode))
-            return ProcessorStatus::UNRECOGNIZED_COMMAND;
-
-        if (isHalt(prefixCode))
-            return ProcessorStatus::SUCCESS;
-
-        if (isJump(prefixCode)) {
-            ProcessorStatus status = executeJumpOperation(prefixCode);
-            if (status != ProcessorStatus::SUCCESS)
-                return status;
-        } else if (isNoArgsOperation(prefixCode)) {
-            ProcessorStatus status = executeNoArgsNonJump(prefixCode);
-            if (status != ProcessorStatus::SUCCESS)
-                return status;
-        } else {
-            ProcessorStatus status = executeUnaryNonJump(prefixCode);
-            if (status != ProcessorStatus::SUCCESS)
-                return status;
-        }
+int Processor::getTailCallCount() const {
+    return _tail_call_count;
+}
 
-    }
+void Processor::setFusionEnabled(bool enabled) {
+    _fusion_enabled = enabled;
+}
 
-    return ProcessorStatus::SUCCESS;
+const std::vector<int> &Processor::getFusionCounts() const {
+    return _fusion_counts;
+}
+
+void Processor::setTracingEnabled(bool enabled) {
+    _tracing_enabled = enabled;
+}
+
+const Tracer *Processor::getTracer() const {
+    return _tracer.get();
+}
+
+void Processor::setMemoizationEnabled(bool enabled) {
+    _memoization_enabled = enabled;
+}
+
+const Memoizer *Processor::getMemoizer() const {
+    return _memoizer.get();
+}
+
+void Processor::setProfilingEnabled(bool enabled) {
+    _profiling_enabled = enabled;
+}
+
+const Profiler *Processor::getProfiler() const {
+    return _profiler.get();
+}
+
+void Processor::setJitEnabled(bool enabled) {
+    _jit_enabled = enabled;
+}
+
+const std::string &Processor::getJitDiagnostic() const {
+    return _jit_diagnostic;
+}
+
+void Processor::setRegisterMachineEnabled(bool enabled) {
+    _register_machine_enabled = enabled;
+}
+
+const std::string &Processor::getRegisterMachineDiagnostic() const {
+    return _register_machine_diagnostic;
+}
+
+const RegisterMachine *Processor::getRegisterMachine() const {
+    return _register_machine_diagnostic.empty() ? _register_machine.get() : nullptr;
 }
 
 std::string Processor::statusToStr(ProcessorStatus status) {
@@ -328,6 +376,14 @@ std::string Processor::statusToStr(ProcessorStatus status) {
             return "invalid instruction pointer";
         case ProcessorStatus::CALL_STACK_UNDERFLOW:
             return "call stack underflow";
+        case ProcessorStatus::DATA_STACK_OVERFLOW:
+            return "data stack overflow";
+        case ProcessorStatus::CALL_STACK_OVERFLOW:
+            return "call stack overflow";
+        case ProcessorStatus::INVALID_FRAME_SLOT:
+            return "invalid frame slot";
+        case ProcessorStatus::INTEGER_DIVISION_BY_ZERO:
+            return "integer division by zero";
         default:
             return "";
     }
@@ -5,68 +5,276 @@
 #ifndef STACK_PROCESSOR_PROCESSOR_H
 #define STACK_PROCESSOR_PROCESSOR_H
 #include "../utils.h"
+#include "Decoder.h"
+#include "GuardedStack.h"
+#include "IoChannel.h"
+#include "Jit.h"
+#include "Memoizer.h"
+#include "Profiler.h"
+#include "RegisterMachine.h"
+#include "Tracer.h"
+#include "VectorOperations.h"
+#include <cstring>
 #include <vector>
 #include <memory>
 #include <string>
 
+//Byte-addressed memory of doubles, reserved as address space up front and committed by the
+//system page by page as it is touched, so a large RAM costs only what a program writes
 class RAM {
 public:
-    static constexpr int MEM_SIZE = 1024 * 50;
-    static bool isValidAddr(int addr);
+    static constexpr int DEFAULT_SIZE = 1024 * 50;
+    static constexpr int PAGE_SIZE = 4096;
+
+    //Byte count of --ram-size with an optional K, M or G suffix, -1 if it is not one or does not
+    //fit in an int
+    static long long parseSize(const char *text);
+
+    //A double at addr lies entirely inside RAM of size bytes
+    static bool isValidAddr(long long addr, int size) {
+        return addr >= 0 && addr <= static_cast<long long>(size) - static_cast<long long>(sizeof (double));
+    }
+
 private:
-    char mem[MEM_SIZE];
+    char *_mapping;
+    size_t _mappingSize;
+    char *_memory;
+    int _size;
+    //Bit i of word w is set once page w * 64 + i may hold something other than zeros
+    std::vector<unsigned long long> _dirty_pages;
+    bool _all_dirty;
+
+    void markDirty(int address) {
+        int page = address / PAGE_SIZE;
+        _dirty_pages[page / 64] |= 1ull << (page % 64);
+    }
+
 public:
-    void store(double val, int address);
+    //Throws std::bad_alloc if the address space cannot be reserved. Huge pages are only a hint
+    explicit RAM(int size = DEFAULT_SIZE, bool hugePages = false);
+
+    RAM(const RAM &) = delete;
+
+    RAM &operator=(const RAM &) = delete;
+
+    ~RAM();
+
+    int getSize() const {
+        return _size;
+    }
+
+    bool isValidAddr(long long addr) const {
+        return isValidAddr(addr, _size);
+    }
+
+    //Address needs to be valid
+    void store(double val, int address) {
+        markDirty(address);
+        markDirty(address + sizeof (double) - 1);
+        std::memcpy(_memory + address, &val, sizeof (double));
+    }
+
+    //Address needs to be valid
+    double load(int address) const {
+        double val;
+        std::memcpy(&val, _memory + address, sizeof (double));
+        return val;
+    }
+
+    char *getMemory();
+
+    //For writes of size bytes at address that bypass store, the range needs to be valid
+    void markRangeDirty(int address, int size);
 
-    double load(int address);
+    //Zeroes the pages written since the last reset
+    void reset();
+
+    //For writes that bypass store, the next reset gives all of the memory back to the system
+    void markAllDirty();
+};
+
+enum DispatchMode {
+    SWITCH_DISPATCH = 0, //One switch shared by all instructions
+    THREADED_DISPATCH //Every handler jumps straight to the next one, falls back to switch without GNU extensions
 };
 
 class Processor {
 private:
-    char *_ip;
-    char *_start;
+    friend class Jit;
+    friend class RegisterMachine;
+
     DoubleUll _reg[4];
-    int _operations_size;
 
     std::unique_ptr<RAM> _ram;
 
-    std::vector<double> _data_stack;
-    std::vector<char *> _call_stack;
+    //Flat preallocated data stack, see ExecutionLoop.cpp for the layout
+    GuardedRegion _data_stack_region;
+    double *_data_stack_base;
+    double *_data_stack_top;
+    int _data_stack_capacity;
+
+    //Return indices, a call beyond capacity faults in the guard page, see resume
+    GuardedStack<int> _call_stack;
+
+    //Data stack depth at entry of the running function and of every caller below it. Only
+    //programs with frame slots keep them, the frame stack never gets deeper than the call stack
+    int _frame_pointer;
+    GuardedStack<int> _frame_stack;
+
+    DecodedProgram _program;
 
-    static bool isNoArgsOperation(char prefixCode);
+    DispatchMode _dispatch_mode;
+    bool _top_of_stack_caching;
 
-    static bool isHalt(char prefixCode);
+    bool _verification_enabled;
+    std::string _verification_diagnostic;
 
-    static bool isJump(char prefixCode);
+    bool _tail_call_elimination_enabled;
+    int _tail_call_count;
 
-    //Need to ensure buf contains enough bytes
-    static double getDouble(char *buf);
+    bool _fusion_enabled;
+    std::vector<int> _fusion_counts;
 
-    //Need to ensure buf contains enough bytes
-    static int getInt(char *buf);
+    bool _tracing_enabled;
+    std::unique_ptr<Tracer> _tracer;
 
-    static bool isCommand(int prefixCode);
+    bool _memoization_enabled;
+    std::unique_ptr<Memoizer> _memoizer;
 
-    //Command length in bytes
-    static int getCommandLength(char prefixCode);
+    bool _profiling_enabled;
+    std::unique_ptr<Profiler> _profiler;
 
-    //Need to ensure prefixCode is a prefix code of jump operation
-    ProcessorStatus executeJumpOperation(char prefixCode);
+    bool _jit_enabled;
+    std::string _jit_diagnostic;
+    std::unique_ptr<Jit> _jit;
 
-    ProcessorStatus executeNoArgsNonJump(char prefixCode);
+    bool _register_machine_enabled;
+    std::string _register_machine_diagnostic;
+    std::unique_ptr<RegisterMachine> _register_machine;
 
-    ProcessorStatus executeRegArg(char prefixCode);
+    InteractiveTextChannel _console;
+    MemoryChannel _record_channel;
+    IoChannel *_io;
 
-    ProcessorStatus executeExactAddr(char prefixCode);
+    double readInput();
 
-    ProcessorStatus executeUnaryNonJump(char prefixCode);
+    void writeOutput(double val);
+
+    //Pops the operands of a vector instruction from the data stack in memory and pushes its result.
+    //The stack has to hold the operands, on error it is left as it was
+    ProcessorStatus executeVectorOperation(unsigned char opcode, double *&sp);
+
+    //Continues execution at instruction start with the current registers and stacks
+    ProcessorStatus resume(const DecodedProgram &program, int start);
+
+    template <bool Tracing, bool Profiling>
+    ProcessorStatus resume(const DecodedProgram &program, int start);
+
+    template <bool Threaded, bool CacheTop, bool Checked, bool Tracing, bool Profiling>
+    ProcessorStatus run(const DecodedProgram &program, int start);
 
 public:
+    static constexpr int DEFAULT_DATA_STACK_CAPACITY = 1 << 16;
+    static constexpr int DEFAULT_CALL_STACK_CAPACITY = 1 << 20;
 
     Processor();
 
+    //Decodes and verifies the bytecode, compiles it to native code or fuses common sequences into
+    //superinstructions if enabled and executes it. Verified programs run without dynamic safety checks
+    ProcessorStatus executeOperations(const Executable &executable);
+
+    //Raw bytecode, see Executable::fromBytecode
     ProcessorStatus executeOperations(char *start, int size);
 
+    //Runs the program from a clean state, see reset
+    ProcessorStatus execute(const DecodedProgram &program);
+
+    //Restores the state of a new Processor: zeroed registers and RAM, empty stacks. Settings and
+    //the I/O channel are kept and only RAM pages that were written get cleared
+    void reset();
+
+    //Runs the program from a clean state on one input record through a MemoryChannel, the channel
+    //set with setIoChannel is used again afterwards. outputCount receives how many times out was
+    //executed, even past outputSize
+    ProcessorStatus executeRecord(const DecodedProgram &program, const double *input, int inputSize,
+                                  double *output, int outputSize, int &outputCount);
+
+    //Channel used by in and out, owned by the caller. nullptr restores the interactive console
+    void setIoChannel(IoChannel *channel);
+
+    IoChannel *getIoChannel() const;
+
+    void setDispatchMode(DispatchMode mode);
+
+    DispatchMode getDispatchMode() const;
+
+    //Keeps the top of the data stack in a machine register during execution
+    void setTopOfStackCaching(bool enabled);
+
+    //Drops the current data stack contents. Pushing beyond capacity stops
+    //execution with DATA_STACK_OVERFLOW
+    void setDataStackCapacity(int capacity);
+
+    //Replaces RAM by a zeroed one of size bytes, at least 8. Programs loaded before keep the
+    //constant addresses checked against the old size
+    void setRamSize(int size, bool hugePages);
+
+    int getRamSize() const;
+
+    //Drops the current call stack contents. Calling deeper than capacity stops
+    //execution with CALL_STACK_OVERFLOW
+    void setCallStackCapacity(int capacity);
+
+    void setVerificationEnabled(bool enabled);
+
+    //Why the last executeOperations could not verify its program, empty if it was verified
+    const std::string &getVerificationDiagnostic() const;
+
+    //Lets the loader turn calls followed by ret into jumps, see Decoder::eliminateTailCalls
+    void setTailCallEliminationEnabled(bool enabled);
+
+    //Instructions rewritten by tail call elimination during the last executeOperations
+    int getTailCallCount() const;
+
+    void setFusionEnabled(bool enabled);
+
+    //How many times every Fusion rule fired during the last executeOperations
+    const std::vector<int> &getFusionCounts() const;
+
+    //Lets executeOperations compile hot loops and functions into traces
+    void setTracingEnabled(bool enabled);
+
+    //Traces of the last executeOperations, nullptr if tracing was disabled
+    const Tracer *getTracer() const;
+
+    //Lets executeOperations answer calls of pure functions from a cache, needs verification
+    void setMemoizationEnabled(bool enabled);
+
+    //Memoized functions of the last executeOperations, nullptr if memoization did not run
+    const Memoizer *getMemoizer() const;
+
+    //Counts every instruction, call and return of executeOperations in a Profiler. Profiled programs
+    //are neither fused, traced nor compiled
+    void setProfilingEnabled(bool enabled);
+
+    //Profile of the last executeOperations, nullptr if profiling was disabled
+    const Profiler *getProfiler() const;
+
+    //Runs executeOperations in native code generated by Jit where the platform allows it
+    void setJitEnabled(bool enabled);
+
+    //Why the last executeOperations did not run native code, empty if it did
+    const std::string &getJitDiagnostic() const;
+
+    //Runs verified programs translated by RegisterMachine into register code, native code goes first
+    void setRegisterMachineEnabled(bool enabled);
+
+    //Why the last executeOperations did not run register code, empty if it did
+    const std::string &getRegisterMachineDiagnostic() const;
+
+    //Translation of the last executeOperations, nullptr if register code did not run
+    const RegisterMachine *getRegisterMachine() const;
+
     static std::string statusToStr(ProcessorStatus status);
 
 };
@@ -0,0 +1,56 @@
+#include "ProcessorPool.h"
+
+ProcessorPool::Handle::Handle(ProcessorPool *pool, std::unique_ptr<Processor> processor): _pool(pool),
+    _processor(std::move(processor)) {
+}
+
+ProcessorPool::Handle::Handle(Handle &&other) noexcept: _pool(other._pool), _processor(std::move(other._processor)) {
+}
+
+ProcessorPool::Handle &ProcessorPool::Handle::operator=(Handle &&other) noexcept {
+    if (this != &other) {
+        release();
+        _pool = other._pool;
+        _processor = std::move(other._processor);
+    }
+    return *this;
+}
+
+ProcessorPool::Handle::~Handle() {
+    release();
+}
+
+void ProcessorPool::Handle::release() {
+    if (_processor)
+        _pool->put(std::move(_processor));
+}
+
+ProcessorPool::ProcessorPool(int prewarmed, size_t maxIdle): _max_idle(maxIdle) {
+    for (int i = 0; i < prewarmed; i++)
+        _idle.emplace_back(new Processor);
+}
+
+ProcessorPool::Handle ProcessorPool::acquire() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (!_idle.empty()) {
+            std::unique_ptr<Processor> processor = std::move(_idle.back());
+            _idle.pop_back();
+            return Handle(this, std::move(processor));
+        }
+    }
+    return Handle(this, std::unique_ptr<Processor>(new Processor));
+}
+
+void ProcessorPool::put(std::unique_ptr<Processor> processor) {
+    //Reset outside the lock, it is the only part that takes time
+    processor->reset();
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_idle.size() < _max_idle)
+        _idle.push_back(std::move(processor));
+}
+
+size_t ProcessorPool::getIdleCount() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _idle.size();
+}
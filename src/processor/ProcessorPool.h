@@ -0,0 +1,60 @@
+#ifndef STACK_PROCESSOR_PROCESSOR_POOL_H
+#define STACK_PROCESSOR_PROCESSOR_POOL_H
+#include "Processor.h"
+#include <memory>
+#include <mutex>
+#include <vector>
+
+//Keeps reset Processor instances for reuse so callers running many short programs do not
+//pay for construction every time. Safe to use from several threads.
+class ProcessorPool {
+public:
+    //Gives the Processor back to the pool when destroyed
+    class Handle {
+    private:
+        ProcessorPool *_pool;
+        std::unique_ptr<Processor> _processor;
+
+    public:
+        Handle(ProcessorPool *pool, std::unique_ptr<Processor> processor);
+
+        Handle(Handle &&other) noexcept;
+
+        Handle &operator=(Handle &&other) noexcept;
+
+        Handle(const Handle&) = delete;
+
+        Handle &operator=(const Handle&) = delete;
+
+        ~Handle();
+
+        Processor &operator*() const {
+            return *_processor;
+        }
+
+        Processor *operator->() const {
+            return _processor.get();
+        }
+
+        //Returns the Processor to the pool before the handle goes away
+        void release();
+    };
+
+private:
+    std::mutex _mutex;
+    std::vector<std::unique_ptr<Processor>> _idle;
+    size_t _max_idle;
+
+    void put(std::unique_ptr<Processor> processor);
+
+public:
+    //Creates prewarmed instances up front, keeps at most maxIdle returned ones
+    explicit ProcessorPool(int prewarmed = 0, size_t maxIdle = 64);
+
+    //Returns an idle Processor or a new one. Settings made by its previous user are kept
+    Handle acquire();
+
+    size_t getIdleCount();
+};
+
+#endif //STACK_PROCESSOR_PROCESSOR_POOL_H
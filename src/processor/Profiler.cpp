@@ -0,0 +1,303 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+Profiler::Profiler(const DecodedProgram &program): _offsets(program.offsets), _symbols(program.symbols),
+    _counts(program.instructions.size(), 0), _executed(0), _startCycles(0), _totalCycles(0),
+    _functionByEntry(program.instructions.size(), -1) {
+    for (const DecodedInstruction &instruction : program.instructions)
+        _opcodes.push_back(instruction.opcode);
+}
+
+unsigned long long Profiler::readCycles() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+}
+
+int Profiler::getFunction(int entry) {
+    int &function = _functionByEntry[entry];
+    if (function < 0) {
+        function = _functions.size();
+        FunctionProfile profile = FunctionProfile();
+        profile.entry = entry;
+        _functions.push_back(profile);
+    }
+    return function;
+}
+
+void Profiler::pushFrame(int function, unsigned long long now) {
+    int node = 0;
+    if (_frames.empty()) {
+        if (_nodes.empty())
+            _nodes.push_back(CallNode{function, {}, 0, 0});
+    } else {
+        std::map<int, int> &children = _nodes[_frames.back().node].children;
+        auto child = children.find(function);
+        if (child == children.end()) {
+            node = _nodes.size();
+            children[function] = node;
+            _nodes.push_back(CallNode{function, {}, 0, 0});
+        } else {
+            node = child->second;
+        }
+    }
+
+    FunctionProfile &profile = _functions[function];
+    profile.calls++;
+    _frames.push_back(ProfileFrame{function, node, profile.active++ == 0, _executed, now, 0, 0});
+}
+
+void Profiler::popFrame(unsigned long long now) {
+    ProfileFrame frame = _frames.back();
+    _frames.pop_back();
+
+    long long instructions = _executed - frame.startInstructions;
+    unsigned long long cycles = now - frame.startCycles;
+    FunctionProfile &profile = _functions[frame.function];
+    profile.exclusiveInstructions += instructions - frame.childInstructions;
+    profile.exclusiveCycles += cycles - frame.childCycles;
+    if (frame.outermost) {
+        profile.inclusiveInstructions += instructions;
+        profile.inclusiveCycles += cycles;
+    }
+    profile.active--;
+
+    _nodes[frame.node].instructions += instructions - frame.childInstructions;
+    _nodes[frame.node].cycles += cycles - frame.childCycles;
+    if (!_frames.empty()) {
+        _frames.back().childInstructions += instructions;
+        _frames.back().childCycles += cycles;
+    }
+}
+
+void Profiler::enter(int entry) {
+    pushFrame(getFunction(entry), readCycles());
+}
+
+void Profiler::leave() {
+    //Returning from the program itself fails in the interpreter
+    if (_frames.size() > 1)
+        popFrame(readCycles());
+}
+
+void Profiler::start() {
+    _startCycles = readCycles();
+    pushFrame(getFunction(0), _startCycles);
+}
+
+void Profiler::stop() {
+    unsigned long long now = readCycles();
+    while (!_frames.empty())
+        popFrame(now);
+    _totalCycles += now - _startCycles;
+}
+
+const char *Profiler::getOpcodeName(unsigned char opcode) {
+    switch (opcode) {
+        case OperationPrefixCode::IN:
+            return "in";
+        case OperationPrefixCode::OUT:
+            return "out";
+        case OperationPrefixCode::ADD:
+            return "add";
+        case OperationPrefixCode::SUB:
+            return "sub";
+        case OperationPrefixCode::MUL:
+            return "mul";
+        case OperationPrefixCode::DIV:
+            return "div";
+        case OperationPrefixCode::SIN:
+            return "sin";
+        case OperationPrefixCode::COS:
+            return "cos";
+        case OperationPrefixCode::SQRT:
+            return "sqrt";
+        case OperationPrefixCode::RET_ABS:
+            return "ret";
+        case OperationPrefixCode::HALT:
+            return "halt";
+        case OperationPrefixCode::POP:
+            return "popd";
+        case OperationPrefixCode::PUSH_REG_VAL:
+            return "push reg";
+        case OperationPrefixCode::PUSH_EXACT_VAL:
+            return "push val";
+        case OperationPrefixCode::PUSH_REG_ADDR:
+            return "push [reg]";
+        case OperationPrefixCode::PUSH_EXACT_ADDR:
+            return "push [addr]";
+        case OperationPrefixCode::POP_REG_VAL:
+            return "pop reg";
+        case OperationPrefixCode::POP_EXACT_ADDR:
+            return "pop [addr]";
+        case OperationPrefixCode::POP_REG_ADDR:
+            return "pop [reg]";
+        case OperationPrefixCode::JMP_OFFSET_EXACT_VAL:
+            return "jmp";
+        case OperationPrefixCode::JE_OFFSET_EXACT_VAL:
+            return "je";
+        case OperationPrefixCode::JNE_OFFSET_EXACT_VAL:
+            return "jne";
+        case OperationPrefixCode::JA_OFFSET_EXACT_VAL:
+            return "ja";
+        case OperationPrefixCode::JAE_OFFSET_EXACT_VAL:
+            return "jae";
+        case OperationPrefixCode::JB_OFFSET_EXACT_VAL:
+            return "jb";
+        case OperationPrefixCode::JBE_OFFSET_EXACT_VAL:
+            return "jbe";
+        case OperationPrefixCode::CALL_OFFSET_EXACT_VAL:
+            return "call";
+        case OperationPrefixCode::PUSH_FRAME_SLOT:
+            return "push [fp]";
+        case OperationPrefixCode::POP_FRAME_SLOT:
+            return "pop [fp]";
+        case OperationPrefixCode::VADD:
+            return "vadd";
+        case OperationPrefixCode::VMUL:
+            return "vmul";
+        case OperationPrefixCode::VFMA:
+            return "vfma";
+        case OperationPrefixCode::VSUM:
+            return "vsum";
+        case OperationPrefixCode::VMIN:
+            return "vmin";
+        case OperationPrefixCode::VMAX:
+            return "vmax";
+        case OperationPrefixCode::VDOT:
+            return "vdot";
+        case OperationPrefixCode::VFILL:
+            return "vfill";
+        case OperationPrefixCode::VCOPY:
+            return "vcopy";
+        case OperationPrefixCode::IADD:
+            return "iadd";
+        case OperationPrefixCode::ISUB:
+            return "isub";
+        case OperationPrefixCode::IMUL:
+            return "imul";
+        case OperationPrefixCode::IDIV:
+            return "idiv";
+        case OperationPrefixCode::IREM:
+            return "irem";
+        case OperationPrefixCode::IAND:
+            return "iand";
+        case OperationPrefixCode::IOR:
+            return "ior";
+        case OperationPrefixCode::IXOR:
+            return "ixor";
+        case OperationPrefixCode::ISHL:
+            return "ishl";
+        case OperationPrefixCode::ISHR:
+            return "ishr";
+        case OperationPrefixCode::ITOD:
+            return "itod";
+        case OperationPrefixCode::DTOI:
+            return "dtoi";
+        case OperationPrefixCode::IJE_OFFSET_EXACT_VAL:
+            return "ije";
+        case OperationPrefixCode::IJNE_OFFSET_EXACT_VAL:
+            return "ijne";
+        case OperationPrefixCode::IJA_OFFSET_EXACT_VAL:
+            return "ija";
+        case OperationPrefixCode::IJAE_OFFSET_EXACT_VAL:
+            return "ijae";
+        case OperationPrefixCode::IJB_OFFSET_EXACT_VAL:
+            return "ijb";
+        case OperationPrefixCode::IJBE_OFFSET_EXACT_VAL:
+            return "ijbe";
+        case InternalOperationCode::TRAP:
+            return "trap";
+        default:
+            return "internal";
+    }
+}
+
+long long Profiler::getExecuted() const {
+    return _executed;
+}
+
+unsigned long long Profiler::getTotalCycles() const {
+    return _totalCycles;
+}
+
+const std::vector<FunctionProfile> &Profiler::getFunctions() const {
+    return _functions;
+}
+
+std::string Profiler::getFunctionName(int function) const {
+    int entry = _functions[function].entry;
+    if (entry == 0)
+        return "main";
+    //A label at the entry names the function when the executable has symbols
+    auto symbol = std::lower_bound(_symbols.begin(), _symbols.end(), _offsets[entry],
+                                   [](const ProgramSymbol &symbol, int offset) { return symbol.offset < offset; });
+    if (symbol != _symbols.end() && symbol->offset == _offsets[entry])
+        return symbol->name;
+    return "fn@" + std::to_string(_offsets[entry]);
+}
+
+void Profiler::writeJson(FILE *output) const {
+    std::fprintf(output, "{\n  \"instructions\": %lld,\n  \"cycles\": %llu,\n", _executed, _totalCycles);
+
+    long long opcodeCounts[256] = {};
+    for (size_t i = 0; i < _counts.size(); i++)
+        opcodeCounts[_opcodes[i]] += _counts[i];
+    std::fprintf(output, "  \"opcodes\": {");
+    const char *separator = "";
+    for (int opcode = 0; opcode < 256; opcode++) {
+        if (opcodeCounts[opcode] == 0)
+            continue;
+        std::fprintf(output, "%s\n    \"%s\": %lld", separator, getOpcodeName(opcode), opcodeCounts[opcode]);
+        separator = ",";
+    }
+    std::fprintf(output, "\n  },\n  \"offsets\": [");
+
+    separator = "";
+    for (size_t i = 0; i < _counts.size(); i++) {
+        if (_counts[i] == 0)
+            continue;
+        std::fprintf(output, "%s\n    {\"offset\": %d, \"opcode\": \"%s\", \"count\": %lld}", separator,
+                     _offsets[i], getOpcodeName(_opcodes[i]), _counts[i]);
+        separator = ",";
+    }
+    std::fprintf(output, "\n  ],\n  \"functions\": [");
+
+    separator = "";
+    for (size_t i = 0; i < _functions.size(); i++) {
+        const FunctionProfile &profile = _functions[i];
+        std::fprintf(output, "%s\n    {\"name\": \"%s\", \"offset\": %d, \"calls\": %lld, "
+                             "\"inclusive_instructions\": %lld, \"exclusive_instructions\": %lld, "
+                             "\"inclusive_cycles\": %llu, \"exclusive_cycles\": %llu}",
+                     separator, getFunctionName(i).c_str(), _offsets[profile.entry], profile.calls,
+                     profile.inclusiveInstructions, profile.exclusiveInstructions, profile.inclusiveCycles,
+                     profile.exclusiveCycles);
+        separator = ",";
+    }
+    std::fprintf(output, "\n  ]\n}\n");
+}
+
+void Profiler::writeFolded(FILE *output, int node, std::string &path) const {
+    size_t length = path.size();
+    if (!path.empty())
+        path += ';';
+    path += getFunctionName(_nodes[node].function);
+    if (_nodes[node].cycles > 0)
+        std::fprintf(output, "%s %llu\n", path.c_str(), _nodes[node].cycles);
+    for (const auto &child : _nodes[node].children)
+        writeFolded(output, child.second, path);
+    path.resize(length);
+}
+
+void Profiler::writeFolded(FILE *output) const {
+    std::string path;
+    if (!_nodes.empty())
+        writeFolded(output, 0, path);
+}
@@ -0,0 +1,99 @@
+#ifndef STACK_PROCESSOR_PROFILER_H
+#define STACK_PROCESSOR_PROFILER_H
+#include "Decoder.h"
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+struct FunctionProfile {
+    int entry; //Decoded index of the first instruction, 0 for the program itself
+    long long calls;
+    long long inclusiveInstructions;
+    long long exclusiveInstructions;
+    unsigned long long inclusiveCycles;
+    unsigned long long exclusiveCycles;
+    int active; //Activations on the call stack, inclusive costs only count the outermost one
+};
+
+//One distinct call path, the root is the program itself
+struct CallNode {
+    int function;
+    std::map<int, int> children;
+    long long instructions;
+    unsigned long long cycles;
+};
+
+struct ProfileFrame {
+    int function;
+    int node;
+    bool outermost;
+    long long startInstructions;
+    unsigned long long startCycles;
+    long long childInstructions;
+    unsigned long long childCycles;
+};
+
+//Counts what a profiling run of the interpreter executes: every instruction, and time
+//spent in every function taken from the time stamp counter at calls and returns.
+//Profiled programs are not fused, so every count belongs to one bytecode instruction.
+class Profiler {
+private:
+    std::vector<unsigned char> _opcodes;
+    std::vector<int> _offsets;
+    std::vector<ProgramSymbol> _symbols;
+    std::vector<long long> _counts;
+    long long _executed;
+    unsigned long long _startCycles;
+    unsigned long long _totalCycles;
+
+    std::vector<FunctionProfile> _functions;
+    std::vector<int> _functionByEntry;
+    std::vector<CallNode> _nodes;
+    std::vector<ProfileFrame> _frames;
+
+    static unsigned long long readCycles();
+
+    int getFunction(int entry);
+
+    void pushFrame(int function, unsigned long long now);
+
+    void popFrame(unsigned long long now);
+
+    std::string getFunctionName(int function) const;
+
+    void writeFolded(FILE *output, int node, std::string &path) const;
+
+public:
+    explicit Profiler(const DecodedProgram &program);
+
+    void count(int index) {
+        _counts[index]++;
+        _executed++;
+    }
+
+    void enter(int entry);
+
+    void leave();
+
+    //Around the run, frames still open when it stops are closed
+    void start();
+
+    void stop();
+
+    static const char *getOpcodeName(unsigned char opcode);
+
+    long long getExecuted() const;
+
+    unsigned long long getTotalCycles() const;
+
+    const std::vector<FunctionProfile> &getFunctions() const;
+
+    //Totals, counts per opcode, per bytecode offset and per function
+    void writeJson(FILE *output) const;
+
+    //One line per call path with its exclusive cycles, the format flame graph tools read
+    void writeFolded(FILE *output) const;
+};
+
+#endif //STACK_PROCESSOR_PROFILER_H
@@ -0,0 +1,876 @@
+#include "RegisterMachine.h"
+#include "IntegerOperations.h"
+#include "Processor.h"
+#include "VectorOperations.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <map>
+
+static constexpr int REGISTER_COUNT = 4;
+
+//Jump of a block whose taken path first writes values the fall through path keeps in operands
+struct RegisterStub {
+    int jump;
+    int target;
+    int depth;
+    int owner;
+    std::vector<std::pair<int, int>> moves; //Slot and operand
+};
+
+//Translates one block of decoded instructions at a time. _stack holds the operand every value on
+//the data stack is read from, starting at the lowest slot the function may touch. A value is home
+//once its slot holds it. Blocks start with every value home, other values are written to their
+//slots before the block is left or the register or slot they are read from gets overwritten.
+class RegisterTranslator {
+private:
+    const DecodedProgram &_program;
+    const std::vector<FunctionSummary> &_functions;
+    RegisterMachine &_machine;
+    std::string &_diagnostic;
+    std::vector<RegisterInstruction> &_code;
+    std::vector<int> _functionByEntry;
+    //Function whose code reaches an instruction first and the depth there relative to its entry
+    std::vector<int> _owner;
+    std::vector<int> _depth;
+    std::vector<int> _maxDepth;
+    //Jump and call targets, return addresses and code reached from other functions
+    std::vector<bool> _labels;
+    //Values the run of popd starting at an instruction drops without reading them
+    std::vector<int> _dropped;
+    //Register code position of every decoded instruction that starts a block
+    std::vector<int> _entries;
+    std::map<unsigned long long, int> _constants;
+    std::vector<std::pair<int, int>> _fixups;
+    std::vector<RegisterStub> _stubs;
+
+    std::vector<int> _stack;
+    int _bottom;
+    int _top;
+    //Values below it are home
+    int _lazyFrom;
+    //Instruction that wrote the value on top of the stack, its destination can still change
+    int _produced;
+    bool _fallsThrough;
+
+    bool fail(int index, const std::string &message) {
+        int offset = _program.offsets[index];
+        if (offset >= 0)
+            _diagnostic = "offset " + std::to_string(offset) + ": " + message;
+        else
+            _diagnostic = "end of code: " + message;
+        return false;
+    }
+
+    int constant(double value) {
+        unsigned long long bits = IntegerOperations::getBits(value);
+        auto found = _constants.find(bits);
+        if (found != _constants.end())
+            return found->second;
+        int operand = RegisterMachine::FIXED_OPERAND + _machine._fixed.size();
+        _machine._fixed.push_back(value);
+        _constants[bits] = operand;
+        return operand;
+    }
+
+    int emit(unsigned char opcode, int dst, int left, int right, int arg, int index) {
+        RegisterInstruction instruction;
+        instruction.opcode = opcode;
+        instruction.dst = dst;
+        instruction.left = left;
+        instruction.right = right;
+        instruction.arg = arg;
+        instruction.index = index;
+        _code.push_back(instruction);
+        return _code.size() - 1;
+    }
+
+    int entry(int slot) const {
+        return _stack[slot - _bottom];
+    }
+
+    void setEntry(int slot, int operand) {
+        _stack[slot - _bottom] = operand;
+        if (operand != slot)
+            _lazyFrom = std::min(_lazyFrom, slot);
+    }
+
+    void push(int operand) {
+        _top++;
+        if (_top - _bottom > static_cast<int>(_stack.size()))
+            _stack.resize(_top - _bottom);
+        setEntry(_top - 1, operand);
+    }
+
+    int pop() {
+        return entry(--_top);
+    }
+
+    //Value on top of the stack, written to its slot
+    int produce(unsigned char opcode, int left, int right, int arg, int index) {
+        _produced = emit(opcode, _top, left, right, arg, index);
+        push(_top);
+        return _produced;
+    }
+
+    //The value just popped from slot was written by the last instruction
+    bool canRedirect(int slot) const {
+        return _produced >= 0 && _produced == static_cast<int>(_code.size()) - 1 && slot == _top &&
+               _code.back().dst == slot;
+    }
+
+    void materialize(int from, int to) {
+        for (int slot = std::max(from, _lazyFrom); slot < to; slot++) {
+            if (entry(slot) != slot) {
+                emit(R_MOVE, slot, entry(slot), 0, 0, -1);
+                setEntry(slot, slot);
+            }
+        }
+        if (from <= _lazyFrom && to > _lazyFrom)
+            _lazyFrom = to;
+    }
+
+    //Writes values read from operand to their slots before operand is overwritten
+    void spill(int operand) {
+        for (int slot = _lazyFrom; slot < _top; slot++) {
+            if (entry(slot) == operand && slot != operand) {
+                emit(R_MOVE, slot, operand, 0, 0, -1);
+                setEntry(slot, slot);
+            }
+        }
+    }
+
+    void writeRegister(int reg, int value) {
+        int operand = RegisterMachine::FIXED_OPERAND + reg;
+        size_t emitted = _code.size();
+        spill(operand);
+        if (value == operand)
+            return;
+        if (_code.size() == emitted && canRedirect(value))
+            _code.back().dst = operand;
+        else
+            emit(R_MOVE, operand, value, 0, 0, -1);
+    }
+
+    void writeFrameSlot(int slot, int value) {
+        size_t emitted = _code.size();
+        spill(slot);
+        if (value == slot)
+            return;
+        if (value >= RegisterMachine::FIXED_OPERAND) {
+            setEntry(slot, value);
+            return;
+        }
+        if (_code.size() == emitted && canRedirect(value))
+            _code.back().dst = slot;
+        else
+            emit(R_MOVE, slot, value, 0, 0, -1);
+        setEntry(slot, slot);
+    }
+
+    //Values on top of the stack entering target that are dropped before they are read
+    int dropped(int target) const {
+        return std::min(_dropped[target], _top - _bottom);
+    }
+
+    void startBlock(int index) {
+        _bottom = -_functions[_owner[index]].required;
+        _top = _depth[index];
+        _stack.resize(_top - _bottom);
+        for (int slot = _bottom; slot < _top; slot++)
+            _stack[slot - _bottom] = slot;
+        _lazyFrom = _top;
+        _produced = -1;
+    }
+
+    //Continues at target of another function with the frame moved, in the same function with a jump
+    void transfer(int target, int depth, int owner, int index) {
+        if (_owner[target] == owner) {
+            _fixups.push_back({emit(R_JMP, 0, 0, 0, 0, index), target});
+            return;
+        }
+        int delta = depth - _depth[target];
+        _fixups.push_back({emit(R_REBASE, delta, depth, delta + _maxDepth[_owner[target]], 0, target), target});
+    }
+
+    //Writes what target reads from slots and jumps there
+    void leave(int target, int index) {
+        materialize(_bottom, _top - dropped(target));
+        transfer(target, _top, _owner[index], index);
+    }
+
+    bool visit(int function, int to, int depth, std::vector<int> &worklist) {
+        if (_owner[to] == -1) {
+            _owner[to] = function;
+            _depth[to] = depth;
+            worklist.push_back(to);
+        } else if (_owner[to] != function) {
+            _labels[to] = true;
+            if (_program.frames && _depth[to] != depth)
+                return fail(to, "frame slots in code shared between functions");
+        }
+        return true;
+    }
+
+    bool assignOwners() {
+        const std::vector<DecodedInstruction> &code = _program.instructions;
+        for (int function = 0; function < static_cast<int>(_functions.size()); function++) {
+            int entry = _functions[function].entry;
+            _labels[entry] = true;
+            std::vector<int> worklist;
+            if (!visit(function, entry, 0, worklist))
+                return false;
+
+            while (!worklist.empty()) {
+                int index = worklist.back();
+                worklist.pop_back();
+                const DecodedInstruction &instruction = code[index];
+                int depth = _depth[index];
+                _maxDepth[function] = std::max(_maxDepth[function], depth);
+
+                switch (instruction.opcode) {
+                    case InternalOperationCode::TRAP:
+                    case OperationPrefixCode::HALT:
+                    case OperationPrefixCode::RET_ABS:
+                        break;
+                    case OperationPrefixCode::JMP_OFFSET_EXACT_VAL:
+                        _labels[instruction.arg] = true;
+                        if (!visit(function, instruction.arg, depth, worklist))
+                            return false;
+                        break;
+                    case OperationPrefixCode::CALL_OFFSET_EXACT_VAL: {
+                        const FunctionSummary &callee = _functions[_functionByEntry[instruction.arg]];
+                        if (callee.returns) {
+                            _labels[index + 1] = true;
+                            if (!visit(function, index + 1, depth + callee.effect, worklist))
+                                return false;
+                        }
+                        break;
+                    }
+                    default: {
+                        if (!Decoder::isCommand(instruction.opcode))
+                            return fail(index, "cannot translate internal opcode");
+                        if (Decoder::isConditionalJump(instruction.opcode)) {
+                            _labels[instruction.arg] = true;
+                            if (!visit(function, instruction.arg, depth, worklist))
+                                return false;
+                        }
+                        int needed, pushed;
+                        Verifier::getStackEffect(instruction.opcode, needed, pushed);
+                        //Pushes folded into operands count as well, run checks the bound
+                        //before the function touches the stack
+                        int next = depth - needed + pushed;
+                        _maxDepth[function] = std::max(_maxDepth[function], next);
+                        if (!visit(function, index + 1, next, worklist))
+                            return false;
+                    }
+                }
+            }
+        }
+
+        //Callees run in a frame starting at the depth of their entry, the same as fp
+        for (const FunctionSummary &function : _functions) {
+            if (_program.frames && _depth[function.entry] != 0)
+                return fail(function.entry, "frame slots in code shared between functions");
+        }
+        return true;
+    }
+
+    void translateConditionalJump(const DecodedInstruction &instruction, int index) {
+        static const unsigned char OPCODES[] = {R_JE, R_JNE, R_JA, R_JAE, R_JB, R_JBE};
+        unsigned char opcode;
+        if (instruction.opcode >= OperationPrefixCode::IJE_OFFSET_EXACT_VAL)
+            opcode = R_IJE + (instruction.opcode - OperationPrefixCode::IJE_OFFSET_EXACT_VAL);
+        else
+            opcode = OPCODES[instruction.opcode - OperationPrefixCode::JE_OFFSET_EXACT_VAL];
+
+        int owner = _owner[index];
+        int target = instruction.arg;
+        int next = index + 1;
+        int left = entry(_top - 2);
+        int right = entry(_top - 1);
+
+        //Code that only falls through here goes on with the operands of this block
+        bool continues = _owner[next] == owner && !_labels[next];
+        int takenNeeds = _top - dropped(target);
+        int nextNeeds = continues ? _bottom : _top - dropped(next);
+        materialize(_bottom, std::min(takenNeeds, nextNeeds));
+
+        RegisterStub stub;
+        stub.target = target;
+        stub.depth = _top;
+        stub.owner = owner;
+        for (int slot = std::max(std::min(takenNeeds, nextNeeds), _lazyFrom); slot < takenNeeds; slot++) {
+            if (entry(slot) != slot)
+                stub.moves.push_back({slot, entry(slot)});
+        }
+        stub.jump = emit(opcode, 0, left, right, 0, index);
+        if (stub.moves.empty() && _owner[target] == owner)
+            _fixups.push_back({stub.jump, target});
+        else
+            _stubs.push_back(stub);
+        _fallsThrough = true;
+    }
+
+    bool translateInstruction(int index) {
+        const DecodedInstruction &instruction = _program.instructions[index];
+        int value, right;
+        _fallsThrough = true;
+
+        switch (instruction.opcode) {
+            case OperationPrefixCode::IN:
+                produce(R_IN, 0, 0, 0, index);
+                break;
+            case OperationPrefixCode::OUT:
+                emit(R_OUT, 0, pop(), 0, 0, index);
+                break;
+            case OperationPrefixCode::ADD:
+            case OperationPrefixCode::SUB:
+            case OperationPrefixCode::MUL:
+            case OperationPrefixCode::DIV:
+                right = pop();
+                value = pop();
+                produce(R_ADD + (instruction.opcode - OperationPrefixCode::ADD), value, right, 0, index);
+                break;
+            case OperationPrefixCode::SIN:
+                produce(R_SIN, pop(), 0, 0, index);
+                break;
+            case OperationPrefixCode::COS:
+                produce(R_COS, pop(), 0, 0, index);
+                break;
+            case OperationPrefixCode::SQRT:
+                produce(R_SQRT, pop(), 0, 0, index);
+                break;
+            case OperationPrefixCode::IADD:
+            case OperationPrefixCode::ISUB:
+            case OperationPrefixCode::IMUL:
+            case OperationPrefixCode::IDIV:
+            case OperationPrefixCode::IREM:
+            case OperationPrefixCode::IAND:
+            case OperationPrefixCode::IOR:
+            case OperationPrefixCode::IXOR:
+            case OperationPrefixCode::ISHL:
+            case OperationPrefixCode::ISHR:
+                right = pop();
+                value = pop();
+                produce(R_IADD + (instruction.opcode - OperationPrefixCode::IADD), value, right, 0, index);
+                break;
+            case OperationPrefixCode::ITOD:
+                produce(R_ITOD, pop(), 0, 0, index);
+                break;
+            case OperationPrefixCode::DTOI:
+                produce(R_DTOI, pop(), 0, 0, index);
+                break;
+            case OperationPrefixCode::RET_ABS:
+                materialize(_bottom, _top);
+                emit(R_RET, _top, 0, 0, 0, index);
+                _fallsThrough = false;
+                break;
+            case OperationPrefixCode::HALT:
+                materialize(_bottom, _top);
+                emit(R_HALT, _top, 0, 0, 0, index);
+                _fallsThrough = false;
+                break;
+            case InternalOperationCode::TRAP:
+                materialize(_bottom, _top);
+                emit(R_TRAP, _top, 0, 0, instruction.arg, index);
+                _fallsThrough = false;
+                break;
+            case OperationPrefixCode::POP:
+                pop();
+                break;
+            case OperationPrefixCode::PUSH_REG_VAL:
+                push(RegisterMachine::FIXED_OPERAND + instruction.reg);
+                break;
+            case OperationPrefixCode::PUSH_EXACT_VAL:
+                push(constant(instruction.val));
+                break;
+            case OperationPrefixCode::PUSH_REG_ADDR:
+                produce(R_LOAD_REG, RegisterMachine::FIXED_OPERAND + instruction.reg, 0, 0, index);
+                break;
+            case OperationPrefixCode::PUSH_EXACT_ADDR:
+                produce(R_LOAD, 0, 0, instruction.arg, index);
+                break;
+            case OperationPrefixCode::POP_REG_VAL:
+                writeRegister(instruction.reg, pop());
+                break;
+            case OperationPrefixCode::POP_EXACT_ADDR:
+                emit(R_STORE, 0, pop(), 0, instruction.arg, index);
+                break;
+            case OperationPrefixCode::POP_REG_ADDR:
+                emit(R_STORE_REG, 0, pop(), RegisterMachine::FIXED_OPERAND + instruction.reg, 0, index);
+                break;
+            case OperationPrefixCode::PUSH_FRAME_SLOT:
+                push(entry(instruction.arg));
+                break;
+            case OperationPrefixCode::POP_FRAME_SLOT:
+                writeFrameSlot(instruction.arg, pop());
+                break;
+            case OperationPrefixCode::JMP_OFFSET_EXACT_VAL:
+                leave(instruction.arg, index);
+                _fallsThrough = false;
+                break;
+            case OperationPrefixCode::CALL_OFFSET_EXACT_VAL: {
+                int target = instruction.arg;
+                int frame = _top - _depth[target];
+                materialize(_bottom, _top);
+                _fixups.push_back({emit(R_CALL, _top, frame, frame + _maxDepth[_owner[target]], 0, index), target});
+                //The callee returns right after the call, in the frame of the caller
+                const FunctionSummary &callee = _functions[_functionByEntry[target]];
+                if (callee.returns && _owner[index + 1] != _owner[index])
+                    transfer(index + 1, _top + callee.effect, _owner[index], index);
+                _fallsThrough = false;
+                break;
+            }
+            default:
+                if (Decoder::isConditionalJump(instruction.opcode)) {
+                    translateConditionalJump(instruction, index);
+                } else if (VectorOperations::isVectorOperation(instruction.opcode)) {
+                    int needed, pushed;
+                    VectorOperations::getStackEffect(instruction.opcode, needed, pushed);
+                    materialize(_top - needed, _top);
+                    emit(R_VECTOR, _top, 0, 0, instruction.opcode, index);
+                    _top -= needed;
+                    if (pushed > 0)
+                        push(_top);
+                } else {
+                    return fail(index, "cannot translate internal opcode");
+                }
+        }
+        return true;
+    }
+
+public:
+    RegisterTranslator(const DecodedProgram &program, const std::vector<FunctionSummary> &functions,
+                       RegisterMachine &machine, std::string &diagnostic): _program(program),
+        _functions(functions), _machine(machine), _diagnostic(diagnostic), _code(machine._code),
+        _functionByEntry(program.instructions.size(), -1), _owner(program.instructions.size(), -1),
+        _depth(program.instructions.size(), 0), _maxDepth(functions.size(), 0),
+        _labels(program.instructions.size(), false), _dropped(program.instructions.size(), 0),
+        _entries(program.instructions.size(), -1),
+        _bottom(0), _top(0), _lazyFrom(0), _produced(-1), _fallsThrough(false) {
+    }
+
+    bool translate() {
+        const std::vector<DecodedInstruction> &code = _program.instructions;
+        int count = code.size();
+        for (int function = 0; function < static_cast<int>(_functions.size()); function++)
+            _functionByEntry[_functions[function].entry] = function;
+        if (!assignOwners())
+            return false;
+        for (int index = count - 1; index >= 0; index--) {
+            if (code[index].opcode == OperationPrefixCode::POP)
+                _dropped[index] = 1 + (index + 1 < count ? _dropped[index + 1] : 0);
+        }
+
+        _machine._fixed.assign(REGISTER_COUNT, 0.0);
+        _machine._mainDepth = _maxDepth[0];
+        _machine._frames = _program.frames;
+        _machine._translatedCount = 0;
+
+        bool continues = false;
+        for (int index = 0; index < count; index++) {
+            if (_owner[index] == -1)
+                continue;
+            if (!continues)
+                startBlock(index);
+            _entries[index] = _code.size();
+            _machine._translatedCount++;
+            if (!translateInstruction(index))
+                return false;
+
+            continues = false;
+            if (_fallsThrough) {
+                int next = index + 1;
+                if (_owner[next] == _owner[index] && !_labels[next]) {
+                    continues = true;
+                } else {
+                    materialize(_bottom, _top - dropped(next));
+                    if (_owner[next] != _owner[index])
+                        transfer(next, _top, _owner[index], index);
+                }
+            }
+        }
+
+        for (const RegisterStub &stub : _stubs) {
+            _code[stub.jump].arg = _code.size();
+            for (const std::pair<int, int> &move : stub.moves)
+                emit(R_MOVE, move.first, move.second, 0, 0, -1);
+            transfer(stub.target, stub.depth, stub.owner, _code[stub.jump].index);
+        }
+        for (const std::pair<int, int> &fixup : _fixups)
+            _code[fixup.first].arg = _entries[fixup.second];
+        return true;
+    }
+};
+
+RegisterMachine::RegisterMachine(): _mainDepth(0), _frames(false), _translatedCount(0) {
+}
+
+bool RegisterMachine::translate(const DecodedProgram &program, const std::vector<FunctionSummary> &functions,
+                                std::string &diagnostic) {
+    _code.clear();
+    _fixed.clear();
+    diagnostic.clear();
+    if (!program.verified) {
+        diagnostic = "program is not verified";
+        return false;
+    }
+    RegisterTranslator translator(program, functions, *this, diagnostic);
+    if (!translator.translate()) {
+        _code.clear();
+        return false;
+    }
+    return true;
+}
+
+void RegisterMachine::restoreCallStack(Processor &processor) const {
+    std::vector<int> addresses(processor._call_stack.begin(), processor._call_stack.end());
+    for (int &address : addresses)
+        address = _code[address - 1].index + 1;
+    processor._call_stack.assign(addresses.data(), addresses.data() + addresses.size());
+}
+
+int RegisterMachine::getTranslatedCount() const {
+    return _translatedCount;
+}
+
+int RegisterMachine::getInstructionCount() const {
+    return _code.size();
+}
+
+ProcessorStatus RegisterMachine::run(Processor &processor) {
+    //Calls do not check the call stack capacity, the push beyond it faults and lands here
+    GuardScope scope;
+    StackGuard::enter(scope, processor._call_stack.getRegion());
+    if (sigsetjmp(scope.jump, 0) != 0) {
+        StackGuard::leave(scope);
+        return ProcessorStatus::CALL_STACK_OVERFLOW;
+    }
+    int resumeIndex = -1;
+    ProcessorStatus status = execute(processor, resumeIndex);
+    StackGuard::leave(scope);
+    if (resumeIndex >= 0)
+        return processor.resume(processor._program, resumeIndex);
+    return status;
+}
+
+#if defined(__GNUC__)
+#define REGISTER_COMPUTED_GOTO 1
+#define HANDLER(label) label:
+#define DISPATCH() goto *dispatchTable[ins->opcode]
+#else
+#define HANDLER(label)
+#define DISPATCH() goto dispatch
+#endif
+
+#define SLOT(operand) (((operand) >= FIXED_OPERAND ? fixed : base) + ((operand) - ((operand) >= FIXED_OPERAND ? FIXED_OPERAND : 0)))
+#define VALUE(operand) (*SLOT(operand))
+#define RESULT(operand) (*SLOT(operand))
+#define INTEGER(operand) IntegerOperations::getBits(VALUE(operand))
+
+//The stack holds depth values of the running frame
+#define EXIT(depth, status) do { \
+    restoreCallStack(processor); \
+    std::memcpy(processor._reg, fixed, sizeof (processor._reg)); \
+    processor._data_stack_top = base + (depth); \
+    processor._frame_pointer = base - stackBase; \
+    return (status); \
+} while (0)
+
+//The interpreter continues at decoded instruction index
+#define HAND_OVER(depth, index) do { \
+    resumeIndex = (index); \
+    EXIT(depth, ProcessorStatus::SUCCESS); \
+} while (0)
+
+#define BINARY_OPERATION(op) do { \
+    RESULT(ins->dst) = VALUE(ins->left) op VALUE(ins->right); \
+    ins++; \
+    DISPATCH(); \
+} while (0)
+
+#define UNARY_OPERATION(expression) do { \
+    left = VALUE(ins->left); \
+    RESULT(ins->dst) = (expression); \
+    ins++; \
+    DISPATCH(); \
+} while (0)
+
+#define INTEGER_BINARY_OPERATION(expression) do { \
+    ileft = INTEGER(ins->left); \
+    iright = INTEGER(ins->right); \
+    RESULT(ins->dst) = IntegerOperations::fromBits(expression); \
+    ins++; \
+    DISPATCH(); \
+} while (0)
+
+#define INTEGER_DIVISION(operation) do { \
+    iright = INTEGER(ins->right); \
+    if (iright == 0) \
+        EXIT(0, ProcessorStatus::INTEGER_DIVISION_BY_ZERO); \
+    ileft = INTEGER(ins->left); \
+    RESULT(ins->dst) = IntegerOperations::fromBits(IntegerOperations::operation(ileft, iright)); \
+    ins++; \
+    DISPATCH(); \
+} while (0)
+
+#define CONDITION_JE(left, right) (std::fabs((right) - (left)) < PROCESSOR_EPSILON)
+#define CONDITION_JNE(left, right) (std::fabs((right) - (left)) >= PROCESSOR_EPSILON)
+#define CONDITION_JA(left, right) ((left) > (right) + PROCESSOR_EPSILON)
+#define CONDITION_JAE(left, right) (CONDITION_JA(left, right) || CONDITION_JE(left, right))
+#define CONDITION_JB(left, right) ((left) + PROCESSOR_EPSILON < (right))
+#define CONDITION_JBE(left, right) (CONDITION_JB(left, right) || CONDITION_JE(left, right))
+
+#define CONDITIONAL_JUMP(cond) do { \
+    left = VALUE(ins->left); \
+    right = VALUE(ins->right); \
+    ins = CONDITION_##cond(left, right) ? code + ins->arg : ins + 1; \
+    DISPATCH(); \
+} while (0)
+
+#define INTEGER_CONDITIONAL_JUMP(op) do { \
+    ileft = INTEGER(ins->left); \
+    iright = INTEGER(ins->right); \
+    ins = ileft op iright ? code + ins->arg : ins + 1; \
+    DISPATCH(); \
+} while (0)
+
+ProcessorStatus RegisterMachine::execute(Processor &processor, int &resumeIndex) {
+    const RegisterInstruction *code = _code.data();
+    const RegisterInstruction *ins = code;
+    double *const stackBase = processor._data_stack_base;
+    double *const limit = stackBase + processor._data_stack_capacity;
+    double *base = stackBase;
+    double *fixed = _fixed.data();
+    double *sp;
+    double left, right;
+    long long ileft, iright;
+    int addr;
+    ProcessorStatus status;
+    const bool frames = _frames;
+    RAM &ram = *processor._ram;
+    std::memcpy(fixed, processor._reg, sizeof (processor._reg));
+
+    if (base + _mainDepth > limit)
+        HAND_OVER(0, 0);
+
+#ifdef REGISTER_COMPUTED_GOTO
+    static const void *const dispatchTable[R_OPERATION_COUNT] = {
+        &&op_move, &&op_add, &&op_sub, &&op_mul, &&op_div, &&op_sin, &&op_cos, &&op_sqrt,
+        &&op_iadd, &&op_isub, &&op_imul, &&op_idiv, &&op_irem, &&op_iand, &&op_ior, &&op_ixor,
+        &&op_ishl, &&op_ishr, &&op_itod, &&op_dtoi, &&op_in, &&op_out, &&op_load, &&op_load_reg,
+        &&op_store, &&op_store_reg, &&op_jmp, &&op_je, &&op_jne, &&op_ja, &&op_jae, &&op_jb,
+        &&op_jbe, &&op_ije, &&op_ijne, &&op_ija, &&op_ijae, &&op_ijb, &&op_ijbe, &&op_call,
+        &&op_ret, &&op_rebase, &&op_vector, &&op_halt, &&op_trap
+    };
+#endif
+
+    DISPATCH();
+
+#ifndef REGISTER_COMPUTED_GOTO
+dispatch:
+#endif
+    switch (ins->opcode) {
+        case R_MOVE:
+        HANDLER(op_move)
+            RESULT(ins->dst) = VALUE(ins->left);
+            ins++;
+            DISPATCH();
+        case R_ADD:
+        HANDLER(op_add)
+            BINARY_OPERATION(+);
+        case R_SUB:
+        HANDLER(op_sub)
+            BINARY_OPERATION(-);
+        case R_MUL:
+        HANDLER(op_mul)
+            BINARY_OPERATION(*);
+        case R_DIV:
+        HANDLER(op_div)
+            BINARY_OPERATION(/);
+        case R_SIN:
+        HANDLER(op_sin)
+            UNARY_OPERATION(std::sin(left));
+        case R_COS:
+        HANDLER(op_cos)
+            UNARY_OPERATION(std::cos(left));
+        case R_SQRT:
+        HANDLER(op_sqrt)
+            UNARY_OPERATION(std::sqrt(left));
+        case R_IADD:
+        HANDLER(op_iadd)
+            INTEGER_BINARY_OPERATION(IntegerOperations::add(ileft, iright));
+        case R_ISUB:
+        HANDLER(op_isub)
+            INTEGER_BINARY_OPERATION(IntegerOperations::sub(ileft, iright));
+        case R_IMUL:
+        HANDLER(op_imul)
+            INTEGER_BINARY_OPERATION(IntegerOperations::mul(ileft, iright));
+        case R_IDIV:
+        HANDLER(op_idiv)
+            INTEGER_DIVISION(div);
+        case R_IREM:
+        HANDLER(op_irem)
+            INTEGER_DIVISION(rem);
+        case R_IAND:
+        HANDLER(op_iand)
+            INTEGER_BINARY_OPERATION(ileft & iright);
+        case R_IOR:
+        HANDLER(op_ior)
+            INTEGER_BINARY_OPERATION(ileft | iright);
+        case R_IXOR:
+        HANDLER(op_ixor)
+            INTEGER_BINARY_OPERATION(ileft ^ iright);
+        case R_ISHL:
+        HANDLER(op_ishl)
+            INTEGER_BINARY_OPERATION(IntegerOperations::shiftLeft(ileft, iright));
+        case R_ISHR:
+        HANDLER(op_ishr)
+            INTEGER_BINARY_OPERATION(IntegerOperations::shiftRight(ileft, iright));
+        case R_ITOD:
+        HANDLER(op_itod)
+            UNARY_OPERATION(static_cast<double>(IntegerOperations::getBits(left)));
+        case R_DTOI:
+        HANDLER(op_dtoi)
+            UNARY_OPERATION(IntegerOperations::fromBits(IntegerOperations::truncate(left)));
+        case R_IN:
+        HANDLER(op_in)
+            RESULT(ins->dst) = processor.readInput();
+            ins++;
+            DISPATCH();
+        case R_OUT:
+        HANDLER(op_out)
+            processor.writeOutput(VALUE(ins->left));
+            ins++;
+            DISPATCH();
+        case R_LOAD:
+        HANDLER(op_load)
+            RESULT(ins->dst) = ram.load(ins->arg);
+            ins++;
+            DISPATCH();
+        case R_LOAD_REG:
+        HANDLER(op_load_reg)
+            if (!ram.isValidAddr(INTEGER(ins->left)))
+                EXIT(0, ProcessorStatus::INVALID_RAM_ADDRESS);
+            addr = INTEGER(ins->left);
+            RESULT(ins->dst) = ram.load(addr);
+            ins++;
+            DISPATCH();
+        case R_STORE:
+        HANDLER(op_store)
+            ram.store(VALUE(ins->left), ins->arg);
+            ins++;
+            DISPATCH();
+        case R_STORE_REG:
+        HANDLER(op_store_reg)
+            if (!ram.isValidAddr(INTEGER(ins->right)))
+                EXIT(0, ProcessorStatus::INVALID_RAM_ADDRESS);
+            addr = INTEGER(ins->right);
+            ram.store(VALUE(ins->left), addr);
+            ins++;
+            DISPATCH();
+        case R_JMP:
+        HANDLER(op_jmp)
+            ins = code + ins->arg;
+            DISPATCH();
+        case R_JE:
+        HANDLER(op_je)
+            CONDITIONAL_JUMP(JE);
+        case R_JNE:
+        HANDLER(op_jne)
+            CONDITIONAL_JUMP(JNE);
+        case R_JA:
+        HANDLER(op_ja)
+            CONDITIONAL_JUMP(JA);
+        case R_JAE:
+        HANDLER(op_jae)
+            CONDITIONAL_JUMP(JAE);
+        case R_JB:
+        HANDLER(op_jb)
+            CONDITIONAL_JUMP(JB);
+        case R_JBE:
+        HANDLER(op_jbe)
+            CONDITIONAL_JUMP(JBE);
+        case R_IJE:
+        HANDLER(op_ije)
+            INTEGER_CONDITIONAL_JUMP(==);
+        case R_IJNE:
+        HANDLER(op_ijne)
+            INTEGER_CONDITIONAL_JUMP(!=);
+        case R_IJA:
+        HANDLER(op_ija)
+            INTEGER_CONDITIONAL_JUMP(>);
+        case R_IJAE:
+        HANDLER(op_ijae)
+            INTEGER_CONDITIONAL_JUMP(>=);
+        case R_IJB:
+        HANDLER(op_ijb)
+            INTEGER_CONDITIONAL_JUMP(<);
+        case R_IJBE:
+        HANDLER(op_ijbe)
+            INTEGER_CONDITIONAL_JUMP(<=);
+        case R_CALL:
+        HANDLER(op_call)
+            //A callee that may overflow the data stack runs in the interpreter, which stops at the right push
+            if (base + ins->right > limit)
+                HAND_OVER(ins->dst, ins->index);
+            processor._call_stack.push_back(ins - code + 1);
+            if (frames)
+                processor._frame_stack.push_back(base - stackBase);
+            base += ins->left;
+            ins = code + ins->arg;
+            DISPATCH();
+        case R_RET:
+        HANDLER(op_ret)
+            ins = code + processor._call_stack.back();
+            processor._call_stack.pop_back();
+            if (frames)
+                processor._frame_stack.pop_back();
+            base -= ins[-1].left;
+            DISPATCH();
+        case R_REBASE:
+        HANDLER(op_rebase)
+            if (base + ins->right > limit)
+                HAND_OVER(ins->left, ins->index);
+            base += ins->dst;
+            ins = code + ins->arg;
+            DISPATCH();
+        case R_VECTOR:
+        HANDLER(op_vector)
+            sp = base + ins->dst;
+            status = processor.executeVectorOperation(ins->arg, sp);
+            if (status != ProcessorStatus::SUCCESS)
+                EXIT(ins->dst, status);
+            ins++;
+            DISPATCH();
+        case R_HALT:
+        HANDLER(op_halt)
+            EXIT(ins->dst, ProcessorStatus::SUCCESS);
+        case R_TRAP:
+        HANDLER(op_trap)
+            EXIT(ins->dst, static_cast<ProcessorStatus>(ins->arg));
+        default:
+            EXIT(0, ProcessorStatus::UNRECOGNIZED_COMMAND);
+    }
+}
+
+#undef INTEGER_CONDITIONAL_JUMP
+#undef CONDITIONAL_JUMP
+#undef CONDITION_JBE
+#undef CONDITION_JB
+#undef CONDITION_JAE
+#undef CONDITION_JA
+#undef CONDITION_JNE
+#undef CONDITION_JE
+#undef INTEGER_DIVISION
+#undef INTEGER_BINARY_OPERATION
+#undef UNARY_OPERATION
+#undef BINARY_OPERATION
+#undef HAND_OVER
+#undef EXIT
+#undef INTEGER
+#undef RESULT
+#undef VALUE
+#undef DISPATCH
+#undef HANDLER
@@ -0,0 +1,115 @@
+#ifndef STACK_PROCESSOR_REGISTERMACHINE_H
+#define STACK_PROCESSOR_REGISTERMACHINE_H
+#include "../utils.h"
+#include "Decoder.h"
+#include "Verifier.h"
+#include <string>
+#include <vector>
+
+class Processor;
+
+//Operations of register code, operands are described next to RegisterInstruction
+enum RegisterOperationCode {
+    R_MOVE = 0, //dst = left
+    R_ADD, //dst = left op right, the same for every binary operation
+    R_SUB,
+    R_MUL,
+    R_DIV,
+    R_SIN, //dst = op left
+    R_COS,
+    R_SQRT,
+    R_IADD,
+    R_ISUB,
+    R_IMUL,
+    R_IDIV,
+    R_IREM,
+    R_IAND,
+    R_IOR,
+    R_IXOR,
+    R_ISHL,
+    R_ISHR,
+    R_ITOD,
+    R_DTOI,
+    R_IN, //dst = value read
+    R_OUT, //Writes left
+    R_LOAD, //dst = RAM at address arg
+    R_LOAD_REG, //dst = RAM at the address in register left
+    R_STORE, //RAM at address arg = left
+    R_STORE_REG, //RAM at the address in register right = left
+    R_JMP, //Continues at arg
+    R_JE, //Continues at arg if the condition holds for left and right, the same for every conditional jump
+    R_JNE,
+    R_JA,
+    R_JAE,
+    R_JB,
+    R_JBE,
+    R_IJE,
+    R_IJNE,
+    R_IJA,
+    R_IJAE,
+    R_IJB,
+    R_IJBE,
+    R_CALL, //Calls arg with dst values on the stack, the callee frame starts at slot left and needs right slots
+    R_RET, //Returns after the call, moving the frame back by its left
+    R_REBASE, //Moves the frame by dst slots and continues at arg, left values are on the stack and right slots are needed
+    R_VECTOR, //Vector instruction arg on the dst values on the stack
+    R_HALT, //Stops with dst values on the stack
+    R_TRAP, //Stops with ProcessorStatus arg
+    R_OPERATION_COUNT
+};
+
+//Operands are data stack slots relative to the frame of the running function, so slot -1 is the
+//last value pushed by the caller. Operands from FIXED_OPERAND on name the registers ax..dx and
+//then the constants of the program instead.
+struct RegisterInstruction {
+    unsigned char opcode;
+    int dst;
+    int left;
+    int right;
+    int arg; //Target instruction, RAM address, vector opcode or trap status
+    int index; //Decoded instruction it was translated from
+};
+
+//Register machine backend. Translates a verified stack program into three-address code where
+//every data stack slot at a depth known at load time is a virtual register, pushes of registers
+//and constants are folded into the operands of the instructions consuming them. The stack stays
+//in Processor memory, so a call or a frame the code cannot check for overflow hands the same state
+//over to the interpreter, which continues from the same decoded instruction.
+class RegisterMachine {
+private:
+    friend class RegisterTranslator;
+
+    std::vector<RegisterInstruction> _code;
+    //Registers followed by the constants
+    std::vector<double> _fixed;
+    int _mainDepth;
+    bool _frames;
+    int _translatedCount;
+
+    ProcessorStatus execute(Processor &processor, int &resumeIndex);
+    //The call stack holds register code positions while the translated code runs, turns them
+    //back into the decoded instructions the interpreter returns to
+    void restoreCallStack(Processor &processor) const;
+
+public:
+    static constexpr int FIXED_OPERAND = 1 << 30;
+
+    RegisterMachine();
+
+    //Expects a verified program that was not fused with its function summaries. Returns false
+    //and sets diagnostic if the program cannot be translated
+    bool translate(const DecodedProgram &program, const std::vector<FunctionSummary> &functions,
+                   std::string &diagnostic);
+
+    //Runs the translated program on the processor state, hand-overs resume processor's own
+    //program, which must have the same instruction indices as the translated one. Registers and
+    //the data stack are not kept when the program stops with an error
+    ProcessorStatus run(Processor &processor);
+
+    //Decoded instructions reachable in the translated program
+    int getTranslatedCount() const;
+
+    int getInstructionCount() const;
+};
+
+#endif //STACK_PROCESSOR_REGISTERMACHINE_H
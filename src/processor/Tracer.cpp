@@ -0,0 +1,126 @@
+#include "Tracer.h"
+#include "Fusion.h"
+
+Tracer::Tracer(const DecodedProgram &program, bool fusion): _original(program.instructions),
+    _counters(program.instructions.size(), 0), _fusion(fusion), _recordedAnchor(-1) {
+}
+
+const std::vector<Trace> &Tracer::getTraces() const {
+    return _traces;
+}
+
+bool Tracer::record(DecodedProgram &program, int index) {
+    if (!_path.empty() && index == _recordedAnchor) {
+        finish(program, true, index);
+        return false;
+    }
+
+    //Traces end where execution stops, another trace starts or the cache decides where a memoized call goes
+    unsigned char opcode = program.instructions[index].opcode;
+    if (opcode == OperationPrefixCode::HALT || opcode == InternalOperationCode::TRAP ||
+        opcode == InternalOperationCode::TRACE_ENTER || opcode == InternalOperationCode::CALL_MEMO ||
+        opcode == InternalOperationCode::MEMO_RETURN || static_cast<int>(_path.size()) >= MAX_TRACE_LENGTH) {
+        if (_path.empty()) {
+            _counters[_recordedAnchor] = -1;
+            _recordedAnchor = -1;
+        } else {
+            finish(program, false, index);
+        }
+        return false;
+    }
+
+    _path.push_back(index);
+    return true;
+}
+
+void Tracer::expand(int index, int length, int next, std::vector<DecodedInstruction> &trace) const {
+    for (int i = index; i < index + length; i++) {
+        DecodedInstruction instruction = _original[i];
+        switch (instruction.opcode) {
+            case OperationPrefixCode::JMP_OFFSET_EXACT_VAL:
+                break;
+            case OperationPrefixCode::CALL_OFFSET_EXACT_VAL:
+                instruction.opcode = InternalOperationCode::TRACE_CALL;
+                instruction.arg = i + 1;
+                trace.push_back(instruction);
+                break;
+            case OperationPrefixCode::RET_ABS:
+                instruction.opcode = InternalOperationCode::TRACE_RET;
+                instruction.arg = next;
+                trace.push_back(instruction);
+                break;
+            case OperationPrefixCode::JE_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::JNE_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::JA_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::JAE_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::JB_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::JBE_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::IJE_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::IJNE_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::IJA_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::IJAE_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::IJB_OFFSET_EXACT_VAL:
+            case OperationPrefixCode::IJBE_OFFSET_EXACT_VAL:
+                //A superinstruction only falls through past its whole sequence. Jumps recorded as not
+                //taken stay as they are, taking them already leaves the trace
+                if (next == index + length) {
+                    trace.push_back(instruction);
+                    break;
+                }
+                if (instruction.opcode >= OperationPrefixCode::IJE_OFFSET_EXACT_VAL)
+                    instruction.opcode = InternalOperationCode::TRACE_GUARD_IJE +
+                                         (instruction.opcode - OperationPrefixCode::IJE_OFFSET_EXACT_VAL);
+                else
+                    instruction.opcode = InternalOperationCode::TRACE_GUARD_JE +
+                                         (instruction.opcode - OperationPrefixCode::JE_OFFSET_EXACT_VAL);
+                instruction.arg = i + 1;
+                trace.push_back(instruction);
+                return;
+            default:
+                trace.push_back(instruction);
+        }
+    }
+}
+
+void Tracer::finish(DecodedProgram &program, bool loops, int exitIndex) {
+    Trace trace;
+    trace.anchor = _recordedAnchor;
+    trace.offset = program.offsets[_recordedAnchor];
+    trace.entries = 0;
+
+    int length = _path.size();
+    for (int i = 0; i < length; i++) {
+        int index = _path[i];
+        int next = i + 1 < length ? _path[i + 1] : exitIndex;
+        expand(index, Fusion::getFusedLength(program.instructions[index].opcode), next, trace.instructions);
+    }
+
+    DecodedInstruction last = DecodedInstruction();
+    if (loops) {
+        last.opcode = InternalOperationCode::TRACE_LOOP;
+        last.arg = trace.instructions.size();
+    } else {
+        last.opcode = InternalOperationCode::TRACE_EXIT;
+        last.arg = exitIndex;
+    }
+    trace.instructions.push_back(last);
+
+    if (_fusion) {
+        DecodedProgram straightLine;
+        straightLine.instructions.swap(trace.instructions);
+        std::vector<int> firedCounts;
+        std::vector<bool> entryPoints(straightLine.instructions.size(), false);
+        entryPoints[0] = true;
+        Fusion::fuse(straightLine, firedCounts, entryPoints);
+        trace.instructions.swap(straightLine.instructions);
+    }
+
+    DecodedInstruction enter = DecodedInstruction();
+    enter.opcode = InternalOperationCode::TRACE_ENTER;
+    enter.arg = _traces.size();
+    program.instructions[_recordedAnchor] = enter;
+
+    _traces.push_back(std::move(trace));
+    _counters[_recordedAnchor] = -1;
+    _recordedAnchor = -1;
+}
@@ -0,0 +1,62 @@
+#ifndef STACK_PROCESSOR_TRACER_H
+#define STACK_PROCESSOR_TRACER_H
+#include "Decoder.h"
+#include <vector>
+
+struct Trace {
+    int anchor; //Index of the instruction replaced by TRACE_ENTER
+    int offset; //Bytecode offset of the anchor
+    std::vector<DecodedInstruction> instructions;
+    long long entries; //How many times execution entered the trace
+};
+
+//Hot path tier of the interpreter. Back-edge and call targets count how often they are
+//reached, once one gets hot the interpreter reports every instruction it executes until
+//the path returns to the target. The recorded path becomes a straight-line trace where
+//jumps disappear, calls and returns are inlined and conditional jumps turn into guards
+//that leave the trace when they go the other way.
+class Tracer {
+private:
+    //Program as decoded, traces are built from it rather than from the fused program
+    std::vector<DecodedInstruction> _original;
+    //Hotness of every anchor, -1 once it got a trace or its path cannot be traced
+    std::vector<int> _counters;
+    std::vector<Trace> _traces;
+    bool _fusion;
+    int _recordedAnchor;
+    std::vector<int> _path;
+
+    void expand(int index, int length, int next, std::vector<DecodedInstruction> &trace) const;
+
+    //Turns _path into a trace and makes the anchor enter it
+    void finish(DecodedProgram &program, bool loops, int exitIndex);
+
+public:
+    static constexpr int HOT_THRESHOLD = 64;
+    static constexpr int MAX_TRACE_LENGTH = 1024;
+
+    //Expects the program before fusion, traces are fused on their own if fusion is on
+    Tracer(const DecodedProgram &program, bool fusion);
+
+    //Counts one more arrival at anchor, returns true if recording of its trace starts
+    bool countAnchor(int anchor) {
+        if (_counters[anchor] < 0 || _recordedAnchor >= 0 || ++_counters[anchor] < HOT_THRESHOLD)
+            return false;
+        _recordedAnchor = anchor;
+        _path.clear();
+        return true;
+    }
+
+    //Called with every instruction index the interpreter is about to execute while recording,
+    //returns false once recording is over
+    bool record(DecodedProgram &program, int index);
+
+    const DecodedInstruction *enter(int trace) {
+        _traces[trace].entries++;
+        return _traces[trace].instructions.data();
+    }
+
+    const std::vector<Trace> &getTraces() const;
+};
+
+#endif //STACK_PROCESSOR_TRACER_H
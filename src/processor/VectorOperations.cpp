@@ -0,0 +1,308 @@
+#include "VectorOperations.h"
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define VECTOR_X86_KERNELS 1
+#endif
+
+//Reductions keep partial result i % 4 for element i, the lanes of an AVX2 register
+static constexpr int PARTIALS = 4;
+
+static double loadElement(const char *values, int index) {
+    double value;
+    std::memcpy(&value, values + static_cast<size_t>(index) * sizeof (double), sizeof (double));
+    return value;
+}
+
+static void storeElement(char *values, int index, double value) {
+    std::memcpy(values + static_cast<size_t>(index) * sizeof (double), &value, sizeof (double));
+}
+
+static double minimum(double left, double right) {
+    //Same as minpd, the second operand wins if either is NaN
+    return left < right ? left : right;
+}
+
+static double maximum(double left, double right) {
+    return left > right ? left : right;
+}
+
+static void addScalar(char *destination, const char *left, const char *right, int count) {
+    for (int i = 0; i < count; i++)
+        storeElement(destination, i, loadElement(left, i) + loadElement(right, i));
+}
+
+static void mulScalar(char *destination, const char *left, const char *right, int count) {
+    for (int i = 0; i < count; i++)
+        storeElement(destination, i, loadElement(left, i) * loadElement(right, i));
+}
+
+static void fmaScalar(char *destination, const char *left, const char *right, int count) {
+    for (int i = 0; i < count; i++) {
+        double sum = std::fma(loadElement(left, i), loadElement(right, i), loadElement(destination, i));
+        storeElement(destination, i, sum);
+    }
+}
+
+//Reductions continue from element start with the partial results of the elements before it
+static double sumFrom(double *partial, const char *values, int start, int count) {
+    for (int i = start; i < count; i++)
+        partial[i % PARTIALS] += loadElement(values, i);
+    return (partial[0] + partial[1]) + (partial[2] + partial[3]);
+}
+
+static double minFrom(double *partial, const char *values, int start, int count) {
+    for (int i = start; i < count; i++)
+        partial[i % PARTIALS] = minimum(partial[i % PARTIALS], loadElement(values, i));
+    return minimum(minimum(partial[0], partial[1]), minimum(partial[2], partial[3]));
+}
+
+static double maxFrom(double *partial, const char *values, int start, int count) {
+    for (int i = start; i < count; i++)
+        partial[i % PARTIALS] = maximum(partial[i % PARTIALS], loadElement(values, i));
+    return maximum(maximum(partial[0], partial[1]), maximum(partial[2], partial[3]));
+}
+
+static double dotFrom(double *partial, const char *left, const char *right, int start, int count) {
+    for (int i = start; i < count; i++)
+        partial[i % PARTIALS] = std::fma(loadElement(left, i), loadElement(right, i), partial[i % PARTIALS]);
+    return (partial[0] + partial[1]) + (partial[2] + partial[3]);
+}
+
+static double sumScalar(const char *values, int count) {
+    double partial[PARTIALS] = {0.0, 0.0, 0.0, 0.0};
+    return sumFrom(partial, values, 0, count);
+}
+
+static double minScalar(const char *values, int count) {
+    double infinity = std::numeric_limits<double>::infinity();
+    double partial[PARTIALS] = {infinity, infinity, infinity, infinity};
+    return minFrom(partial, values, 0, count);
+}
+
+static double maxScalar(const char *values, int count) {
+    double infinity = -std::numeric_limits<double>::infinity();
+    double partial[PARTIALS] = {infinity, infinity, infinity, infinity};
+    return maxFrom(partial, values, 0, count);
+}
+
+static double dotScalar(const char *left, const char *right, int count) {
+    double partial[PARTIALS] = {0.0, 0.0, 0.0, 0.0};
+    return dotFrom(partial, left, right, 0, count);
+}
+
+static const VectorKernels SCALAR_KERNELS = {"scalar", addScalar, mulScalar, fmaScalar, sumScalar, minScalar,
+                                             maxScalar, dotScalar};
+
+#ifdef VECTOR_X86_KERNELS
+
+#define VECTOR_AT(values, i) reinterpret_cast<const double*>((values) + static_cast<size_t>(i) * sizeof (double))
+
+//Four elements at a time, the tail goes through the scalar kernel
+#define AVX2_BINARY_KERNEL(name, op) \
+__attribute__((target("avx2,fma"))) static void name##Avx2(char *destination, const char *left, \
+                                                           const char *right, int count) { \
+    int i = 0; \
+    for (; i + PARTIALS <= count; i += PARTIALS) { \
+        __m256d result = op(_mm256_loadu_pd(VECTOR_AT(left, i)), _mm256_loadu_pd(VECTOR_AT(right, i))); \
+        _mm256_storeu_pd(const_cast<double*>(VECTOR_AT(destination, i)), result); \
+    } \
+    name##Scalar(destination + static_cast<size_t>(i) * sizeof (double), \
+                 left + static_cast<size_t>(i) * sizeof (double), \
+                 right + static_cast<size_t>(i) * sizeof (double), count - i); \
+}
+
+#define AVX2_REDUCTION_KERNEL(name, initial, op) \
+__attribute__((target("avx2,fma"))) static double name##Avx2(const char *values, int count) { \
+    __m256d accumulator = _mm256_set1_pd(initial); \
+    int i = 0; \
+    for (; i + PARTIALS <= count; i += PARTIALS) \
+        accumulator = op(accumulator, _mm256_loadu_pd(VECTOR_AT(values, i))); \
+    double partial[PARTIALS]; \
+    _mm256_storeu_pd(partial, accumulator); \
+    return name##From(partial, values, i, count); \
+}
+
+AVX2_BINARY_KERNEL(add, _mm256_add_pd)
+AVX2_BINARY_KERNEL(mul, _mm256_mul_pd)
+
+__attribute__((target("avx2,fma"))) static void fmaAvx2(char *destination, const char *left, const char *right,
+                                                        int count) {
+    int i = 0;
+    for (; i + PARTIALS <= count; i += PARTIALS) {
+        double *result = const_cast<double*>(VECTOR_AT(destination, i));
+        __m256d sum = _mm256_fmadd_pd(_mm256_loadu_pd(VECTOR_AT(left, i)), _mm256_loadu_pd(VECTOR_AT(right, i)),
+                                      _mm256_loadu_pd(result));
+        _mm256_storeu_pd(result, sum);
+    }
+    fmaScalar(destination + static_cast<size_t>(i) * sizeof (double),
+              left + static_cast<size_t>(i) * sizeof (double),
+              right + static_cast<size_t>(i) * sizeof (double), count - i);
+}
+
+AVX2_REDUCTION_KERNEL(sum, 0.0, _mm256_add_pd)
+AVX2_REDUCTION_KERNEL(min, std::numeric_limits<double>::infinity(), _mm256_min_pd)
+AVX2_REDUCTION_KERNEL(max, -std::numeric_limits<double>::infinity(), _mm256_max_pd)
+
+__attribute__((target("avx2,fma"))) static double dotAvx2(const char *left, const char *right, int count) {
+    __m256d accumulator = _mm256_setzero_pd();
+    int i = 0;
+    for (; i + PARTIALS <= count; i += PARTIALS)
+        accumulator = _mm256_fmadd_pd(_mm256_loadu_pd(VECTOR_AT(left, i)), _mm256_loadu_pd(VECTOR_AT(right, i)),
+                                      accumulator);
+    double partial[PARTIALS];
+    _mm256_storeu_pd(partial, accumulator);
+    return dotFrom(partial, left, right, i, count);
+}
+
+#undef AVX2_REDUCTION_KERNEL
+#undef AVX2_BINARY_KERNEL
+#undef VECTOR_AT
+
+static const VectorKernels AVX2_KERNELS = {"avx2", addAvx2, mulAvx2, fmaAvx2, sumAvx2, minAvx2, maxAvx2, dotAvx2};
+
+#endif
+
+const VectorKernels &VectorOperations::selectKernels() {
+#ifdef VECTOR_X86_KERNELS
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return AVX2_KERNELS;
+#endif
+    return SCALAR_KERNELS;
+}
+
+const VectorKernels &VectorOperations::getKernels() {
+    static const VectorKernels &kernels = selectKernels();
+    return kernels;
+}
+
+bool VectorOperations::isVectorOperation(unsigned char opcode) {
+    return opcode >= OperationPrefixCode::VADD && opcode <= OperationPrefixCode::VCOPY;
+}
+
+void VectorOperations::getStackEffect(unsigned char opcode, int &needed, int &pushed) {
+    needed = 0;
+    pushed = 0;
+    switch (opcode) {
+        case OperationPrefixCode::VADD:
+        case OperationPrefixCode::VMUL:
+        case OperationPrefixCode::VFMA:
+            needed = 4;
+            break;
+        case OperationPrefixCode::VSUM:
+        case OperationPrefixCode::VMIN:
+        case OperationPrefixCode::VMAX:
+            needed = 2;
+            pushed = 1;
+            break;
+        case OperationPrefixCode::VDOT:
+            needed = 3;
+            pushed = 1;
+            break;
+        case OperationPrefixCode::VFILL:
+        case OperationPrefixCode::VCOPY:
+            needed = 3;
+            break;
+    }
+}
+
+bool VectorOperations::getRange(double operand, int count, int memorySize, int &address) {
+    if (!(operand >= 0 && operand <= memorySize))
+        return false;
+    address = static_cast<int>(operand);
+    return address == operand &&
+           address + static_cast<long long>(count) * static_cast<long long>(sizeof (double)) <= memorySize;
+}
+
+bool VectorOperations::decode(unsigned char opcode, const double *operands, int memorySize,
+                              VectorArguments &arguments) {
+    int needed, pushed;
+    getStackEffect(opcode, needed, pushed);
+    double length = operands[needed - 1];
+    if (!(length >= 0 && length <= memorySize))
+        return false;
+    arguments.opcode = opcode;
+    arguments.count = static_cast<int>(length);
+    if (arguments.count != length)
+        return false;
+
+    arguments.destination = -1;
+    arguments.sources[0] = -1;
+    arguments.sources[1] = -1;
+    arguments.value = 0.0;
+    int count = arguments.count;
+    switch (opcode) {
+        case OperationPrefixCode::VADD:
+        case OperationPrefixCode::VMUL:
+        case OperationPrefixCode::VFMA:
+            return getRange(operands[0], count, memorySize, arguments.destination) &&
+                   getRange(operands[1], count, memorySize, arguments.sources[0]) &&
+                   getRange(operands[2], count, memorySize, arguments.sources[1]);
+        case OperationPrefixCode::VDOT:
+            return getRange(operands[0], count, memorySize, arguments.sources[0]) &&
+                   getRange(operands[1], count, memorySize, arguments.sources[1]);
+        case OperationPrefixCode::VFILL:
+            arguments.value = operands[1];
+            return getRange(operands[0], count, memorySize, arguments.destination);
+        case OperationPrefixCode::VCOPY:
+            return getRange(operands[0], count, memorySize, arguments.destination) &&
+                   getRange(operands[1], count, memorySize, arguments.sources[0]);
+        default:
+            return getRange(operands[0], count, memorySize, arguments.sources[0]);
+    }
+}
+
+double VectorOperations::apply(const VectorArguments &arguments, char *memory) {
+    const VectorKernels &kernels = getKernels();
+    size_t bytes = static_cast<size_t>(arguments.count) * sizeof (double);
+    char *destination = arguments.destination >= 0 ? memory + arguments.destination : nullptr;
+    const char *sources[2] = {nullptr, nullptr};
+    std::vector<char> copies[2];
+    for (int i = 0; i < 2; i++) {
+        int source = arguments.sources[i];
+        if (source < 0)
+            continue;
+        sources[i] = memory + source;
+        //Writing the destination would change elements of the source that are still to be read,
+        //memmove already takes care of that for copies
+        bool overlaps = destination != nullptr && source != arguments.destination &&
+                        source < arguments.destination + static_cast<long long>(bytes) &&
+                        arguments.destination < source + static_cast<long long>(bytes);
+        if (overlaps && arguments.opcode != OperationPrefixCode::VCOPY) {
+            copies[i].assign(sources[i], sources[i] + bytes);
+            sources[i] = copies[i].data();
+        }
+    }
+
+    int count = arguments.count;
+    switch (arguments.opcode) {
+        case OperationPrefixCode::VADD:
+            kernels.add(destination, sources[0], sources[1], count);
+            return 0.0;
+        case OperationPrefixCode::VMUL:
+            kernels.mul(destination, sources[0], sources[1], count);
+            return 0.0;
+        case OperationPrefixCode::VFMA:
+            kernels.fma(destination, sources[0], sources[1], count);
+            return 0.0;
+        case OperationPrefixCode::VSUM:
+            return kernels.sum(sources[0], count);
+        case OperationPrefixCode::VMIN:
+            return kernels.min(sources[0], count);
+        case OperationPrefixCode::VMAX:
+            return kernels.max(sources[0], count);
+        case OperationPrefixCode::VDOT:
+            return kernels.dot(sources[0], sources[1], count);
+        case OperationPrefixCode::VFILL:
+            for (int i = 0; i < count; i++)
+                storeElement(destination, i, arguments.value);
+            return 0.0;
+        default:
+            std::memmove(destination, sources[0], bytes);
+            return 0.0;
+    }
+}
@@ -0,0 +1,54 @@
+#ifndef STACK_PROCESSOR_VECTOR_OPERATIONS_H
+#define STACK_PROCESSOR_VECTOR_OPERATIONS_H
+#include "../utils.h"
+
+//Loops over arrays of doubles at any byte address, picked once for the instruction set of the
+//running CPU. All of them give the same results bit for bit: reductions keep four partial results
+//combined in the same order on every instruction set and fma is always fused
+struct VectorKernels {
+    const char *name;
+    void (*add)(char *destination, const char *left, const char *right, int count);
+    void (*mul)(char *destination, const char *left, const char *right, int count);
+    //destination += left * right
+    void (*fma)(char *destination, const char *left, const char *right, int count);
+    double (*sum)(const char *values, int count);
+    double (*min)(const char *values, int count);
+    double (*max)(const char *values, int count);
+    double (*dot)(const char *left, const char *right, int count);
+};
+
+//Operands of one vector instruction taken from the data stack, addresses are RAM byte addresses
+struct VectorArguments {
+    unsigned char opcode;
+    int destination; //-1 for reductions
+    int sources[2]; //-1 if unused
+    int count;
+    double value; //Fill value
+};
+
+//Instructions over (address, length) ranges of RAM. Every range has to lie inside RAM, sources
+//that partially overlap the destination are read as they were before the instruction
+class VectorOperations {
+private:
+    static const VectorKernels &selectKernels();
+
+    //Fills address with the address operand if it is a whole number and count doubles fit at it
+    static bool getRange(double operand, int count, int memorySize, int &address);
+
+public:
+    static bool isVectorOperation(unsigned char opcode);
+
+    //Values the instruction pops from the data stack and pushes back
+    static void getStackEffect(unsigned char opcode, int &needed, int &pushed);
+
+    static const VectorKernels &getKernels();
+
+    //operands points to the values popped by the instruction, deepest first. Returns false
+    //if a length or address is not a whole number or a range does not fit in memorySize bytes
+    static bool decode(unsigned char opcode, const double *operands, int memorySize, VectorArguments &arguments);
+
+    //Runs decoded arguments on memory, returns the result of reductions
+    static double apply(const VectorArguments &arguments, char *memory);
+};
+
+#endif //STACK_PROCESSOR_VECTOR_OPERATIONS_H
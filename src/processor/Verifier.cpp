@@ -0,0 +1,270 @@
+#include "Verifier.h"
+#include "VectorOperations.h"
+#include <algorithm>
+
+//Fixed point over mutually recursive functions normally settles in a few rounds,
+//a requirement that keeps growing means recursion consumes the caller's stack
+static constexpr int MAX_ROUNDS = 64;
+
+Verifier::Verifier(const DecodedProgram &program, std::string &diagnostic): _program(program),
+    _functionByEntry(program.instructions.size(), -1), _depth(program.instructions.size(), 0),
+    _visited(program.instructions.size(), -1), _stamp(0), _diagnostic(diagnostic) {
+}
+
+void Verifier::getStackEffect(unsigned char opcode, int &needed, int &pushed) {
+    needed = 0;
+    pushed = 0;
+    switch (opcode) {
+        case OperationPrefixCode::IN:
+        case OperationPrefixCode::PUSH_REG_VAL:
+        case OperationPrefixCode::PUSH_EXACT_VAL:
+        case OperationPrefixCode::PUSH_REG_ADDR:
+        case OperationPrefixCode::PUSH_EXACT_ADDR:
+        case OperationPrefixCode::PUSH_FRAME_SLOT:
+            pushed = 1;
+            break;
+        case OperationPrefixCode::OUT:
+        case OperationPrefixCode::POP:
+        case OperationPrefixCode::POP_REG_VAL:
+        case OperationPrefixCode::POP_EXACT_ADDR:
+        case OperationPrefixCode::POP_REG_ADDR:
+        case OperationPrefixCode::POP_FRAME_SLOT:
+            needed = 1;
+            break;
+        case OperationPrefixCode::ADD:
+        case OperationPrefixCode::SUB:
+        case OperationPrefixCode::MUL:
+        case OperationPrefixCode::DIV:
+        case OperationPrefixCode::IADD:
+        case OperationPrefixCode::ISUB:
+        case OperationPrefixCode::IMUL:
+        case OperationPrefixCode::IDIV:
+        case OperationPrefixCode::IREM:
+        case OperationPrefixCode::IAND:
+        case OperationPrefixCode::IOR:
+        case OperationPrefixCode::IXOR:
+        case OperationPrefixCode::ISHL:
+        case OperationPrefixCode::ISHR:
+            needed = 2;
+            pushed = 1;
+            break;
+        case OperationPrefixCode::SIN:
+        case OperationPrefixCode::COS:
+        case OperationPrefixCode::SQRT:
+        case OperationPrefixCode::ITOD:
+        case OperationPrefixCode::DTOI:
+            needed = 1;
+            pushed = 1;
+            break;
+        case OperationPrefixCode::JE_OFFSET_EXACT_VAL:
+        case OperationPrefixCode::JNE_OFFSET_EXACT_VAL:
+        case OperationPrefixCode::JA_OFFSET_EXACT_VAL:
+        case OperationPrefixCode::JAE_OFFSET_EXACT_VAL:
+        case OperationPrefixCode::JB_OFFSET_EXACT_VAL:
+        case OperationPrefixCode::JBE_OFFSET_EXACT_VAL:
+        case OperationPrefixCode::IJE_OFFSET_EXACT_VAL:
+        case OperationPrefixCode::IJNE_OFFSET_EXACT_VAL:
+        case OperationPrefixCode::IJA_OFFSET_EXACT_VAL:
+        case OperationPrefixCode::IJAE_OFFSET_EXACT_VAL:
+        case OperationPrefixCode::IJB_OFFSET_EXACT_VAL:
+        case OperationPrefixCode::IJBE_OFFSET_EXACT_VAL:
+            needed = 2;
+            pushed = 2;
+            break;
+        default:
+            if (VectorOperations::isVectorOperation(opcode))
+                VectorOperations::getStackEffect(opcode, needed, pushed);
+    }
+}
+
+bool Verifier::fail(int index, const std::string &message) {
+    int offset = _program.offsets[index];
+    if (offset >= 0)
+        _diagnostic = Decoder::describeOffset(_program, offset) + ": " + message;
+    else
+        _diagnostic = "end of code: " + message;
+    return false;
+}
+
+int Verifier::getFunction(int entry) {
+    if (_functionByEntry[entry] == -1) {
+        FunctionSummary summary;
+        summary.entry = entry;
+        summary.required = 0;
+        summary.returns = false;
+        summary.effect = 0;
+        _functionByEntry[entry] = _functions.size();
+        _functions.push_back(summary);
+    }
+    return _functionByEntry[entry];
+}
+
+bool Verifier::checkTrap(int index) {
+    const DecodedInstruction &instruction = _program.instructions[index];
+    switch (instruction.arg) {
+        case ProcessorStatus::UNRECOGNIZED_COMMAND:
+            return fail(index, "unrecognized command");
+        case ProcessorStatus::COMMAND_ARG_ERROR:
+            return fail(index, "invalid or truncated operand");
+        case ProcessorStatus::INVALID_RAM_ADDRESS:
+            return fail(index, "constant RAM address is out of range");
+        case ProcessorStatus::INVALID_INSTRUCTION_POINTER:
+            return fail(index, "not taken conditional jump at the end of code");
+        default:
+            return true;
+    }
+}
+
+bool Verifier::analyzeFunction(int function, bool &changed) {
+    const std::vector<DecodedInstruction> &code = _program.instructions;
+    int entry = _functions[function].entry;
+    bool isMain = function == 0;
+
+    int required = 0;
+    bool returns = false;
+    int effect = 0;
+
+    int stamp = ++_stamp;
+    std::vector<int> worklist;
+    _visited[entry] = stamp;
+    _depth[entry] = 0;
+    worklist.push_back(entry);
+
+    //Registers depth of the instruction reached from instruction from
+    auto propagate = [&](int from, int to, int depth, bool isJump) {
+        const DecodedInstruction &target = code[to];
+        if (isJump && target.opcode == InternalOperationCode::TRAP &&
+            target.arg == ProcessorStatus::INVALID_INSTRUCTION_POINTER)
+            return fail(from, "jump target is outside of code");
+        if (_visited[to] != stamp) {
+            _visited[to] = stamp;
+            _depth[to] = depth;
+            worklist.push_back(to);
+        } else if (_depth[to] != depth) {
+            return fail(to, "data stack depth differs between paths: " + std::to_string(_depth[to]) +
+                            " and " + std::to_string(depth) + " relative to function entry");
+        }
+        return true;
+    };
+
+    auto require = [&](int index, int needed, int depth) {
+        if (needed - depth <= required)
+            return true;
+        if (isMain)
+            return fail(index, "data stack may underflow");
+        required = needed - depth;
+        return true;
+    };
+
+    while (!worklist.empty()) {
+        int index = worklist.back();
+        worklist.pop_back();
+        const DecodedInstruction &instruction = code[index];
+        int depth = _depth[index];
+
+        switch (instruction.opcode) {
+            case InternalOperationCode::TRAP:
+                if (!checkTrap(index))
+                    return false;
+                break;
+            case OperationPrefixCode::HALT:
+                break;
+            case OperationPrefixCode::RET_ABS:
+                if (isMain)
+                    return fail(index, "ret is reachable outside of any called function");
+                if (!returns) {
+                    returns = true;
+                    effect = depth;
+                } else if (effect != depth) {
+                    return fail(index, "function returns with data stack depth " + std::to_string(depth) +
+                                       " on one path and " + std::to_string(effect) + " on another");
+                }
+                break;
+            case OperationPrefixCode::JMP_OFFSET_EXACT_VAL:
+                if (!propagate(index, instruction.arg, depth, true))
+                    return false;
+                break;
+            case OperationPrefixCode::CALL_OFFSET_EXACT_VAL: {
+                const DecodedInstruction &target = code[instruction.arg];
+                if (target.opcode == InternalOperationCode::TRAP &&
+                    target.arg == ProcessorStatus::INVALID_INSTRUCTION_POINTER)
+                    return fail(index, "call target is outside of code");
+                int callee = getFunction(instruction.arg);
+                if (!require(index, _functions[callee].required, depth))
+                    return false;
+                //Code after the call is reached once the callee is known to return
+                if (_functions[callee].returns &&
+                    !propagate(index, index + 1, depth + _functions[callee].effect, false))
+                    return false;
+                break;
+            }
+            case OperationPrefixCode::PUSH_FRAME_SLOT:
+            case OperationPrefixCode::POP_FRAME_SLOT: {
+                //Frame pointer is the depth at function entry, so the slot is relative to it as well
+                int slot = instruction.arg;
+                bool pops = instruction.opcode == OperationPrefixCode::POP_FRAME_SLOT;
+                int top = pops ? depth - 1 : depth;
+                if (slot >= top)
+                    return fail(index, "frame slot " + std::to_string(slot) + " is above the top of the data stack");
+                if (!require(index, std::max(depth - slot, pops ? 1 : 0), depth))
+                    return false;
+                if (!propagate(index, index + 1, pops ? depth - 1 : depth + 1, false))
+                    return false;
+                break;
+            }
+            default: {
+                if (!Decoder::isCommand(instruction.opcode))
+                    return fail(index, "cannot verify internal opcode");
+                bool isConditional = Decoder::isConditionalJump(instruction.opcode);
+
+                int needed, pushed;
+                getStackEffect(instruction.opcode, needed, pushed);
+                if (!require(index, needed, depth))
+                    return false;
+                if (isConditional && !propagate(index, instruction.arg, depth, true))
+                    return false;
+                if (!propagate(index, index + 1, depth - needed + pushed, false))
+                    return false;
+            }
+        }
+    }
+
+    FunctionSummary &summary = _functions[function];
+    if (summary.required != required || summary.returns != returns || summary.effect != effect)
+        changed = true;
+    summary.required = required;
+    summary.returns = returns;
+    summary.effect = effect;
+    return true;
+}
+
+bool Verifier::verify(const DecodedProgram &program, std::string &diagnostic) {
+    std::vector<FunctionSummary> functions;
+    return verify(program, diagnostic, functions);
+}
+
+bool Verifier::verify(const DecodedProgram &program, std::string &diagnostic,
+                      std::vector<FunctionSummary> &functions) {
+    diagnostic.clear();
+    Verifier verifier(program, diagnostic);
+    verifier.getFunction(0);
+
+    for (int round = 0; round < MAX_ROUNDS; round++) {
+        bool changed = false;
+        int knownFunctions = verifier._functions.size();
+        //Analyzing may discover new callees, they are analyzed in this round as well
+        for (int function = 0; function < static_cast<int>(verifier._functions.size()); function++) {
+            if (!verifier.analyzeFunction(function, changed))
+                return false;
+        }
+        if (static_cast<int>(verifier._functions.size()) != knownFunctions)
+            changed = true;
+        if (!changed) {
+            functions = verifier._functions;
+            return true;
+        }
+    }
+
+    int entry = verifier._functions.back().entry;
+    return verifier.fail(entry, "data stack requirement of recursive calls does not settle");
+}
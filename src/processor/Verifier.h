@@ -0,0 +1,54 @@
+#ifndef STACK_PROCESSOR_VERIFIER_H
+#define STACK_PROCESSOR_VERIFIER_H
+#include "Decoder.h"
+#include <string>
+#include <vector>
+
+//Data stack requirements of a function (or of the whole program for entry 0),
+//depths are relative to the depth at function entry
+struct FunctionSummary {
+    int entry;
+    int required; //Values the function reads from below its entry depth
+    bool returns; //False until a ret reachable from the entry has been analyzed
+    int effect; //Depth change between entry and return
+};
+
+//Checks once at load time what the interpreter otherwise checks on every instruction.
+//A verified program cannot underflow the data or call stack, jump outside of code, address
+//a frame slot outside of the data stack or reach an undecodable instruction or invalid
+//constant RAM address, so it can run without those checks. Data stack overflow and RAM
+//addresses taken from registers stay dynamic.
+class Verifier {
+private:
+    const DecodedProgram &_program;
+    std::vector<FunctionSummary> _functions;
+    std::vector<int> _functionByEntry;
+    std::vector<int> _depth;
+    //_visited[i] == _stamp marks instructions already reached by the current analysis
+    std::vector<int> _visited;
+    int _stamp;
+    std::string &_diagnostic;
+
+    Verifier(const DecodedProgram &program, std::string &diagnostic);
+
+    bool fail(int index, const std::string &message);
+
+    int getFunction(int entry);
+
+    //Returns false and sets diagnostic on error, changed is set if the summary was updated
+    bool analyzeFunction(int function, bool &changed);
+
+    bool checkTrap(int index);
+
+public:
+    //Data stack values needed and pushed by an instruction that is not a jump or call
+    static void getStackEffect(unsigned char opcode, int &needed, int &pushed);
+
+    static bool verify(const DecodedProgram &program, std::string &diagnostic);
+
+    //Same analysis, also returns summary of every function reachable through call
+    static bool verify(const DecodedProgram &program, std::string &diagnostic,
+                       std::vector<FunctionSummary> &functions);
+};
+
+#endif //STACK_PROCESSOR_VERIFIER_H
@@ -0,0 +1,169 @@
+#include "BatchRunner.h"
+#include "Fusion.h"
+#include "Verifier.h"
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <cstdlib>
+#include <cstring>
+
+//Maps a whole file read-only into data, size receives its length. Returns false if it cannot be
+//opened or mapped, an empty file is valid and maps to nullptr
+static bool mapFile(const char *path, void *&data, off_t &size) {
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr)
+        return false;
+
+    struct stat fileStat;
+    int res = fstat(fileno(file), &fileStat);
+    if (res < 0) {
+        fclose(file);
+        return false;
+    }
+    data = nullptr;
+    size = fileStat.st_size;
+    if (size == 0) {
+        fclose(file);
+        return true;
+    }
+
+    void *ptr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+    fclose(file);
+    if (ptr == MAP_FAILED)
+        return false;
+    data = ptr;
+    return true;
+}
+
+static void unmapFile(void *data, off_t size) {
+    if (data != nullptr)
+        munmap(data, size);
+}
+
+int main(int argc, char *argv[]) {
+    const char *paths[3] = {nullptr, nullptr, nullptr};
+    int pathCount = 0;
+    DispatchMode dispatchMode = DispatchMode::THREADED_DISPATCH;
+    bool verification = true;
+    bool fusion = true;
+    bool tailCalls = true;
+    int inputWidth = 1;
+    int outputWidth = 1;
+    long long ramSize = RAM::DEFAULT_SIZE;
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--dispatch=switch") == 0) {
+            dispatchMode = DispatchMode::SWITCH_DISPATCH;
+        } else if (std::strcmp(argv[i], "--dispatch=threaded") == 0) {
+            dispatchMode = DispatchMode::THREADED_DISPATCH;
+        } else if (std::strcmp(argv[i], "--no-verify") == 0) {
+            verification = false;
+        } else if (std::strcmp(argv[i], "--no-tail-calls") == 0) {
+            tailCalls = false;
+        } else if (std::strcmp(argv[i], "--no-fusion") == 0) {
+            fusion = false;
+        } else if (std::strncmp(argv[i], "--input-width=", 14) == 0) {
+            inputWidth = std::atoi(argv[i] + 14);
+            if (inputWidth < 1) {
+                std::cout << "Invalid option " << argv[i] << std::endl;
+                return 0;
+            }
+        } else if (std::strncmp(argv[i], "--output-width=", 15) == 0) {
+            outputWidth = std::atoi(argv[i] + 15);
+            if (outputWidth < 0) {
+                std::cout << "Invalid option " << argv[i] << std::endl;
+                return 0;
+            }
+        } else if (std::strncmp(argv[i], "--ram-size=", 11) == 0) {
+            ramSize = RAM::parseSize(argv[i] + 11);
+            if (ramSize < static_cast<long long>(sizeof (double))) {
+                std::cout << "Invalid option " << argv[i] << ", RAM size must be from 8 bytes up to 2G-1"
+                          << std::endl;
+                return 0;
+            }
+        } else if (std::strncmp(argv[i], "--threads=", 10) == 0) {
+            threads = std::atoi(argv[i] + 10);
+            if (threads < 1) {
+                std::cout << "Invalid option " << argv[i] << std::endl;
+                return 0;
+            }
+        } else if (argv[i][0] == '-' && argv[i][1] == '-') {
+            std::cout << "Unknown option " << argv[i] << std::endl;
+            return 0;
+        } else if (pathCount < 3) {
+            paths[pathCount++] = argv[i];
+        }
+    }
+
+    if (pathCount < 3) {
+        std::cout << "Usage: processor-batch [options] program input output" << std::endl;
+        return 0;
+    }
+
+    off_t codeSize;
+    void *codePtr;
+    if (!mapFile(paths[0], codePtr, codeSize) || codeSize == 0) {
+        std::cout << "Cannot map program file" << std::endl;
+        return 0;
+    }
+
+    Executable executable;
+    std::string loadError;
+    if (!Executable::load(static_cast<char*>(codePtr), codeSize, executable, loadError)) {
+        unmapFile(codePtr, codeSize);
+        std::cout << "Invalid executable: " << loadError << std::endl;
+        return 0;
+    }
+
+    //Loaded once, every worker runs the same decoded program
+    DecodedProgram program;
+    Decoder::decode(executable, program, ramSize);
+    unmapFile(codePtr, codeSize);
+    if (tailCalls)
+        Decoder::eliminateTailCalls(program);
+    std::string diagnostic;
+    if (verification)
+        program.verified = Verifier::verify(program, diagnostic);
+    std::vector<int> firedCounts;
+    if (fusion)
+        Fusion::fuse(program, firedCounts);
+
+    //An empty input is zero records and gives an empty output
+    off_t inputSize;
+    void *inputPtr;
+    if (!mapFile(paths[1], inputPtr, inputSize)) {
+        std::cout << "Cannot map input file" << std::endl;
+        return 0;
+    }
+
+    FILE *output = fopen(paths[2], "wb");
+    if (output == nullptr) {
+        unmapFile(inputPtr, inputSize);
+        std::cout << "Cannot open output file" << std::endl;
+        return 0;
+    }
+
+    //An incomplete record at the end of input is ignored
+    long long count = inputSize / (static_cast<long long>(sizeof (double)) * inputWidth);
+    BatchRunner runner(program, inputWidth, outputWidth, threads);
+    runner.setDispatchMode(dispatchMode);
+    runner.setRamSize(ramSize);
+    std::string error;
+    bool done = runner.run(static_cast<const double*>(inputPtr), count, output, error);
+    unmapFile(inputPtr, inputSize);
+    if (fclose(output) != 0 && done) {
+        done = false;
+        error = "cannot write output records";
+    }
+
+    if (!done)
+        std::cout << "Batch failed: " << error << std::endl;
+    else
+        std::cout << "Batch done, " << count << " records on " << threads << " threads" << std::endl;
+    return 0;
+}
@@ -1,17 +1,189 @@
 #include "Processor.h"
+#include "Fusion.h"
+#include "BatchEngine.h"
 #include <iostream>
+#include <memory>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/mman.h>
+#include <cstdlib>
+#include <cstring>
+
+static int runBatch(const Executable &executable, const char *inputPath, const char *outputPath,
+                    int inputWidth, int outputWidth, int ramSize, bool tailCalls) {
+    if (inputPath == nullptr || outputPath == nullptr) {
+        std::cout << "Batch mode needs both --batch-input and --batch-output" << std::endl;
+        return 0;
+    }
+
+    FILE *input = fopen(inputPath, "rb");
+    if (input == nullptr) {
+        std::cout << "Cannot open batch input" << std::endl;
+        return 0;
+    }
+    FILE *output = fopen(outputPath, "wb");
+    if (output == nullptr) {
+        fclose(input);
+        std::cout << "Cannot open batch output" << std::endl;
+        return 0;
+    }
+
+    DecodedProgram program;
+    Decoder::decode(executable, program, ramSize);
+    if (tailCalls)
+        Decoder::eliminateTailCalls(program);
+    BatchEngine engine(program, inputWidth, outputWidth, ramSize);
+    std::string error;
+    bool done = engine.run(input, output, error);
+    fclose(input);
+    if (fclose(output) != 0 && done) {
+        done = false;
+        error = "cannot write output records";
+    }
+
+    if (!done)
+        std::cout << "Batch failed: " << error << std::endl;
+    else
+        std::cout << "Batch done with " << engine.getKernelsName() << " kernels" << std::endl;
+    return 0;
+}
 
 int main(int argc, char *argv[]) {
-    if (argc < 2) {
+    const char *path = nullptr;
+    DispatchMode dispatchMode = DispatchMode::THREADED_DISPATCH;
+    bool verification = true;
+    bool verificationReport = false;
+    bool fusion = true;
+    bool topOfStackCaching = true;
+    bool fusionReport = false;
+    bool tailCalls = true;
+    bool tailCallReport = false;
+    bool jit = false;
+    bool registerMachine = false;
+    bool registerReport = false;
+    bool tracing = false;
+    bool traceReport = false;
+    const char *batchInputPath = nullptr;
+    const char *batchOutputPath = nullptr;
+    int batchInputWidth = 1;
+    int batchOutputWidth = 1;
+    int dataStackCapacity = Processor::DEFAULT_DATA_STACK_CAPACITY;
+    int callStackCapacity = Processor::DEFAULT_CALL_STACK_CAPACITY;
+    long long ramSize = RAM::DEFAULT_SIZE;
+    bool hugePages = false;
+    bool memoization = false;
+    bool memoReport = false;
+    bool profile = false;
+    const char *profilePath = nullptr;
+    const char *foldedPath = nullptr;
+    const char *ioMode = "interactive";
+    const char *ioInputPath = nullptr;
+    const char *ioOutputPath = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--dispatch=switch") == 0) {
+            dispatchMode = DispatchMode::SWITCH_DISPATCH;
+        } else if (std::strcmp(argv[i], "--dispatch=threaded") == 0) {
+            dispatchMode = DispatchMode::THREADED_DISPATCH;
+        } else if (std::strcmp(argv[i], "--no-tos-cache") == 0) {
+            topOfStackCaching = false;
+        } else if (std::strcmp(argv[i], "--no-verify") == 0) {
+            verification = false;
+        } else if (std::strcmp(argv[i], "--verify-report") == 0) {
+            verificationReport = true;
+        } else if (std::strcmp(argv[i], "--no-tail-calls") == 0) {
+            tailCalls = false;
+        } else if (std::strcmp(argv[i], "--tail-call-report") == 0) {
+            tailCallReport = true;
+        } else if (std::strcmp(argv[i], "--no-fusion") == 0) {
+            fusion = false;
+        } else if (std::strcmp(argv[i], "--fusion-report") == 0) {
+            fusionReport = true;
+        } else if (std::strcmp(argv[i], "--trace") == 0) {
+            tracing = true;
+        } else if (std::strcmp(argv[i], "--trace-report") == 0) {
+            traceReport = true;
+        } else if (std::strcmp(argv[i], "--jit") == 0) {
+            jit = true;
+        } else if (std::strcmp(argv[i], "--register-vm") == 0) {
+            registerMachine = true;
+        } else if (std::strcmp(argv[i], "--register-report") == 0) {
+            registerReport = true;
+        } else if (std::strncmp(argv[i], "--batch-input=", 14) == 0) {
+            batchInputPath = argv[i] + 14;
+        } else if (std::strncmp(argv[i], "--batch-output=", 15) == 0) {
+            batchOutputPath = argv[i] + 15;
+        } else if (std::strncmp(argv[i], "--batch-input-width=", 20) == 0) {
+            batchInputWidth = std::atoi(argv[i] + 20);
+            if (batchInputWidth < 1) {
+                std::cout << "Invalid option " << argv[i] << std::endl;
+                return 0;
+            }
+        } else if (std::strncmp(argv[i], "--batch-output-width=", 21) == 0) {
+            batchOutputWidth = std::atoi(argv[i] + 21);
+            if (batchOutputWidth < 0) {
+                std::cout << "Invalid option " << argv[i] << std::endl;
+                return 0;
+            }
+        } else if (std::strncmp(argv[i], "--data-stack=", 13) == 0) {
+            dataStackCapacity = std::atoi(argv[i] + 13);
+            if (dataStackCapacity < 1) {
+                std::cout << "Invalid option " << argv[i] << std::endl;
+                return 0;
+            }
+        } else if (std::strncmp(argv[i], "--call-stack=", 13) == 0) {
+            callStackCapacity = std::atoi(argv[i] + 13);
+            if (callStackCapacity < 1) {
+                std::cout << "Invalid option " << argv[i] << std::endl;
+                return 0;
+            }
+        } else if (std::strncmp(argv[i], "--ram-size=", 11) == 0) {
+            ramSize = RAM::parseSize(argv[i] + 11);
+            if (ramSize < static_cast<long long>(sizeof (double))) {
+                std::cout << "Invalid option " << argv[i] << ", RAM size must be from 8 bytes up to 2G-1"
+                          << std::endl;
+                return 0;
+            }
+        } else if (std::strcmp(argv[i], "--huge-pages") == 0) {
+            hugePages = true;
+        } else if (std::strcmp(argv[i], "--memoize") == 0) {
+            memoization = true;
+        } else if (std::strcmp(argv[i], "--memo-report") == 0) {
+            memoReport = true;
+        } else if (std::strcmp(argv[i], "--profile") == 0) {
+            profile = true;
+        } else if (std::strncmp(argv[i], "--profile=", 10) == 0) {
+            profile = true;
+            profilePath = argv[i] + 10;
+        } else if (std::strncmp(argv[i], "--profile-folded=", 17) == 0) {
+            profile = true;
+            foldedPath = argv[i] + 17;
+        } else if (std::strncmp(argv[i], "--io=", 5) == 0) {
+            ioMode = argv[i] + 5;
+            if (std::strcmp(ioMode, "interactive") != 0 && std::strcmp(ioMode, "text") != 0 &&
+                std::strcmp(ioMode, "binary") != 0) {
+                std::cout << "Invalid option " << argv[i] << std::endl;
+                return 0;
+            }
+        } else if (std::strncmp(argv[i], "--io-input=", 11) == 0) {
+            ioInputPath = argv[i] + 11;
+        } else if (std::strncmp(argv[i], "--io-output=", 12) == 0) {
+            ioOutputPath = argv[i] + 12;
+        } else if (argv[i][0] == '-' && argv[i][1] == '-') {
+            std::cout << "Unknown option " << argv[i] << std::endl;
+            return 0;
+        } else {
+            path = argv[i];
+        }
+    }
+
+    if (path == nullptr) {
         std::cout << "No file path provided!" << std::endl;
         return 0;
     }
 
-    FILE *executableFile = fopen(argv[1], "rb");
+    FILE *executableFile = fopen(path, "rb");
     if (executableFile == nullptr) {
         std::cout << "Cannot open file" << std::endl;
         return 0;
@@ -32,13 +204,152 @@ int main(int argc, char *argv[]) {
         return 0;
     }
 
+    //Runs in place from the mapping, only a damaged or incompatible executable is rejected
+    Executable executable;
+    std::string loadError;
+    if (!Executable::load(static_cast<char*>(codePtr), fileStat.st_size, executable, loadError)) {
+        munmap(codePtr, fileStat.st_size);
+        std::cout << "Invalid executable: " << loadError << std::endl;
+        return 0;
+    }
+
+    if (batchInputPath != nullptr || batchOutputPath != nullptr) {
+        int status = runBatch(executable, batchInputPath, batchOutputPath,
+                              batchInputWidth, batchOutputWidth, ramSize, tailCalls);
+        munmap(codePtr, fileStat.st_size);
+        return status;
+    }
+
+    //Channels read stdin and write stdout unless files are given
+    FILE *ioInput = stdin;
+    FILE *ioOutput = stdout;
+    if (ioInputPath != nullptr && std::strcmp(ioMode, "text") == 0) {
+        ioInput = fopen(ioInputPath, "rb");
+        if (ioInput == nullptr) {
+            munmap(codePtr, fileStat.st_size);
+            std::cout << "Cannot open input file" << std::endl;
+            return 0;
+        }
+    }
+    if (ioOutputPath != nullptr && std::strcmp(ioMode, "interactive") != 0) {
+        ioOutput = fopen(ioOutputPath, "wb");
+        if (ioOutput == nullptr) {
+            munmap(codePtr, fileStat.st_size);
+            std::cout << "Cannot open output file" << std::endl;
+            return 0;
+        }
+    }
+
+    std::unique_ptr<IoChannel> channel;
+    if (std::strcmp(ioMode, "text") == 0) {
+        channel.reset(new BufferedTextChannel(ioInput, ioOutput));
+    } else if (std::strcmp(ioMode, "binary") == 0) {
+        std::unique_ptr<BinaryFileChannel> binary(new BinaryFileChannel);
+        std::string error;
+        if (ioInputPath == nullptr || !binary->open(ioInputPath, ioOutput, error)) {
+            munmap(codePtr, fileStat.st_size);
+            std::cout << "Binary input: " << (ioInputPath == nullptr ? "no --io-input given" : error) << std::endl;
+            return 0;
+        }
+        channel = std::move(binary);
+    }
+
     Processor processor;
+    processor.setIoChannel(channel.get());
+    processor.setDispatchMode(dispatchMode);
+    processor.setDataStackCapacity(dataStackCapacity);
+    processor.setCallStackCapacity(callStackCapacity);
+    processor.setRamSize(ramSize, hugePages);
+    processor.setVerificationEnabled(verification);
+    processor.setTailCallEliminationEnabled(tailCalls);
+    processor.setFusionEnabled(fusion);
+    processor.setTopOfStackCaching(topOfStackCaching);
+    processor.setTracingEnabled(tracing);
+    processor.setJitEnabled(jit);
+    processor.setRegisterMachineEnabled(registerMachine);
+    processor.setProfilingEnabled(profile);
+    processor.setMemoizationEnabled(memoization);
 
-    ProcessorStatus status = processor.executeOperations(static_cast<char*>(codePtr), fileStat.st_size);
+    ProcessorStatus status = processor.executeOperations(executable);
 
     std::cout << Processor::statusToStr(status) << std::endl;
 
+    if (jit && !processor.getJitDiagnostic().empty())
+        std::cerr << "jit unavailable: " << processor.getJitDiagnostic() << std::endl;
+
+    if (registerMachine && !processor.getRegisterMachineDiagnostic().empty())
+        std::cerr << "register vm unavailable: " << processor.getRegisterMachineDiagnostic() << std::endl;
+
+    if (registerReport && processor.getRegisterMachine() != nullptr) {
+        const RegisterMachine &machine = *processor.getRegisterMachine();
+        std::cerr << "register code: " << machine.getInstructionCount() << " instructions for "
+                  << machine.getTranslatedCount() << " stack instructions" << std::endl;
+    }
+
+    if (verificationReport) {
+        if (processor.getVerificationDiagnostic().empty())
+            std::cerr << "verified" << std::endl;
+        else
+            std::cerr << "not verified: " << processor.getVerificationDiagnostic() << std::endl;
+    }
+
+    if (tailCallReport)
+        std::cerr << "tail calls eliminated: " << processor.getTailCallCount() << std::endl;
+
+    if (fusionReport) {
+        const std::vector<int> &counts = processor.getFusionCounts();
+        for (int rule = 0; rule < Fusion::getRuleCount(); rule++) {
+            if (counts[rule] > 0)
+                std::cerr << "fusion " << Fusion::getRule(rule).name << ": " << counts[rule] << std::endl;
+        }
+    }
+
+    if (traceReport && processor.getTracer() != nullptr) {
+        for (const Trace &trace : processor.getTracer()->getTraces()) {
+            std::cerr << "trace at offset " << trace.offset << ": " << trace.instructions.size()
+                      << " instructions, entered " << trace.entries << " times" << std::endl;
+        }
+    }
+
+    if (memoReport && processor.getMemoizer() != nullptr) {
+        const Memoizer &memoizer = *processor.getMemoizer();
+        for (const MemoFunction &function : memoizer.getFunctions()) {
+            std::cerr << "memo function at offset " << function.offset << ": "
+                      << function.lookups << " lookups, " << function.hits << " hits"
+                      << (function.disabled ? ", disabled" : "") << std::endl;
+        }
+        std::cerr << "memo cache evictions: " << memoizer.getEvictions() << std::endl;
+    }
+
+    if (processor.getProfiler() != nullptr) {
+        //Without any path the JSON profile goes to stderr
+        if (profilePath != nullptr || foldedPath == nullptr) {
+            FILE *profileFile = profilePath != nullptr ? fopen(profilePath, "w") : stderr;
+            if (profileFile == nullptr) {
+                std::cerr << "Cannot open profile file" << std::endl;
+            } else {
+                processor.getProfiler()->writeJson(profileFile);
+                if (profileFile != stderr)
+                    fclose(profileFile);
+            }
+        }
+        if (foldedPath != nullptr) {
+            FILE *foldedFile = fopen(foldedPath, "w");
+            if (foldedFile == nullptr) {
+                std::cerr << "Cannot open folded stacks file" << std::endl;
+            } else {
+                processor.getProfiler()->writeFolded(foldedFile);
+                fclose(foldedFile);
+            }
+        }
+    }
+
     munmap(codePtr, fileStat.st_size);
+    channel.reset();
+    if (ioInput != stdin)
+        fclose(ioInput);
+    if (ioOutput != stdout)
+        fclose(ioOutput);
 
     return 0;
 }
@@ -32,7 +32,39 @@ enum OperationPrefixCode {
     JAE_OFFSET_EXACT_VAL = 0b00011000,
     JB_OFFSET_EXACT_VAL = 0b00011001,
     JBE_OFFSET_EXACT_VAL = 0b00011010,
-    CALL_OFFSET_EXACT_VAL = 0b00011011
+    CALL_OFFSET_EXACT_VAL = 0b00011011,
+    PUSH_FRAME_SLOT = 0b00011100, //Pushes the data stack slot at frame pointer + int operand
+    POP_FRAME_SLOT = 0b00011101, //Pops into the data stack slot at frame pointer + int operand
+    //Operations over ranges of doubles in RAM, operands are on the data stack, see VectorOperations.h
+    VADD = 0b00011110,
+    VMUL = 0b00011111,
+    VFMA = 0b00100000,
+    VSUM = 0b00100001,
+    VMIN = 0b00100010,
+    VMAX = 0b00100011,
+    VDOT = 0b00100100,
+    VFILL = 0b00100101,
+    VCOPY = 0b00100110,
+    //Operations on stack values holding 64-bit signed integers in place of doubles
+    IADD = 0b00100111,
+    ISUB = 0b00101000,
+    IMUL = 0b00101001,
+    IDIV = 0b00101010, //Rounds toward zero
+    IREM = 0b00101011, //Sign of the dividend
+    IAND = 0b00101100,
+    IOR = 0b00101101,
+    IXOR = 0b00101110,
+    ISHL = 0b00101111, //Shift count is taken modulo 64
+    ISHR = 0b00110000, //Arithmetic shift
+    ITOD = 0b00110001,
+    DTOI = 0b00110010, //Truncates, NaN and values out of range give INT64_MIN
+    IJE_OFFSET_EXACT_VAL = 0b00110011,
+    IJNE_OFFSET_EXACT_VAL = 0b00110100,
+    IJA_OFFSET_EXACT_VAL = 0b00110101,
+    IJAE_OFFSET_EXACT_VAL = 0b00110110,
+    IJB_OFFSET_EXACT_VAL = 0b00110111,
+    IJBE_OFFSET_EXACT_VAL = 0b00111000,
+    PUSH_CONST = 0b00111001 //Pushes the constant pool entry at int operand, see ExecutableHeader
 };
 
 enum RegisterCode{
@@ -49,7 +81,11 @@ enum ProcessorStatus {
     CALL_STACK_UNDERFLOW,
     DATA_STACK_UNDERFLOW,
     INVALID_INSTRUCTION_POINTER,
-    INVALID_RAM_ADDRESS
+    INVALID_RAM_ADDRESS,
+    DATA_STACK_OVERFLOW,
+    CALL_STACK_OVERFLOW,
+    INVALID_FRAME_SLOT,
+    INTEGER_DIVISION_BY_ZERO
 };
 
 union DoubleChars {
@@ -67,6 +103,32 @@ union DoubleUll {
     double db_val;
 };
 
+union DoubleLl {
+    long long ll_val;
+    double db_val;
+};
+
 constexpr double PROCESSOR_EPSILON = 1e-9;
 
+//Executables start with this header, raw bytecode never does as 'S' is no opcode. The constant pool
+//holds doubles at an 8-byte aligned file offset, the code follows it and the optional symbol table
+//comes last, every symbol as code offset, name length and name
+struct ExecutableHeader {
+    char magic[4];
+    int version;
+    int entry; //Code offset execution starts at
+    int constantsOffset;
+    int constantCount;
+    int codeOffset;
+    int codeSize;
+    int symbolsOffset;
+    int symbolCount;
+    int reserved;
+};
+
+static_assert(sizeof (ExecutableHeader) == 40, "ExecutableHeader should not be padded");
+
+constexpr char EXECUTABLE_MAGIC[4] = {'S', 'P', 'E', 'X'};
+constexpr int EXECUTABLE_VERSION = 1;
+
 #endif //STACK_PROCESSOR_UTILS_H
@@ -0,0 +1,28 @@
+in
+pop cx
+
+loop:
+push cx
+push 0
+jbe done
+popd
+popd
+call step
+push cx
+push 1
+sub
+pop cx
+jmp loop
+done:
+popd
+popd
+push ax
+out
+halt
+
+step:
+push ax
+push 1
+add
+pop ax
+ret
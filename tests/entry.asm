@@ -0,0 +1,8 @@
+push 1
+out
+halt
+
+main:
+push 2
+out
+halt
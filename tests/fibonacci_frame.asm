@@ -0,0 +1,29 @@
+in
+call fib
+out
+halt
+
+fib:
+push [fp-1]
+push 1
+ja rec
+popd
+popd
+popd
+push 1
+ret
+
+rec:
+popd
+popd
+push [fp-1]
+push 1
+sub
+call fib
+push [fp-1]
+push 2
+sub
+call fib
+add
+pop [fp-1]
+ret
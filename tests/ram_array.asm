@@ -0,0 +1,61 @@
+in
+pop dx
+
+pass:
+ipush 0
+pop ax
+fill:
+push ax
+ipush 32768
+ijae filled
+popd
+popd
+push ax
+itod
+pop [ax]
+push ax
+ipush 8
+iadd
+pop ax
+jmp fill
+filled:
+popd
+popd
+
+ipush 0
+pop ax
+sum:
+push ax
+ipush 32768
+ijae summed
+popd
+popd
+push [ax]
+push bx
+add
+pop bx
+push ax
+ipush 8
+iadd
+pop ax
+jmp sum
+summed:
+popd
+popd
+
+push dx
+push 1
+sub
+pop dx
+push dx
+push 0
+jbe done
+popd
+popd
+jmp pass
+done:
+popd
+popd
+push bx
+out
+halt